@@ -0,0 +1,38 @@
+"""
+    asyncio example.
+
+    /py load async_fetch
+    /fetch host [port]
+
+    Fetches / from host over plain HTTP without blocking Irssi and prints
+    the status line. Pending fetches are cancelled when the script is
+    unloaded.
+"""
+
+import asyncio
+import irssi
+
+async def fetch(host, port):
+    try:
+        reader, writer = await asyncio.wait_for(
+                asyncio.open_connection(host, port), timeout=10)
+    except (OSError, asyncio.TimeoutError) as err:
+        irssi.prnt(b"fetch %s: %s" % (host.encode(), str(err).encode()))
+        return
+
+    writer.write(b"GET / HTTP/1.0\r\nHost: %s\r\n\r\n" % host.encode())
+    status = await reader.readline()
+    writer.close()
+
+    irssi.prnt(b"fetch %s: %s" % (host.encode(), status.strip()))
+
+def cmd_fetch(data, server, witem):
+    args = data.split()
+    if not args:
+        irssi.prnt(b"usage: /fetch host [port]")
+        return
+
+    port = int(args[1]) if len(args) > 1 else 80
+    asyncio.create_task(fetch(args[0].decode(), port))
+
+irssi.command_bind(b'fetch', cmd_fetch)
@@ -0,0 +1,42 @@
+"""
+    Signal dispatch micro-benchmark.
+
+    /py load bench_signals
+    /bench_signals [handlers] [emits]
+
+    Binds 'handlers' Python handlers to a dynamic signal, emits it 'emits'
+    times and prints how many handler calls per second the bridge managed.
+    Run it against two builds to compare dispatch paths.
+"""
+
+import time
+import irssi
+
+SIGNAL = b"bench signal"
+
+def noop(text, target):
+    pass
+
+def cmd_bench_signals(data, server, witem):
+    args = data.split()
+    handlers = int(args[0]) if len(args) > 0 else 10
+    emits = int(args[1]) if len(args) > 1 else 10000
+
+    funcs = [lambda text, target: None for i in range(handlers - 1)] + [noop]
+    for func in funcs:
+        irssi.signal_add(SIGNAL, func)
+
+    start = time.perf_counter()
+    for i in range(emits):
+        irssi.signal_emit(SIGNAL, b"some text to pass along", b"#channel")
+    elapsed = time.perf_counter() - start
+
+    for func in funcs:
+        irssi.signal_remove(SIGNAL, func)
+
+    calls = handlers * emits
+    irssi.prnt(b"%d handlers x %d emits: %d calls in %.3fs, %.0f calls/sec" %
+               (handlers, emits, calls, elapsed, calls / elapsed))
+
+irssi.get_script().signal_register(SIGNAL, b"ss")
+irssi.command_bind(b'bench_signals', cmd_bench_signals)
@@ -56,3 +56,11 @@ def settings_add_level(*args, **kwargs):
 def settings_add_size(*args, **kwargs):
     """ see Script.settings_add_size() """
     get_script().settings_add_size(*args, **kwargs)
+
+def create_task(*args, **kwargs):
+    """ see Script.create_task() """
+    return get_script().create_task(*args, **kwargs)
+
+def run_in_worker(*args, **kwargs):
+    """ see Script.run_in_worker() """
+    return get_script().run_in_worker(*args, **kwargs)
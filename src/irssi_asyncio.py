@@ -0,0 +1,150 @@
+"""
+    asyncio event loop running on the Irssi main loop.
+
+    Irssi owns the main loop, so the asyncio loop is never run with
+    run_forever(). It is marked running for good when it is installed and
+    _irssi.LoopDriver calls one iteration at a time from GLib: when a file
+    descriptor it watches becomes ready, or when the next callback is due.
+    asyncio.run() and run_until_complete() are therefore not available;
+    start coroutines with asyncio.create_task() or irssi.create_task().
+
+    Tasks created while a script is current belong to that script and are
+    cancelled when it is unloaded.
+
+    Driving the loop one iteration at a time needs asyncio internals that
+    have no public equivalent: BaseEventLoop._run_once(), _ready,
+    _scheduled and TimerHandle._when, events._set_running_loop() and
+    selectors._BaseSelectorImpl. They have not changed in the releases
+    this plugin supports, but nothing promises that; _check_internals() 
+    refuses to start on a Python that lacks them rather
+    than failing later inside a GLib callback.
+"""
+
+import asyncio
+import selectors
+import threading
+from asyncio import events
+
+import _irssi
+
+def _check_internals():
+    missing = [name for obj, name in (
+            (asyncio.BaseEventLoop, '_run_once'),
+            (asyncio.TimerHandle, '_when'),
+            (events, '_set_running_loop'),
+            (selectors, '_BaseSelectorImpl'),
+        ) if not hasattr(obj, name)]
+    if missing:
+        raise ImportError('asyncio internals used by irssi_asyncio are missing: '
+                          + ', '.join(missing))
+
+_check_internals()
+
+def _current_script():
+    try:
+        return _irssi.get_script()
+    except RuntimeError:
+        return None
+
+class GLibSelector(selectors._BaseSelectorImpl):
+    """ Selector whose file descriptors are watched by GLib. select() only
+        collects what GLib has seen and never blocks. """
+
+    def __init__(self, driver):
+        super().__init__()
+        self._driver = driver
+
+    def register(self, fileobj, events, data=None):
+        key = super().register(fileobj, events, data)
+        self._driver.watch(key.fd, events)
+        return key
+
+    def unregister(self, fileobj):
+        key = super().unregister(fileobj)
+        self._driver.watch(key.fd, 0)
+        return key
+
+    def select(self, timeout=None):
+        ready = []
+        for fd, mask in self._driver.ready():
+            key = self._key_from_fd(fd)
+            if key and mask & key.events:
+                ready.append((key, mask & key.events))
+        return ready
+
+    def close(self):
+        self._driver.close()
+        super().close()
+
+class IrssiEventLoop(asyncio.SelectorEventLoop):
+    """ asyncio loop driven by the Irssi main loop """
+
+    def __init__(self):
+        self._driver = _irssi.LoopDriver(self._iterate)
+        super().__init__(GLibSelector(self._driver))
+
+    def _iterate(self):
+        self._run_once()
+        self._reschedule()
+
+    def _reschedule(self):
+        if self._ready or self._stopping:
+            self._driver.schedule(0)
+        elif self._scheduled:
+            self._driver.schedule(max(0, self._scheduled[0]._when - self.time()))
+        else:
+            self._driver.schedule(None)
+
+    # callbacks added outside an iteration (signal handlers, timeouts) 
+    # have to wake the loop up. The driver belongs to the main thread;
+    # call_soon_threadsafe() also gets here from other threads, and its
+    # write to the self-pipe wakes the loop through the GLib watch instead
+    def _wakeup(self):
+        if threading.get_ident() == self._thread_id:
+            self._driver.wakeup()
+
+    def _call_soon(self, callback, args, context):
+        handle = super()._call_soon(callback, args, context)
+        self._wakeup()
+        return handle
+
+    def call_at(self, when, callback, *args, **kwargs):
+        timer = super().call_at(when, callback, *args, **kwargs)
+        self._wakeup()
+        return timer
+
+    def create_task(self, coro, **kwargs):
+        if not isinstance(coro, _irssi.ScriptCoroutine) and set(kwargs) <= {'name'}:
+            script = _current_script()
+            if script is not None:
+                return script.create_task(coro, **kwargs)
+
+        return super().create_task(coro, **kwargs)
+
+    def attach(self):
+        """ Mark the loop as running in this thread from now on """
+        self._thread_id = threading.get_ident()
+        events._set_running_loop(self)
+        self._reschedule()
+
+    def detach(self):
+        self._driver.schedule(None)
+        events._set_running_loop(None)
+        self._thread_id = None
+
+    def run_forever(self):
+        raise RuntimeError("the Irssi main loop runs this loop, use create_task()")
+
+    def close(self):
+        if self.is_running():
+            self.detach()
+        super().close()
+
+def install():
+    """ Make IrssiEventLoop the main thread's loop and start it. The loop
+        policy is left alone: the policy API is deprecated, and other
+        threads can't use this loop anyway. """
+    loop = IrssiEventLoop()
+    asyncio.set_event_loop(loop)
+    loop.attach()
+    return loop
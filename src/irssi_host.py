@@ -0,0 +1,297 @@
+"""
+    Irssi side of hosted scripts (/py host).
+
+    A hosted script runs in its own process (irssi_hostworker.py), so heavy
+    work happens on another core and a crash or leak can't take Irssi down.
+    The script module loaded in Irssi only holds a Host, which forwards the
+    signals and commands the script binds, and carries out the prints and
+    commands it sends back.
+
+    Messages are marshal dumps in two shared memory rings (_irssi_ring),
+    one each way. A byte written to a pipe wakes the other side; Irssi
+    drains the return ring from an io watch of the script. Irssi objects
+    are sent as dicts of their plain attributes, so handlers in the host
+    see copies, and signal_stop() and changing arguments have no effect.
+
+    With python_host_record_dir set, everything sent to a host is also
+    written to <dir>/<script>.events, which irssi_hostworker.py --replay
+    runs the script against without Irssi.
+"""
+
+import os
+import sys
+import marshal
+import asyncio
+import subprocess
+import collections
+import types
+
+import _irssi
+import _irssi_ring
+
+RING_SIZE = 1 << 20
+BACKLOG_MAX = 10000
+WORKER = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'irssi_hostworker.py')
+
+PLAIN = (bytes, str, int, float, bool, type(None))
+
+# wrapper type -> names of its attributes
+_fields = {}
+
+def _attribute_names(tp):
+    names = _fields.get(tp)
+    if names is None:
+        names = [name for name in dir(tp) if not name.startswith('_') and
+                 isinstance(getattr(tp, name, None), types.GetSetDescriptorType)]
+        _fields[tp] = names
+    return names
+
+def export(obj):
+    """ Copy of a signal argument that marshal can take """
+    if isinstance(obj, PLAIN):
+        return obj
+    if isinstance(obj, (list, tuple, _irssi.StrList)):
+        return [export(item) for item in obj]
+
+    fields = {'_type': type(obj).__name__}
+    for name in _attribute_names(type(obj)):
+        try:
+            value = getattr(obj, name)
+        except Exception:
+            continue
+        if isinstance(value, PLAIN):
+            fields[name] = value
+        elif name == 'server' and value is not None:
+            fields['server_tag'] = value.tag
+    return fields
+
+def _constants():
+    return {name: value for name, value in vars(_irssi).items()
+            if name.startswith('MSGLEVEL_') and isinstance(value, int)}
+
+def _interpreter():
+    name = _irssi.settings_get_str(b'python_host_interpreter')
+    if name:
+        return os.fsdecode(name)
+    return 'python%d.%d' % sys.version_info[:2]
+
+class Host:
+    def __init__(self, script, path):
+        self.script = script
+        self.name = os.fsdecode(script.module.__name__)
+        self.signals = {}
+        self.commands = {}
+        self.backlog = collections.deque()
+        self.backlog_tag = None
+        self.record = None
+        self.proc = None
+        self.to_host = self.from_host = None
+        self.wake_in = self.wake_out = None
+
+        # nothing is left running or open if any step fails
+        host_in = host_out = None
+        try:
+            recdir = _irssi.settings_get_str(b'python_host_record_dir')
+            if recdir:
+                recpath = os.path.join(os.path.expanduser(os.fsdecode(recdir)),
+                                       self.name + '.events')
+                self.record = open(recpath, 'wb')
+
+            self.to_host = _irssi_ring.Ring(RING_SIZE)
+            self.from_host = _irssi_ring.Ring(RING_SIZE)
+            host_in, self.wake_out = os.pipe()
+            self.wake_in, host_out = os.pipe()
+            os.set_blocking(self.wake_out, False)
+            os.set_blocking(self.wake_in, False)
+
+            fds = (self.to_host.fileno(), self.from_host.fileno(), host_in, host_out)
+            argv = [os.fsdecode(arg) for arg in script.argv[1:]]
+            self.proc = subprocess.Popen(
+                [_interpreter(), WORKER, '--fds', ','.join(map(str, fds)), path] + argv,
+                pass_fds=fds, stdin=subprocess.DEVNULL, close_fds=True)
+            _irssi.pidwait_add(self.proc.pid)
+
+            script.io_add_watch(self.wake_in, self.drain,
+                                condition=_irssi.IO_IN | _irssi.IO_HUP | _irssi.IO_ERR)
+            # cancelled when the script is unloaded
+            script.create_task(self.guard())
+
+            self.send(('load', path, argv, _constants()))
+        except BaseException:
+            self.close()
+            raise
+        finally:
+            for fd in (host_in, host_out):
+                if fd is not None:
+                    os.close(fd)
+
+    async def guard(self):
+        try:
+            await asyncio.get_event_loop().create_future()
+        finally:
+            self.stop()
+
+    def stop(self):
+        if self.proc is None:
+            return
+        # already gone if the script was unloaded
+        for name, handler in self.signals.items():
+            try:
+                self.script.signal_remove(name, handler)
+            except KeyError:
+                pass
+        for name, handler in self.commands.items():
+            try:
+                self.script.command_unbind(name, handler)
+            except KeyError:
+                pass
+        self.signals.clear()
+        self.commands.clear()
+        if self.backlog_tag is not None:
+            self.script.source_remove(self.backlog_tag)
+            self.backlog_tag = None
+        self.backlog.clear()
+        self.close()
+
+    def close(self):
+        # also undoes a partly run __init__, so anything may still be None.
+        # the host exits when its pipe closes
+        for fd in (self.wake_out, self.wake_in):
+            if fd is not None:
+                os.close(fd)
+        self.wake_out = self.wake_in = None
+        if self.proc is not None and self.proc.poll() is None:
+            self.proc.terminate()
+        self.proc = None
+        for ring in (self.to_host, self.from_host):
+            if ring is not None:
+                ring.close()
+        self.to_host = self.from_host = None
+        if self.record:
+            self.record.close()
+            self.record = None
+
+    def send(self, msg):
+        if self.proc is None:
+            return
+        data = marshal.dumps(msg)
+        if self.record:
+            self.record.write(data)
+        if self.backlog or not self.to_host.put(data):
+            if len(self.backlog) >= BACKLOG_MAX:
+                self.backlog.popleft()
+            self.backlog.append(data)
+            if self.backlog_tag is None:
+                self.backlog_tag = self.script.timeout_add(20, self.flush)
+        self.wakeup()
+
+    def flush(self):
+        if self.proc is None:
+            return False
+        while self.backlog and self.to_host.put(self.backlog[0]):
+            self.backlog.popleft()
+        self.wakeup()
+        if not self.backlog:
+            self.backlog_tag = None
+        return bool(self.backlog)
+
+    def wakeup(self):
+        try:
+            os.write(self.wake_out, b'\0')
+        except (BlockingIOError, BrokenPipeError):
+            pass
+
+    def drain(self, fd, condition):
+        if self.proc is None:
+            return False
+        try:
+            eof = os.read(fd, 4096) == b''
+        except BlockingIOError:
+            eof = False
+
+        while self.proc is not None:
+            try:
+                data = self.from_host.get()
+            except RuntimeError:
+                # a corrupt ring can't be read past; the host goes
+                sys.excepthook(*sys.exc_info())
+                self.stop()
+                return False
+            if data is None:
+                break
+            try:
+                self.handle(*marshal.loads(data))
+            except Exception:
+                sys.excepthook(*sys.exc_info())
+
+        if eof:
+            _irssi.prnt(('hosted script %s exited' % self.name).encode(),
+                        _irssi.MSGLEVEL_CLIENTERROR)
+            self.stop()
+            return False
+        return True
+
+    def forward_signal(self, name):
+        def handler(*args):
+            self.send(('signal', name, [export(arg) for arg in args]))
+        return handler
+
+    def forward_command(self, name):
+        def handler(data, server, witem):
+            self.send(('command', name, data, export(server), export(witem)))
+        return handler
+
+    def handle(self, op, *args):
+        if op == 'signal_add':
+            name, = args
+            if name not in self.signals:
+                self.signals[name] = self.forward_signal(name)
+                self.script.signal_add(name, self.signals[name])
+        elif op == 'signal_remove':
+            name, = args
+            handler = self.signals.pop(name, None)
+            if handler:
+                self.script.signal_remove(name, handler)
+        elif op == 'command_bind':
+            name, category = args
+            if name not in self.commands:
+                self.commands[name] = self.forward_command(name)
+                self.script.command_bind(name, self.commands[name], category)
+        elif op == 'command_unbind':
+            name, = args
+            handler = self.commands.pop(name, None)
+            if handler:
+                self.script.command_unbind(name, handler)
+        elif op == 'command':
+            cmd, tag, target = args
+            dest = self.destination(tag, target)
+            if dest is None:
+                _irssi.command(cmd)
+            else:
+                dest.command(cmd)
+        elif op == 'prnt':
+            text, level, tag, target = args
+            server = _irssi.server_find_tag(tag) if tag else None
+            if server and target:
+                server.prnt(target, text, level)
+            else:
+                _irssi.prnt(text, level)
+        elif op == 'error':
+            text, = args
+            for line in text.rstrip('\n').split('\n'):
+                _irssi.prnt(('%s: %s' % (self.name, line)).encode(),
+                            _irssi.MSGLEVEL_CLIENTERROR)
+        else:
+            raise ValueError('unknown message from host: %r' % (op,))
+
+    def destination(self, tag, target):
+        server = _irssi.server_find_tag(tag) if tag else None
+        if server and target:
+            item = server.window_item_find(target)
+            if item:
+                return item
+        return server
+
+def attach(script, path):
+    """ Called by the loader in place of running the script file """
+    script.module._host = Host(script, os.fsdecode(path))
@@ -0,0 +1,235 @@
+"""
+    Script host process for /py host, started by irssi_host.py:
+
+        irssi_hostworker.py --fds IN,OUT,WAKE_IN,WAKE_OUT script.py [args]
+
+    Runs one script with a stand-in irssi module. The script binds signals
+    and commands, prints and runs commands as usual; all of it goes back to
+    Irssi through the return ring. Signal and command handlers get copies
+    of the Irssi objects, with their plain attributes and server_tag.
+
+    A recording made with python_host_record_dir can be replayed without
+    Irssi; messages for Irssi are printed instead:
+
+        irssi_hostworker.py --replay script.events script.py [args]
+"""
+
+import os
+import sys
+import marshal
+import select
+import traceback
+import types
+
+class HostObject(types.SimpleNamespace):
+    """ Copy of an Irssi object, _type names the wrapper type """
+
+def _import(value):
+    if isinstance(value, dict) and '_type' in value:
+        return HostObject(**value)
+    if isinstance(value, list):
+        return [_import(item) for item in value]
+    return value
+
+def _bytes(value):
+    if isinstance(value, str):
+        return value.encode('utf-8')
+    return value
+
+def _tag(server):
+    if server is None:
+        return None
+    if isinstance(server, HostObject):
+        return getattr(server, 'tag', None) or getattr(server, 'server_tag', None)
+    return _bytes(server)
+
+def _target(item):
+    if isinstance(item, HostObject):
+        return getattr(item, 'name', None)
+    return _bytes(item)
+
+class RingChannel:
+    """ The rings and wake up pipes shared with Irssi """
+
+    def __init__(self, fds):
+        import _irssi_ring
+        ring_in, ring_out, self.wake_in, self.wake_out = fds
+        self.ring_in = _irssi_ring.Ring.attach(ring_in)
+        self.ring_out = _irssi_ring.Ring.attach(ring_out)
+
+    def send(self, msg):
+        data = marshal.dumps(msg)
+        while not self.ring_out.put(data):
+            # Irssi is behind; give it time to drain
+            os.write(self.wake_out, b'\0')
+            select.select([], [], [], 0.01)
+        os.write(self.wake_out, b'\0')
+
+    def messages(self):
+        while True:
+            if not os.read(self.wake_in, 4096):
+                return
+            while True:
+                data = self.ring_in.get()
+                if data is None:
+                    break
+                yield marshal.loads(data)
+
+class ReplayChannel:
+    """ Recorded messages in, messages for Irssi printed to stdout """
+
+    def __init__(self, path):
+        self.path = path
+        self.out = sys.__stdout__
+
+    def send(self, msg):
+        print(repr(msg), file=self.out, flush=True)
+
+    def messages(self):
+        with open(self.path, 'rb') as f:
+            while True:
+                try:
+                    yield marshal.load(f)
+                except EOFError:
+                    return
+
+class Output:
+    def __init__(self, host, level):
+        self.host = host
+        self.level = level
+        self.buf = []
+
+    def write(self, text):
+        self.buf.append(text)
+        if text.endswith('\n'):
+            text = ''.join(self.buf)[:-1]
+            self.buf = []
+            for line in text.split('\n'):
+                self.host.prnt(line, self.level())
+
+    def flush(self):
+        pass
+
+class Host:
+    def __init__(self, channel, path, argv):
+        self.channel = channel
+        self.path = path
+        self.argv = argv
+        self.constants = {}
+        self.signals = {}
+        self.commands = {}
+
+    def send(self, *msg):
+        self.channel.send(msg)
+
+    def error(self):
+        self.send('error', traceback.format_exc())
+
+    # the stand-in irssi module
+
+    def signal_add(self, signal, func):
+        signal = _bytes(signal)
+        handlers = self.signals.setdefault(signal, [])
+        if not handlers:
+            self.send('signal_add', signal)
+        handlers.append(func)
+
+    def signal_remove(self, signal, func=None):
+        signal = _bytes(signal)
+        handlers = self.signals.get(signal, [])
+        handlers[:] = [h for h in handlers if func is not None and h != func]
+        if not handlers:
+            self.signals.pop(signal, None)
+            self.send('signal_remove', signal)
+
+    def command_bind(self, cmd, func, category=None):
+        cmd = _bytes(cmd)
+        handlers = self.commands.setdefault(cmd, [])
+        if not handlers:
+            self.send('command_bind', cmd, _bytes(category))
+        handlers.append(func)
+
+    def command_unbind(self, cmd, func=None):
+        cmd = _bytes(cmd)
+        handlers = self.commands.get(cmd, [])
+        handlers[:] = [h for h in handlers if func is not None and h != func]
+        if not handlers:
+            self.commands.pop(cmd, None)
+            self.send('command_unbind', cmd)
+
+    def prnt(self, text, level=None, server=None, target=None):
+        if level is None:
+            level = self.constants.get('MSGLEVEL_CLIENTNOTICE', 0)
+        self.send('prnt', _bytes(text), level, _tag(server), _target(target))
+
+    def command(self, cmd, server=None, target=None):
+        self.send('command', _bytes(cmd), _tag(server), _target(target))
+
+    def module(self):
+        irssi = types.ModuleType('irssi')
+        irssi.__dict__.update(self.constants)
+        for name in ('signal_add', 'signal_remove', 'command_bind',
+                     'command_unbind', 'prnt', 'command'):
+            setattr(irssi, name, getattr(self, name))
+        irssi.argv = self.argv
+        irssi.HostObject = HostObject
+        return irssi
+
+    # messages from Irssi
+
+    def load(self, path, argv, constants):
+        self.constants = constants
+        sys.modules['irssi'] = self.module()
+        sys.argv = [self.path] + self.argv
+        sys.stdout = Output(self, lambda: self.constants.get('MSGLEVEL_CLIENTCRAP', 0))
+        sys.stderr = Output(self, lambda: self.constants.get('MSGLEVEL_CLIENTERROR', 0))
+
+        name = os.path.splitext(os.path.basename(self.path))[0]
+        module = types.ModuleType(name)
+        module.__file__ = self.path
+        sys.modules[name] = module
+        sys.path.insert(0, os.path.dirname(os.path.abspath(self.path)))
+        with open(self.path, 'rb') as f:
+            code = compile(f.read(), self.path, 'exec')
+        exec(code, module.__dict__)
+
+    def dispatch(self, handlers, args):
+        for func in list(handlers):
+            try:
+                func(*args)
+            except Exception:
+                self.error()
+
+    def run(self):
+        for op, *args in self.channel.messages():
+            if op == 'load':
+                try:
+                    self.load(*args)
+                except Exception:
+                    self.error()
+                    return 1
+            elif op == 'signal':
+                name, sigargs = args
+                self.dispatch(self.signals.get(name, ()), _import(sigargs))
+            elif op == 'command':
+                name, data, server, witem = args
+                self.dispatch(self.commands.get(name, ()),
+                              (data, _import(server), _import(witem)))
+            elif op == 'unload':
+                break
+        return 0
+
+def main(argv):
+    if len(argv) < 4 or argv[1] not in ('--fds', '--replay'):
+        print(__doc__, file=sys.stderr)
+        return 2
+
+    if argv[1] == '--fds':
+        channel = RingChannel([int(fd) for fd in argv[2].split(',')])
+    else:
+        channel = ReplayChannel(argv[2])
+
+    return Host(channel, argv[3], argv[4:]).run()
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
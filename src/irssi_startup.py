@@ -19,3 +19,7 @@ class Output:
 
 sys.stdout = Output(level = _irssi.MSGLEVEL_CLIENTCRAP)
 sys.stderr = Output(level = _irssi.MSGLEVEL_CLIENTERROR)
+
+# asyncio runs on the Irssi main loop
+import irssi_asyncio
+irssi_asyncio.install()
@@ -31,6 +31,8 @@
 
 static void PyIrssiBase_dealloc(PyIrssiBase *self)
 {
+    py_text_cache_free(&self->text);
+
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
@@ -110,6 +112,8 @@ PyTypeObject PyIrssiBaseType = {
 
 static void PyIrssiChatBase_dealloc(PyIrssiChatBase *self)
 {
+    py_text_cache_free(&self->text);
+
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
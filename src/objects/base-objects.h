@@ -2,17 +2,20 @@
 #define _BASE_OBJECTS_H_
 
 #include <Python.h>
+#include "pyutils.h"
 
 /* data is a pointer to the underlying Irssi record */
 /* base_name is the type name of the object returned from the type member
    it can be SERVER, CHANNEL, QUERY, etc. Note: base_name isn't freed, so
    it cannot point to heap memory */
 /* cleanup_installed: 1 = a cleanup signal handler is installed, 0 = not installed */
+/* text: cached results of RET_AS_TEXT_CACHED(), freed by the dealloc */
 #define PyIrssi_HEAD(type)  \
     PyObject_HEAD           \
     type *data;             \
     const char *base_name;  \
-    int cleanup_installed; 
+    int cleanup_installed;  \
+    PY_TEXT_CACHE *text;
 
 /* for uninheritable objects without a type id (Ban, Log, etc) */
 #define PyIrssiFinal_HEAD(type) \
@@ -63,32 +66,40 @@ extern PyTypeObject PyIrssiChatBaseType;
 
 int base_objects_init(void);
 
+/* false with an exception set if data is gone or this isn't the main 
+   thread; see PY_CHECK_THREAD() */
+static inline int py_check_valid(const void *data)
+{
+    if (!PY_CHECK_THREAD())
+        return 0;
+
+    if (data == NULL)
+    {
+        PyErr_Format(PyExc_RuntimeError, "wrapped object is invalid");
+        return 0;
+    }
+
+    return 1;
+}
+
 #define RET_NULL_IF_INVALID(data)                                              \
-    if (data == NULL)                                                          \
-        return PyErr_Format(PyExc_RuntimeError, "wrapped object is invalid")
+    if (!py_check_valid(data))                                                 \
+        return NULL
 
 #define RET_N1_IF_INVALID(data)                                         \
 do {                                                                    \
-    if (data == NULL)                                                   \
-    {                                                                   \
-        PyErr_Format(PyExc_RuntimeError, "wrapped object is invalid");  \
+    if (!py_check_valid(data))                                          \
         return -1;                                                      \
-    }                                                                   \
 } while (0)
 
-#define RET_AS_STRING_OR_NONE(str)          \
-    do                                      \
-    {                                       \
-        if (str)                            \
-            return PyBytes_FromString(str); \
-        else                                \
-        {                                   \
-            Py_INCREF(Py_None);             \
-            return Py_None;                 \
-        }                                   \
-    } while (0)
-
-#define RET_AS_STRING_OR_EMPTY(str) return PyBytes_FromString(str ? str : "")
+/* bytes, or str for scripts with text_mode 'str' */
+#define RET_AS_STRING_OR_NONE(str) return py_text_new(str)
+
+#define RET_AS_STRING_OR_EMPTY(str) return py_text_new(str ? str : "")
+
+/* as RET_AS_STRING_OR_NONE, reusing the last result while str is the same;
+   slot is one of PY_TEXT_* */
+#define RET_AS_TEXT_CACHED(slot, str) return py_text_cached(&self->text, slot, str)
 
 #define RET_AS_OBJ_OR_NONE(obj) \
 do {                            \
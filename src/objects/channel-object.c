@@ -25,25 +25,13 @@
 #include "channel-object.h"
 #include "pycore.h"
 
-/* monitor "channel destroyed" signal */
-static void chan_cleanup(CHANNEL_REC *chan)
-{
-    PyChannel *pychan = signal_get_user_data();
-
-    if (chan == pychan->data)
-    {
-        pychan->data = NULL;
-        pychan->cleanup_installed = 0;
-        signal_remove_data("channel destroyed", chan_cleanup, pychan);
-    }
-}
-
+/* "channel destroyed" invalidation is handled by the factory */
 static void PyChannel_dealloc(PyChannel *self)
 {
-    if (self->cleanup_installed)
-        signal_remove_data("channel destroyed", chan_cleanup, self);
+    py_irssi_wrapper_remove(self->data, (PyObject *)self);
 
     Py_XDECREF(self->server);
+    py_text_cache_free(&self->text);
 
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
@@ -210,18 +198,18 @@ static PyGetSetDef PyChannel_getseters[] = {
 
 /* Methods */
 PyDoc_STRVAR(PyChannel_nicks_doc,
-    "nicks() -> list of Nick objects\n"
+    "nicks() -> NickList object\n"
     "\n"
-    "Return a list of nicks in the channel.\n"
+    "Return a live view of the nicks in the channel. The view supports\n"
+    "len(), iteration, membership tests and lookup by name, index or slice\n"
+    "(a list); Nick objects are only created for the nicks that are accessed.\n"
+    "Use list(channel.nicks()) for a snapshot.\n"
 );
 static PyObject *PyChannel_nicks(PyChannel *self, PyObject *args)
 {
     RET_NULL_IF_INVALID(self->data);
 
-    GSList *nicks = nicklist_getnicks(self->data);
-    PyObject *obj = py_irssi_chatlist_new(nicks, 1);
-    g_slist_free(nicks);
-    return obj;
+    return pynicklist_new((PyObject *)self);
 }
 
 PyDoc_STRVAR(PyChannel_nicks_find_mask_doc,
@@ -236,7 +224,8 @@ static PyObject *PyChannel_nicks_find_mask(PyChannel *self, PyObject *args, PyOb
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &mask))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &mask))
         return NULL;
 
     return py_irssi_chat_new(nicklist_find_mask(self->data, mask), 1);
@@ -254,7 +243,8 @@ static PyObject *PyChannel_nick_find(PyChannel *self, PyObject *args, PyObject *
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &nick))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &nick))
         return NULL;
 
     return py_irssi_chat_new(nicklist_find(self->data, nick), 1);
@@ -340,13 +330,13 @@ PyObject *pychannel_sub_new(void *chan, const char *name, PyTypeObject *type)
 {
     PyObject *pychan;
 
+    pychan = py_irssi_wrapper_find(chan);
+    if (pychan)
+        return pychan;
+
     pychan = pywindow_item_sub_new(chan, name, type);
     if (pychan)
-    {
-        PyChannel *pych = (PyChannel *)pychan;
-        signal_add_last_data("channel destroyed", chan_cleanup, pych);
-        pych->cleanup_installed = 1;
-    }
+        py_irssi_wrapper_add(chan, pychan);
 
     return pychan;
 }
@@ -0,0 +1,192 @@
+/* 
+    irssi-python
+
+    Copyright (C) 2006 Christopher Davis
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <Python.h>
+#include "pyirssi.h"
+#include "pymodule.h"
+#include "factory.h"
+#include "chatlist-object.h"
+
+/* The GSList belongs to the signal emitter (eg. the nicks of "massjoin"),
+ * so the sequence borrows it and is invalidated by the signal code once the
+ * handler returns. Handlers that want to keep the nicks must copy them out
+ * with list(). 
+ */
+
+#define RET_NULL_IF_EXPIRED(seq)                                                \
+    if (!(seq)->valid)                                                          \
+        return PyErr_Format(PyExc_RuntimeError, "signal argument list has expired")
+
+static void PyChatList_dealloc(PyChatList *self)
+{
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static Py_ssize_t PyChatList_length(PyChatList *self)
+{
+    if (!self->valid)
+    {
+        PyErr_Format(PyExc_RuntimeError, "signal argument list has expired");
+        return -1;
+    }
+
+    return self->length;
+}
+
+static PyObject *PyChatList_item(PyChatList *self, Py_ssize_t i)
+{
+    GSList *node;
+    Py_ssize_t pos;
+
+    RET_NULL_IF_EXPIRED(self);
+
+    if (i < 0 || i >= self->length)
+        return PyErr_Format(PyExc_IndexError, "list index out of range");
+
+    /* continue from the last lookup, so an indexed loop stays linear */
+    if (self->cursor && i >= self->cursor_pos)
+    {
+        node = self->cursor;
+        pos = self->cursor_pos;
+    }
+    else
+    {
+        node = self->list;
+        pos = 0;
+    }
+
+    for (; pos < i; pos++)
+        node = node->next;
+
+    self->cursor = node;
+    self->cursor_pos = pos;
+
+    return py_irssi_chat_new(node->data, 1);
+}
+
+static PyObject *PyChatList_iter(PyChatList *self)
+{
+    PyChatListIter *iter;
+
+    RET_NULL_IF_EXPIRED(self);
+
+    iter = py_inst(PyChatListIter, PyChatListIterType);
+    if (!iter)
+        return NULL;
+
+    iter->owner = (PyObject *)self;
+    Py_INCREF(self);
+    iter->node = self->list;
+
+    return (PyObject *)iter;
+}
+
+static PySequenceMethods PyChatList_as_sequence = {
+    .sq_length = (lenfunc)PyChatList_length,
+    .sq_item   = (ssizeargfunc)PyChatList_item,
+};
+
+PyTypeObject PyChatListType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name        = "irssi.ChatList",                       /*tp_name*/
+    .tp_basicsize   = sizeof(PyChatList),                     /*tp_basicsize*/
+    .tp_dealloc     = (destructor)PyChatList_dealloc,         /*tp_dealloc*/
+    .tp_as_sequence = &PyChatList_as_sequence,                /*tp_as_sequence*/
+    .tp_flags       = Py_TPFLAGS_DEFAULT,                     /*tp_flags*/
+    .tp_doc         = "List of objects passed to a signal, valid until the handler returns", /* tp_doc */
+    .tp_iter        = (getiterfunc)PyChatList_iter,           /* tp_iter */
+};
+
+static void PyChatListIter_dealloc(PyChatListIter *self)
+{
+    Py_XDECREF(self->owner);
+
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *PyChatListIter_next(PyChatListIter *self)
+{
+    PyChatList *owner = (PyChatList *)self->owner;
+    GSList *node = self->node;
+
+    RET_NULL_IF_EXPIRED(owner);
+
+    if (!node)
+        return NULL;
+
+    self->node = node->next;
+    return py_irssi_chat_new(node->data, 1);
+}
+
+PyTypeObject PyChatListIterType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name      = "irssi.ChatListIter",                     /*tp_name*/
+    .tp_basicsize = sizeof(PyChatListIter),                   /*tp_basicsize*/
+    .tp_dealloc   = (destructor)PyChatListIter_dealloc,       /*tp_dealloc*/
+    .tp_flags     = Py_TPFLAGS_DEFAULT,                       /*tp_flags*/
+    .tp_doc       = "ChatList iterator",                      /* tp_doc */
+    .tp_iter      = PyObject_SelfIter,                        /* tp_iter */
+    .tp_iternext  = (iternextfunc)PyChatListIter_next,        /* tp_iternext */
+};
+
+/* chatlist factory function */
+PyObject *pychatlist_new(GSList *list)
+{
+    PyChatList *seq;
+
+    seq = py_inst(PyChatList, PyChatListType);
+    if (!seq)
+        return NULL;
+
+    seq->valid = 1;
+    seq->list = list;
+    seq->length = g_slist_length(list);
+
+    return (PyObject *)seq;
+}
+
+/* called when the signal returns; the list may be freed after this */
+void pychatlist_invalidate(PyObject *obj)
+{
+    PyChatList *seq = (PyChatList *)obj;
+
+    g_return_if_fail(pychatlist_check(obj));
+
+    seq->valid = 0;
+    seq->list = NULL;
+    seq->cursor = NULL;
+    seq->length = 0;
+}
+
+int chatlist_object_init(void)
+{
+    g_return_val_if_fail(py_module != NULL, 0);
+
+    if (PyType_Ready(&PyChatListType) < 0)
+        return 0;
+
+    if (PyType_Ready(&PyChatListIterType) < 0)
+        return 0;
+
+    Py_INCREF(&PyChatListType);
+    PyModule_AddObject(py_module, "ChatList", (PyObject *)&PyChatListType);
+
+    return 1;
+}
@@ -0,0 +1,33 @@
+#ifndef _CHATLIST_OBJECT_H_
+#define _CHATLIST_OBJECT_H_
+
+#include <Python.h>
+
+/* Sequence over a GSList of chat objects that only lives as long as the
+   signal emission it was passed to. Wrappers are created on access. */
+typedef struct
+{
+    PyObject_HEAD
+    int valid;              /* cleared when the signal returns */
+    GSList *list;           /* borrowed from the signal emitter */
+    Py_ssize_t length;
+    GSList *cursor;         /* last node looked up by index */
+    Py_ssize_t cursor_pos;
+} PyChatList;
+
+typedef struct
+{
+    PyObject_HEAD
+    PyObject *owner;        /* the PyChatList being iterated */
+    GSList *node;
+} PyChatListIter;
+
+extern PyTypeObject PyChatListType;
+extern PyTypeObject PyChatListIterType;
+
+int chatlist_object_init(void);
+PyObject *pychatlist_new(GSList *list);
+void pychatlist_invalidate(PyObject *obj);
+#define pychatlist_check(op) PyObject_TypeCheck(op, &PyChatListType)
+
+#endif
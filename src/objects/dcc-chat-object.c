@@ -79,7 +79,8 @@ static PyObject *PyDccChat_chat_send(PyDccChat *self, PyObject *args, PyObject *
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &data))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &data))
         return NULL;
 
     dcc_chat_send(self->data, data);
@@ -38,6 +38,24 @@
 
 GHashTable *init_map = NULL;
 
+/* Map: Irssi record -> wrapper object (borrowed reference) */
+static GHashTable *wrapper_map = NULL;
+
+/* Irssi records are only touched on the main thread, but the last reference
+ * to a wrapper can go away on any thread (run_in_worker(), script threads),
+ * and its dealloc removes it from the map there. A wrapper found in the map
+ * is only safe to use while the lock is held, or through a reference taken
+ * with wrapper_ref().
+ */
+#ifdef Py_GIL_DISABLED
+static PyMutex wrapper_lock;
+#define WRAPPER_LOCK() PyMutex_Lock(&wrapper_lock)
+#define WRAPPER_UNLOCK() PyMutex_Unlock(&wrapper_lock)
+#else
+#define WRAPPER_LOCK()
+#define WRAPPER_UNLOCK()
+#endif
+
 static int init_objects(void);
 static void register_chat(CHAT_PROTOCOL_REC *rec);
 static void unregister_chat(CHAT_PROTOCOL_REC *rec);
@@ -45,6 +63,9 @@ static void insert_map(int type, int chat_type, InitFunc func);
 static int remove_chat(void *key, void *value, void *chat_typep);
 static void register_nonchat(void);
 static InitFunc find_map(int type, int chat_type);
+static PyObject *wrapper_ref(PyObject *obj);
+static PyObject *wrapper_steal(void *rec);
+static void wrapper_invalidate(void *rec);
 
 static int init_objects(void)
 {
@@ -85,6 +106,24 @@ static int init_objects(void)
     if (!nick_object_init())
         return 0;
 
+    if (!nicklist_object_init())
+        return 0;
+
+    if (!chatlist_object_init())
+        return 0;
+
+    if (!strlist_object_init())
+        return 0;
+
+    if (!ircmessage_object_init())
+        return 0;
+
+    if (!strview_object_init())
+        return 0;
+
+    if (!signal_object_init())
+        return 0;
+
     if (!chatnet_object_init())
         return 0;
 
@@ -267,6 +306,144 @@ static void unregister_chat(CHAT_PROTOCOL_REC *rec)
             GINT_TO_POINTER(rec->id));
 }
 
+PyObject *py_irssi_wrapper_find(void *rec)
+{
+    PyObject *obj;
+
+    g_return_val_if_fail(wrapper_map != NULL, NULL);
+
+    WRAPPER_LOCK();
+    obj = g_hash_table_lookup(wrapper_map, rec);
+    if (obj)
+        obj = wrapper_ref(obj);
+    WRAPPER_UNLOCK();
+
+    return obj;
+}
+
+void py_irssi_wrapper_add(void *rec, PyObject *obj)
+{
+    PyObject *old;
+
+    g_return_if_fail(wrapper_map != NULL);
+
+    if (rec == NULL)
+        return;
+
+#if defined(Py_GIL_DISABLED) && PY_VERSION_HEX >= 0x030E0000
+    PyUnstable_EnableTryIncRef(obj);
+#endif
+
+    /* a stale wrapper must not keep pointing at the record once it is 
+       no longer tracked */
+    old = wrapper_steal(rec);
+    if (old)
+    {
+        ((PyIrssiObject *)old)->data = NULL;
+        Py_DECREF(old);
+    }
+
+    WRAPPER_LOCK();
+    g_hash_table_insert(wrapper_map, rec, obj);
+    WRAPPER_UNLOCK();
+}
+
+void py_irssi_wrapper_remove(void *rec, PyObject *obj)
+{
+    /* invalidated wrappers have already been removed. The map itself can 
+       be gone while Python shuts down */
+    if (rec == NULL)
+        return;
+
+    WRAPPER_LOCK();
+    if (wrapper_map && g_hash_table_lookup(wrapper_map, rec) == obj)
+        g_hash_table_remove(wrapper_map, rec);
+    WRAPPER_UNLOCK();
+}
+
+/* new reference to a wrapper from the map, taken with the lock held; NULL 
+   if another thread is already destroying it */
+static PyObject *wrapper_ref(PyObject *obj)
+{
+#if defined(Py_GIL_DISABLED) && PY_VERSION_HEX >= 0x030E0000
+    if (!PyUnstable_TryIncRef(obj))
+        return NULL;
+    return obj;
+#else
+#ifdef Py_GIL_DISABLED
+    /* its dealloc is waiting for the lock to remove it. 3.13 has no 
+       TryIncRef, a reference dropped right now can still slip through */
+    if (Py_REFCNT(obj) == 0)
+        return NULL;
+#endif
+    Py_INCREF(obj);
+    return obj;
+#endif
+}
+
+/* remove rec from the map and return a new reference to its wrapper, if any */
+static PyObject *wrapper_steal(void *rec)
+{
+    PyObject *obj;
+
+    WRAPPER_LOCK();
+    obj = g_hash_table_lookup(wrapper_map, rec);
+    if (obj)
+    {
+        g_hash_table_remove(wrapper_map, rec);
+        obj = wrapper_ref(obj);
+    }
+    WRAPPER_UNLOCK();
+
+    return obj;
+}
+
+static void wrapper_invalidate(void *rec)
+{
+    PyObject *obj = wrapper_steal(rec);
+
+    if (obj)
+    {
+        ((PyIrssiObject *)obj)->data = NULL;
+        Py_DECREF(obj);
+    }
+}
+
+static void wrapper_clear(void *rec, PyIrssiObject *obj, void *data)
+{
+    obj->data = NULL;
+}
+
+/* monitor "channel destroyed" and "window destroyed" signals */
+static void sig_wrapper_destroyed(void *rec)
+{
+    wrapper_invalidate(rec);
+}
+
+/* monitor "nicklist remove" signal */
+static void sig_nick_removed(CHANNEL_REC *chan, NICK_REC *nick)
+{
+    wrapper_invalidate(nick);
+}
+
+/* monitor "server disconnected" signal */
+static void sig_server_disconnected(SERVER_REC *server)
+{
+    PyServer *pyserver = (PyServer *)wrapper_steal(server);
+
+    if (!pyserver)
+        return;
+
+    if (pyserver->connect)
+        ((PyConnect *)pyserver->connect)->data = NULL;
+
+    if (pyserver->rawlog)
+        ((PyRawlog *)pyserver->rawlog)->data = NULL;
+
+    pyserver->data = NULL;
+    Py_DECREF(pyserver);
+}
+
 PyObject *py_irssi_new(void *typeobj, int managed)
 {
     IRSSI_BASE_REC *base = typeobj;
@@ -333,10 +510,17 @@ error:
 int factory_init(void)
 {
     g_return_val_if_fail(init_map == NULL, 0);
+    g_return_val_if_fail(wrapper_map == NULL, 0);
 
     if (!init_objects())
         return 0;
 
+    wrapper_map = g_hash_table_new(g_direct_hash, g_direct_equal);
+    signal_add_last("channel destroyed", (SIGNAL_FUNC) sig_wrapper_destroyed);
+    signal_add_last("window destroyed", (SIGNAL_FUNC) sig_wrapper_destroyed);
+    signal_add_last("nicklist remove", (SIGNAL_FUNC) sig_nick_removed);
+    signal_add_last("server disconnected", (SIGNAL_FUNC) sig_server_disconnected);
+
     init_map = g_hash_table_new(g_direct_hash, g_direct_equal);
  	g_slist_foreach(chat_protocols, (GFunc) register_chat, NULL);
     register_nonchat();
@@ -356,5 +540,17 @@ void factory_deinit(void)
 
 	signal_remove("chat protocol created", (SIGNAL_FUNC) register_chat);
 	signal_remove("chat protocol destroyed", (SIGNAL_FUNC) unregister_chat);
+
+    signal_remove("channel destroyed", (SIGNAL_FUNC) sig_wrapper_destroyed);
+    signal_remove("window destroyed", (SIGNAL_FUNC) sig_wrapper_destroyed);
+    signal_remove("nicklist remove", (SIGNAL_FUNC) sig_nick_removed);
+    signal_remove("server disconnected", (SIGNAL_FUNC) sig_server_disconnected);
+
+    /* wrappers still alive are invalidated; their dealloc sees map == NULL */
+    WRAPPER_LOCK();
+    g_hash_table_foreach(wrapper_map, (GHFunc)wrapper_clear, NULL);
+    g_hash_table_destroy(wrapper_map);
+    wrapper_map = NULL;
+    WRAPPER_UNLOCK();
 }
 
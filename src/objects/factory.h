@@ -14,6 +14,12 @@
 #include "irc-channel-object.h"
 #include "ban-object.h"
 #include "nick-object.h"
+#include "nicklist-object.h"
+#include "chatlist-object.h"
+#include "strlist-object.h"
+#include "ircmessage-object.h"
+#include "strview-object.h"
+#include "signal-object.h"
 #include "chatnet-object.h"
 #include "reconnect-object.h"
 #include "window-object.h"
@@ -50,6 +56,19 @@ PyObject *py_irssi_new(void *typeobj, int managed);
 /* For objects with both type and chat_type members */
 PyObject *py_irssi_chat_new(void *typeobj, int managed);
 
+/* Wrapper identity map.
+ * Channel, Nick, Server and Window wrappers are registered under their
+ * Irssi record by their factory functions, so the same record always maps 
+ * to the same Python object. The factory installs a single "destroyed" 
+ * handler per record type that invalidates the wrapper through this map,
+ * so these wrappers don't install cleanup handlers of their own.
+ */
+/* returns new reference to the live wrapper for rec, or NULL */
+PyObject *py_irssi_wrapper_find(void *rec);
+void py_irssi_wrapper_add(void *rec, PyObject *obj);
+/* for the wrapper's dealloc */
+void py_irssi_wrapper_remove(void *rec, PyObject *obj);
+
 typedef PyObject *(*InitFunc)(void *, int);
 PyObject *py_irssi_objlist_new(GSList *node, int managed, InitFunc init);
 #define py_irssi_chatlist_new(n, m) py_irssi_objlist_new(n, m, py_irssi_chat_new)
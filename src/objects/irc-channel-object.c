@@ -59,8 +59,8 @@ static PyObject *PyIrcChannel_ban_get_mask(PyIrcChannel *self, PyObject *args, P
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y|i", kwlist, &nick,
-                                     &ban_type))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|i", kwlist,
+                                     py_str_conv, &nick, &ban_type))
         return NULL;
 
     str = ban_get_mask(self->data, nick, ban_type);
@@ -87,7 +87,8 @@ static PyObject *PyIrcChannel_banlist_add(PyIrcChannel *self, PyObject *args, Py
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyk", kwlist, &ban, &nick,
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&k", kwlist,
+                                     py_str_conv, &ban, py_str_conv, &nick,
                                      &btime))
         return NULL;
 
@@ -111,7 +112,8 @@ static PyObject *PyIrcChannel_banlist_remove(PyIrcChannel *self, PyObject *args,
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yy", kwlist, &ban, &nick))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&", kwlist,
+                                     py_str_conv, &ban, py_str_conv, &nick))
         return NULL;
 
     banlist_remove(self->data, ban, nick);
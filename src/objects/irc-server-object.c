@@ -100,7 +100,8 @@ static PyObject *PyIrcServer_get_channels(PyIrcServer *self, PyObject *args, PyO
 
     RET_NULL_IF_INVALID(self->data);
 
-    PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &rejoin_channels_mode);
+    PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                py_str_conv, &rejoin_channels_mode);
     setting = settings_get_record("rejoin_channels_on_reconnect");
     mode = strarray_find(setting->choices, rejoin_channels_mode);
     if (mode < 0)
@@ -127,7 +128,7 @@ static PyObject *PyIrcServer_send_raw(PyIrcServer *self, PyObject *args, PyObjec
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &cmd))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &cmd))
         return NULL;
 
     irc_send_cmd(self->data, cmd);
@@ -147,7 +148,7 @@ static PyObject *PyIrcServer_send_raw_now(PyIrcServer *self, PyObject *args, PyO
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &cmd))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &cmd))
         return NULL;
 
     irc_send_cmd_now(self->data, cmd);
@@ -176,8 +177,8 @@ static PyObject *PyIrcServer_send_raw_split(PyIrcServer *self, PyObject *args, P
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yii", kwlist, &cmd, &nickarg,
-                                     &max_nicks))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&ii", kwlist,
+                                     py_str_conv, &cmd, &nickarg, &max_nicks))
         return NULL;
 
     irc_send_cmd_split(self->data, cmd, nickarg, max_nicks);
@@ -200,7 +201,8 @@ static PyObject *PyIrcServer_ctcp_send_reply(PyIrcServer *self, PyObject *args,
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &data))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &data))
         return NULL;
 
     ctcp_send_reply(self->data, data);
@@ -226,7 +228,8 @@ static PyObject *PyIrcServer_isupport(PyIrcServer *self, PyObject *args, PyObjec
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &name))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &name))
         return NULL;
 
     found = g_hash_table_lookup(self->data->isupport, name);
@@ -249,7 +252,8 @@ static PyObject *PyIrcServer_netsplit_find(PyIrcServer *self, PyObject *args, Py
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yy", kwlist, &nick, &address))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&", kwlist,
+                                     py_str_conv, &nick, py_str_conv, &address))
         return NULL;
 
     ns = netsplit_find(self->data, nick, address);
@@ -274,8 +278,9 @@ static PyObject *PyIrcServer_netsplit_find_channel(PyIrcServer *self, PyObject *
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyy", kwlist, &nick, &address,
-                                     &channel))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&O&", kwlist,
+                                     py_str_conv, &nick, py_str_conv, &address,
+                                     py_str_conv, &channel))
         return NULL;
 
     nsc = netsplit_find_channel(self->data, nick, address, channel);
@@ -297,7 +302,8 @@ static PyObject *PyIrcServer_notifylist_ison(PyIrcServer *self, PyObject *args,
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &nick))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &nick))
         return NULL;
 
     return PyBool_FromLong(notifylist_ison_server(self->data, nick));
@@ -396,9 +402,9 @@ static PyObject *PyIrcServer_redirect_event(PyIrcServer *self, PyObject *args, P
     
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yO|ziiz", kwlist, &command,
-                                     &signals, &arg, &count, &remote,
-                                     &failure_signal))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O|ziiz", kwlist,
+                                     py_str_conv, &command, &signals, &arg,
+                                     &count, &remote, &failure_signal))
         return NULL;
 
     gsignals = py_event_conv(signals);
@@ -422,8 +428,9 @@ static PyObject *PyIrcServer_redirect_get_signal(PyIrcServer *self, PyObject *ar
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyy", kwlist, &prefix, &event,
-                                     &pargs))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&O&", kwlist,
+                                     py_str_conv, &prefix, py_str_conv, &event,
+                                     py_str_conv, &pargs))
         return NULL;
 
     RET_AS_STRING_OR_NONE(server_redirect_get_signal(self->data, prefix, event, pargs));
@@ -442,8 +449,9 @@ static PyObject *PyIrcServer_redirect_peek_signal(PyIrcServer *self, PyObject *a
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyy", kwlist, &prefix, &event,
-                                     &pargs))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&O&", kwlist,
+                                     py_str_conv, &prefix, py_str_conv, &event,
+                                     py_str_conv, &pargs))
         return NULL;
 
     RET_AS_STRING_OR_NONE(server_redirect_peek_signal(self->data, prefix, event, pargs, &redirection));
@@ -0,0 +1,681 @@
+/* 
+    irssi-python
+
+    Copyright (C) 2006 Christopher Davis
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <Python.h>
+#include <string.h>
+#include "pyirssi.h"
+#include "pymodule.h"
+#include "factory.h"
+#include "ircmessage-object.h"
+
+/* Handlers of "server event" and "event <cmd>" get the line as bytes and
+ * would have to take it apart in Python for every message. An IrcMessage
+ * keeps a reference to the same bytes object and only finds where the 
+ * parts are, in one pass, the first time a field is read; the field 
+ * objects are built when asked for and then cached. In text mode the
+ * line is still parsed as bytes, and only the fields are decoded.
+ *
+ *     @tag=value;tag2 :nick!user@host COMMAND middle params :trailing
+ */
+
+#define IS_SPACE(c) ((c) == ' ')
+
+static Py_ssize_t skip_spaces(const char *s, Py_ssize_t i, Py_ssize_t len)
+{
+    while (i < len && IS_SPACE(s[i]))
+        i++;
+    return i;
+}
+
+static Py_ssize_t find_space(const char *s, Py_ssize_t i, Py_ssize_t len)
+{
+    const char *p = memchr(s + i, ' ', len - i);
+    return p? p - s : len;
+}
+
+static void ircmessage_parse(PyIrcMessage *self)
+{
+    const char *s = PyBytes_AS_STRING(self->line);
+    Py_ssize_t len = PyBytes_GET_SIZE(self->line);
+    Py_ssize_t i = 0;
+
+    if (self->parsed)
+        return;
+    self->parsed = 1;
+
+    self->tags_start = self->tags_end = 0;
+    if (len > 0 && s[0] == '@')
+    {
+        self->tags_start = 1;
+        self->tags_end = find_space(s, 1, len);
+        i = skip_spaces(s, self->tags_end, len);
+    }
+
+    self->prefix_start = self->prefix_end = i;
+    if (i < len && s[i] == ':')
+    {
+        self->prefix_start = i + 1;
+        self->prefix_end = find_space(s, i + 1, len);
+        i = skip_spaces(s, self->prefix_end, len);
+    }
+
+    /* "event <cmd>" lines start with the parameters */
+    self->command_start = self->command_end = i;
+    if (!self->command_arg)
+    {
+        self->command_end = find_space(s, i, len);
+        i = skip_spaces(s, self->command_end, len);
+    }
+
+    self->params_start = i;
+    self->trailing_start = -1;
+    while (i < len)
+    {
+        if (s[i] == ':')
+        {
+            self->trailing_start = i + 1;
+            break;
+        }
+
+        i = skip_spaces(s, find_space(s, i, len), len);
+    }
+}
+
+static PyObject *field_new(PyIrcMessage *self, const char *str, Py_ssize_t len)
+{
+    if (self->text)
+        return py_text_decode(str, len);
+
+    return PyBytes_FromStringAndSize(str, len);
+}
+
+/* steals a reference to bytes, for fields not cut from the line */
+static PyObject *field_text(PyIrcMessage *self, PyObject *bytes)
+{
+    PyObject *ret;
+
+    if (!self->text || !bytes || !PyBytes_Check(bytes))
+        return bytes;
+
+    ret = py_text_decode(PyBytes_AS_STRING(bytes), PyBytes_GET_SIZE(bytes));
+    Py_DECREF(bytes);
+    return ret;
+}
+
+static PyObject *slice(PyIrcMessage *self, Py_ssize_t start, Py_ssize_t end)
+{
+    return field_new(self, PyBytes_AS_STRING(self->line) + start, end - start);
+}
+
+/* IRCv3 tag value escapes: \: \s \\ \r \n, any other \x is x and a 
+   trailing \ is dropped */
+static PyObject *tag_value(const char *value, Py_ssize_t len)
+{
+    PyObject *ret;
+    char *out;
+    Py_ssize_t i, j;
+
+    if (!memchr(value, '\\', len))
+        return PyBytes_FromStringAndSize(value, len);
+
+    ret = PyBytes_FromStringAndSize(NULL, len);
+    if (!ret)
+        return NULL;
+
+    out = PyBytes_AS_STRING(ret);
+    for (i = 0, j = 0; i < len; i++)
+    {
+        if (value[i] != '\\')
+        {
+            out[j++] = value[i];
+            continue;
+        }
+
+        if (++i == len)
+            break;
+
+        switch (value[i])
+        {
+            case ':': out[j++] = ';'; break;
+            case 's': out[j++] = ' '; break;
+            case 'r': out[j++] = '\r'; break;
+            case 'n': out[j++] = '\n'; break;
+            default: out[j++] = value[i]; break;
+        }
+    }
+
+    if (_PyBytes_Resize(&ret, j) < 0)
+        return NULL;
+
+    return ret;
+}
+
+static PyObject *ircmessage_tags(PyIrcMessage *self)
+{
+    const char *s = PyBytes_AS_STRING(self->line);
+    PyObject *dict;
+    Py_ssize_t i = self->tags_start;
+
+    dict = PyDict_New();
+    if (!dict)
+        return NULL;
+
+    while (i < self->tags_end)
+    {
+        const char *tag = s + i;
+        const char *end = memchr(tag, ';', self->tags_end - i);
+        const char *eq;
+        Py_ssize_t taglen = end? end - tag : self->tags_end - i;
+        PyObject *key, *value;
+        int ret;
+
+        i += taglen + 1;
+        if (taglen == 0)
+            continue;
+
+        /* no value and an empty value are the same */
+        eq = memchr(tag, '=', taglen);
+        key = field_new(self, tag, eq? eq - tag : taglen);
+        if (!key)
+            goto error;
+
+        value = eq? tag_value(eq + 1, taglen - (eq + 1 - tag)) : PyBytes_FromStringAndSize("", 0);
+        value = field_text(self, value);
+        if (!value)
+        {
+            Py_DECREF(key);
+            goto error;
+        }
+
+        ret = PyDict_SetItem(dict, key, value);
+        Py_DECREF(key);
+        Py_DECREF(value);
+        if (ret < 0)
+            goto error;
+    }
+
+    return dict;
+
+error:
+    Py_DECREF(dict);
+    return NULL;
+}
+
+static PyObject *field_or_none(PyIrcMessage *self, const char *start, const char *end)
+{
+    if (!start)
+    {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    return field_new(self, start, end - start);
+}
+
+/* nick, user and host from the prefix, or from the nick and address given
+   with the line */
+static int ircmessage_source(PyIrcMessage *self)
+{
+    const char *src, *end = NULL, *user = NULL, *host = NULL, *at;
+
+    if (self->nick)
+        return 1;
+
+    if (self->nick_arg)
+    {
+        Py_INCREF(self->nick_arg);
+        self->nick = field_text(self, self->nick_arg);
+        if (!self->nick)
+            return 0;
+
+        /* the address is user@host */
+        if (self->address_arg && PyBytes_GET_SIZE(self->address_arg))
+        {
+            user = PyBytes_AS_STRING(self->address_arg);
+            end = user + PyBytes_GET_SIZE(self->address_arg);
+        }
+    }
+    else
+    {
+        const char *bang;
+
+        src = PyBytes_AS_STRING(self->line) + self->prefix_start;
+        end = PyBytes_AS_STRING(self->line) + self->prefix_end;
+        bang = memchr(src, '!', end - src);
+        at = memchr(src, '@', end - src);
+
+        if (src == end)
+            self->nick = field_or_none(self, NULL, NULL);
+        else
+            self->nick = field_or_none(self, src, bang? bang : at? at : end);
+        if (!self->nick)
+            return 0;
+
+        if (bang)
+            user = bang + 1;
+        else if (at)
+            host = at + 1;
+    }
+
+    if (user && (at = memchr(user, '@', end - user)))
+    {
+        host = at + 1;
+        self->user = field_or_none(self, user, at);
+    }
+    else
+        self->user = field_or_none(self, user, end);
+    self->host = field_or_none(self, host, end);
+
+    if (!self->user || !self->host)
+    {
+        Py_CLEAR(self->nick);
+        Py_CLEAR(self->user);
+        Py_CLEAR(self->host);
+        return 0;
+    }
+
+    return 1;
+}
+
+static PyObject *ircmessage_params(PyIrcMessage *self)
+{
+    const char *s = PyBytes_AS_STRING(self->line);
+    Py_ssize_t len = PyBytes_GET_SIZE(self->line);
+    Py_ssize_t middle_end = self->trailing_start < 0? len : self->trailing_start - 1;
+    Py_ssize_t i, count = 0;
+    PyObject *params;
+
+    for (i = self->params_start; i < middle_end; count++)
+        i = skip_spaces(s, find_space(s, i, middle_end), middle_end);
+    if (self->trailing_start >= 0)
+        count++;
+
+    params = PyTuple_New(count);
+    if (!params)
+        return NULL;
+
+    for (i = self->params_start, count = 0; i < middle_end; count++)
+    {
+        Py_ssize_t end = find_space(s, i, middle_end);
+        PyObject *param = slice(self, i, end);
+
+        if (!param)
+            goto error;
+        PyTuple_SET_ITEM(params, count, param);
+
+        i = skip_spaces(s, end, middle_end);
+    }
+
+    if (self->trailing_start >= 0)
+    {
+        PyObject *param = slice(self, self->trailing_start, len);
+
+        if (!param)
+            goto error;
+        PyTuple_SET_ITEM(params, count, param);
+    }
+
+    return params;
+
+error:
+    Py_DECREF(params);
+    return NULL;
+}
+
+static void PyIrcMessage_dealloc(PyIrcMessage *self)
+{
+    Py_XDECREF(self->line);
+    Py_XDECREF(self->command_arg);
+    Py_XDECREF(self->nick_arg);
+    Py_XDECREF(self->address_arg);
+    Py_XDECREF(self->raw);
+    Py_XDECREF(self->tags);
+    Py_XDECREF(self->prefix);
+    Py_XDECREF(self->nick);
+    Py_XDECREF(self->user);
+    Py_XDECREF(self->host);
+    Py_XDECREF(self->command);
+    Py_XDECREF(self->params);
+    Py_XDECREF(self->trailing);
+
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+/* new reference to obj as bytes, str is encoded as UTF-8; NULL for None */
+static int opt_bytes(PyObject **obj, const char *name)
+{
+    if (*obj == Py_None)
+        *obj = NULL;
+
+    if (!*obj)
+        return 1;
+
+    if (PyUnicode_Check(*obj))
+    {
+        *obj = PyUnicode_AsUTF8String(*obj);
+        return *obj != NULL;
+    }
+
+    if (!PyBytes_Check(*obj))
+    {
+        PyErr_Format(PyExc_TypeError, "%s must be bytes, str or None", name);
+        *obj = NULL;
+        return 0;
+    }
+
+    Py_INCREF(*obj);
+    return 1;
+}
+
+static PyObject *PyIrcMessage_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"line", "command", "nick", "address", NULL};
+    PyObject *line, *command = NULL, *nick = NULL, *address = NULL;
+    PyObject *ret = NULL;
+    int text;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|OOO", kwlist, &line, 
+                &command, &nick, &address))
+        return NULL;
+
+    if (line == Py_None)
+        return PyErr_Format(PyExc_TypeError, "line must be bytes or str");
+
+    /* a str line gives str fields */
+    text = PyUnicode_Check(line);
+
+    if (!opt_bytes(&line, "line"))
+        return NULL;
+
+    if (opt_bytes(&command, "command") && opt_bytes(&nick, "nick") && 
+            opt_bytes(&address, "address"))
+        ret = pyircmessage_new(line, command, nick, address, text);
+
+    Py_DECREF(line);
+    Py_XDECREF(command);
+    Py_XDECREF(nick);
+    Py_XDECREF(address);
+    return ret;
+}
+
+/* Getters */
+PyDoc_STRVAR(PyIrcMessage_raw_doc,
+    "The line as given"
+);
+static PyObject *PyIrcMessage_raw_get(PyIrcMessage *self, void *closure)
+{
+    if (!self->raw)
+    {
+        Py_INCREF(self->line);
+        self->raw = field_text(self, self->line);
+        if (!self->raw)
+            return NULL;
+    }
+
+    Py_INCREF(self->raw);
+    return self->raw;
+}
+
+PyDoc_STRVAR(PyIrcMessage_tags_doc,
+    "IRCv3 message tags, read-only mapping of unescaped values"
+);
+static PyObject *PyIrcMessage_tags_get(PyIrcMessage *self, void *closure)
+{
+    ircmessage_parse(self);
+
+    if (!self->tags)
+    {
+        PyObject *dict = ircmessage_tags(self);
+
+        if (!dict)
+            return NULL;
+
+        self->tags = PyDictProxy_New(dict);
+        Py_DECREF(dict);
+        if (!self->tags)
+            return NULL;
+    }
+
+    Py_INCREF(self->tags);
+    return self->tags;
+}
+
+PyDoc_STRVAR(PyIrcMessage_prefix_doc,
+    "Source of the message, nick!user@host or a server name; None if missing"
+);
+static PyObject *PyIrcMessage_prefix_get(PyIrcMessage *self, void *closure)
+{
+    ircmessage_parse(self);
+
+    if (!self->prefix)
+    {
+        if (self->nick_arg && self->address_arg && PyBytes_GET_SIZE(self->address_arg))
+            self->prefix = field_text(self, PyBytes_FromFormat("%s!%s", 
+                        PyBytes_AS_STRING(self->nick_arg), PyBytes_AS_STRING(self->address_arg)));
+        else if (self->nick_arg)
+        {
+            Py_INCREF(self->nick_arg);
+            self->prefix = field_text(self, self->nick_arg);
+        }
+        else if (self->prefix_end > self->prefix_start)
+            self->prefix = slice(self, self->prefix_start, self->prefix_end);
+        else
+        {
+            self->prefix = Py_None;
+            Py_INCREF(Py_None);
+        }
+
+        if (!self->prefix)
+            return NULL;
+    }
+
+    Py_INCREF(self->prefix);
+    return self->prefix;
+}
+
+PyDoc_STRVAR(PyIrcMessage_nick_doc,
+    "Nick (or server name) of the prefix; None if missing"
+);
+static PyObject *PyIrcMessage_nick_get(PyIrcMessage *self, void *closure)
+{
+    ircmessage_parse(self);
+    if (!ircmessage_source(self))
+        return NULL;
+
+    Py_INCREF(self->nick);
+    return self->nick;
+}
+
+PyDoc_STRVAR(PyIrcMessage_user_doc,
+    "User name of the prefix; None if missing"
+);
+static PyObject *PyIrcMessage_user_get(PyIrcMessage *self, void *closure)
+{
+    ircmessage_parse(self);
+    if (!ircmessage_source(self))
+        return NULL;
+
+    Py_INCREF(self->user);
+    return self->user;
+}
+
+PyDoc_STRVAR(PyIrcMessage_host_doc,
+    "Host of the prefix; None if missing"
+);
+static PyObject *PyIrcMessage_host_get(PyIrcMessage *self, void *closure)
+{
+    ircmessage_parse(self);
+    if (!ircmessage_source(self))
+        return NULL;
+
+    Py_INCREF(self->host);
+    return self->host;
+}
+
+PyDoc_STRVAR(PyIrcMessage_command_doc,
+    "Command or numeric, upper case as sent; None if missing"
+);
+static PyObject *PyIrcMessage_command_get(PyIrcMessage *self, void *closure)
+{
+    ircmessage_parse(self);
+
+    if (!self->command)
+    {
+        if (self->command_arg)
+        {
+            Py_INCREF(self->command_arg);
+            self->command = field_text(self, self->command_arg);
+        }
+        else if (self->command_end > self->command_start)
+            self->command = slice(self, self->command_start, self->command_end);
+        else
+        {
+            self->command = Py_None;
+            Py_INCREF(Py_None);
+        }
+
+        if (!self->command)
+            return NULL;
+    }
+
+    Py_INCREF(self->command);
+    return self->command;
+}
+
+PyDoc_STRVAR(PyIrcMessage_params_doc,
+    "Tuple of the parameters, the trailing one included"
+);
+static PyObject *PyIrcMessage_params_get(PyIrcMessage *self, void *closure)
+{
+    ircmessage_parse(self);
+
+    if (!self->params && !(self->params = ircmessage_params(self)))
+        return NULL;
+
+    Py_INCREF(self->params);
+    return self->params;
+}
+
+PyDoc_STRVAR(PyIrcMessage_trailing_doc,
+    "The parameter after ' :', usually the text; None if there is none"
+);
+static PyObject *PyIrcMessage_trailing_get(PyIrcMessage *self, void *closure)
+{
+    ircmessage_parse(self);
+
+    if (!self->trailing)
+    {
+        if (self->trailing_start >= 0)
+            self->trailing = slice(self, self->trailing_start, PyBytes_GET_SIZE(self->line));
+        else
+        {
+            self->trailing = Py_None;
+            Py_INCREF(Py_None);
+        }
+
+        if (!self->trailing)
+            return NULL;
+    }
+
+    Py_INCREF(self->trailing);
+    return self->trailing;
+}
+
+/* specialized getters/setters */
+static PyGetSetDef PyIrcMessage_getseters[] = {
+    {"raw", (getter)PyIrcMessage_raw_get, NULL,
+        PyIrcMessage_raw_doc, NULL},
+    {"tags", (getter)PyIrcMessage_tags_get, NULL,
+        PyIrcMessage_tags_doc, NULL},
+    {"prefix", (getter)PyIrcMessage_prefix_get, NULL,
+        PyIrcMessage_prefix_doc, NULL},
+    {"nick", (getter)PyIrcMessage_nick_get, NULL,
+        PyIrcMessage_nick_doc, NULL},
+    {"user", (getter)PyIrcMessage_user_get, NULL,
+        PyIrcMessage_user_doc, NULL},
+    {"host", (getter)PyIrcMessage_host_get, NULL,
+        PyIrcMessage_host_doc, NULL},
+    {"command", (getter)PyIrcMessage_command_get, NULL,
+        PyIrcMessage_command_doc, NULL},
+    {"params", (getter)PyIrcMessage_params_get, NULL,
+        PyIrcMessage_params_doc, NULL},
+    {"trailing", (getter)PyIrcMessage_trailing_get, NULL,
+        PyIrcMessage_trailing_doc, NULL},
+    {NULL}
+};
+
+static PyObject *PyIrcMessage_repr(PyIrcMessage *self)
+{
+    return PyUnicode_FromFormat("<irssi.IrcMessage %R>", self->line);
+}
+
+PyTypeObject PyIrcMessageType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name      = "irssi.IrcMessage",                       /*tp_name*/
+    .tp_basicsize = sizeof(PyIrcMessage),                     /*tp_basicsize*/
+    .tp_dealloc   = (destructor)PyIrcMessage_dealloc,         /*tp_dealloc*/
+    .tp_repr      = (reprfunc)PyIrcMessage_repr,              /*tp_repr*/
+    .tp_flags     = Py_TPFLAGS_DEFAULT,                       /*tp_flags*/
+    .tp_doc       = "IrcMessage(line, command=None, nick=None, address=None)\n\n"
+                    "IRC line parsed on demand. command, nick and address stand in for\n"
+                    "the command and prefix when the line doesn't have them. The fields\n"
+                    "are str when line is str, else bytes.", /* tp_doc */
+    .tp_getset    = PyIrcMessage_getseters,                   /* tp_getset */
+    .tp_new       = PyIrcMessage_new,                         /* tp_new */
+};
+
+/* ircmessage factory function; line is referenced, not copied. The 
+   arguments are bytes, text makes the fields str */
+PyObject *pyircmessage_new(PyObject *line, PyObject *command, PyObject *nick, 
+        PyObject *address, int text)
+{
+    PyIrcMessage *msg;
+
+    g_return_val_if_fail(line != NULL && PyBytes_Check(line), NULL);
+
+    msg = py_inst(PyIrcMessage, PyIrcMessageType);
+    if (!msg)
+        return NULL;
+
+    msg->line = line;
+    Py_INCREF(line);
+    msg->command_arg = command;
+    Py_XINCREF(command);
+    msg->nick_arg = nick;
+    Py_XINCREF(nick);
+    msg->address_arg = address;
+    Py_XINCREF(address);
+    msg->text = text;
+
+    return (PyObject *)msg;
+}
+
+int ircmessage_object_init(void)
+{
+    g_return_val_if_fail(py_module != NULL, 0);
+
+    if (PyType_Ready(&PyIrcMessageType) < 0)
+        return 0;
+
+    Py_INCREF(&PyIrcMessageType);
+    PyModule_AddObject(py_module, "IrcMessage", (PyObject *)&PyIrcMessageType);
+
+    return 1;
+}
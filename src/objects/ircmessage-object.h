@@ -0,0 +1,44 @@
+#ifndef _IRCMESSAGE_OBJECT_H_
+#define _IRCMESSAGE_OBJECT_H_
+
+#include <Python.h>
+
+/* Parsed view of an IRC line. The line is split into offsets on first
+   access to a field, and each field is built once, on demand. */
+typedef struct
+{
+    PyObject_HEAD
+    PyObject *line;         /* bytes, [@tags] [:prefix] [command] params */
+    PyObject *command_arg;  /* command and source given apart from the */
+    PyObject *nick_arg;     /* line, as by "event <cmd>" signals; bytes */
+    PyObject *address_arg;  /* or NULL */
+    int text;               /* fields are str, decoded as by py_text_decode() */
+
+    int parsed;
+    /* offsets into line, start == end for missing parts */
+    Py_ssize_t tags_start, tags_end;
+    Py_ssize_t prefix_start, prefix_end;
+    Py_ssize_t command_start, command_end;
+    Py_ssize_t params_start;
+    Py_ssize_t trailing_start;  /* -1 without a trailing parameter */
+
+    /* cache */
+    PyObject *raw;          /* line, or its str in text mode */
+    PyObject *tags;         /* mappingproxy */
+    PyObject *prefix;
+    PyObject *nick;
+    PyObject *user;
+    PyObject *host;
+    PyObject *command;
+    PyObject *params;       /* tuple */
+    PyObject *trailing;
+} PyIrcMessage;
+
+extern PyTypeObject PyIrcMessageType;
+
+int ircmessage_object_init(void);
+PyObject *pyircmessage_new(PyObject *line, PyObject *command, PyObject *nick, 
+        PyObject *address, int text);
+#define pyircmessage_check(op) PyObject_TypeCheck(op, &PyIrcMessageType)
+
+#endif
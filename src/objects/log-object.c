@@ -99,7 +99,8 @@ static int PyLog_init(PyLog *self, PyObject *args, PyObject *kwds)
 
     static char *kwlist[] = {"fname", "level", NULL};
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y|i", kwlist, &fname, &level))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|i", kwlist,
+                                     py_str_conv, &fname, &level))
         return -1;
 
     /*XXX: anything better than RuntimeError ? */
@@ -330,8 +331,9 @@ static PyObject *PyLog_item_add(PyLog *self, PyObject *args, PyObject *kwds)
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y|ziii", kwlist, &item,
-                                     &servertag, &type, &target, &window))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|ziii", kwlist,
+                                     py_str_conv, &item, &servertag, &type,
+                                     &target, &window))
         return NULL;
 
     if (!logtype(&type, target, window))
@@ -388,8 +390,9 @@ static PyObject *PyLog_item_find(PyLog *self, PyObject *args, PyObject *kwds)
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y|ziii", kwlist, &item,
-                                     &server, &type, &target, &window))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|ziii", kwlist,
+                                     py_str_conv, &item, &server, &type,
+                                     &target, &window))
         return NULL;
 
     if (!logtype(&type, target, window))
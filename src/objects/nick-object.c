@@ -25,23 +25,13 @@
 #include "pyirssi.h"
 #include "pycore.h"
 #include "pyutils.h"
+#include "factory.h"
 
-static void nick_cleanup(CHANNEL_REC *chan, NICK_REC *nick)
-{
-    PyNick *pynick = signal_get_user_data();
-
-    if (nick == pynick->data)
-    {
-        pynick->data = NULL;
-        pynick->cleanup_installed = 0;
-        signal_remove_data("nicklist remove", nick_cleanup, pynick);
-    }
-}
-
+/* "nicklist remove" invalidation is handled by the factory */
 static void PyNick_dealloc(PyNick *self)
 {
-    if (self->cleanup_installed)
-        signal_remove_data("nicklist remove", nick_cleanup, self);
+    py_irssi_wrapper_remove(self->data, (PyObject *)self);
+    py_text_cache_free(&self->text);
 
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
@@ -62,7 +52,7 @@ PyDoc_STRVAR(PyNick_nick_doc,
 static PyObject *PyNick_nick_get(PyNick *self, void *closure)
 {
     RET_NULL_IF_INVALID(self->data);
-    RET_AS_STRING_OR_NONE(self->data->nick);
+    RET_AS_TEXT_CACHED(PY_TEXT_NICK, self->data->nick);
 }
 
 PyDoc_STRVAR(PyNick_host_doc,
@@ -195,14 +185,17 @@ PyObject *pynick_sub_new(void *nick, PyTypeObject *subclass)
     static const char *name = "NICK";
     PyNick *pynick = NULL;
 
+    pynick = (PyNick *)py_irssi_wrapper_find(nick);
+    if (pynick)
+        return (PyObject *)pynick;
+
     pynick = py_instp(PyNick, subclass); 
     if (!pynick)
         return NULL;
 
     pynick->data = nick;
     pynick->base_name = name;
-    signal_add_last_data("nicklist remove", nick_cleanup, pynick);
-    pynick->cleanup_installed = 1;
+    py_irssi_wrapper_add(nick, (PyObject *)pynick);
 
     return (PyObject *)pynick;
 }
@@ -0,0 +1,412 @@
+/* 
+    irssi-python
+
+    Copyright (C) 2006 Christopher Davis
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <Python.h>
+#include "pyirssi.h"
+#include "pymodule.h"
+#include "factory.h"
+#include "nicklist-object.h"
+
+/* The view reads the channel's nick hash directly. Nicks sharing a name are
+ * chained through NICK_REC->next in Irssi, so every lookup walks the chain.
+ * Nothing here keeps NICK_REC pointers between calls; iterators remember
+ * names and look them up again, so nicks removed while iterating are skipped.
+ * Index access does the same with a snapshot of the names kept on the view,
+ * so walking it by index is a hash lookup per nick rather than a walk of the
+ * whole table; the snapshot is dropped when a nick joins, leaves or is
+ * renamed.
+ */
+
+#define VIEW_CHANNEL(chan) ((CHANNEL_REC *)((PyChannel *)(chan))->data)
+
+static void count_chain(char *key, NICK_REC *nick, int *count)
+{
+    for (; nick != NULL; nick = nick->next)
+        (*count)++;
+}
+
+static int nicklist_count(CHANNEL_REC *chan)
+{
+    int count = 0;
+
+    g_hash_table_foreach(chan->nicks, (GHFunc)count_chain, &count);
+    return count;
+}
+
+static void nicklist_snapshot_changed(CHANNEL_REC *chan, NICK_REC *nick);
+
+static void nicklist_snapshot_drop(PyNickList *self)
+{
+    if (!self->names)
+        return;
+
+    signal_remove_data("nicklist new", nicklist_snapshot_changed, self);
+    signal_remove_data("nicklist remove", nicklist_snapshot_changed, self);
+    signal_remove_data("nicklist changed", nicklist_snapshot_changed, self);
+
+    g_strfreev(self->names);
+    g_free(self->chain_pos);
+    self->names = NULL;
+    self->chain_pos = NULL;
+    self->count = 0;
+}
+
+/* monitor "nicklist new", "nicklist remove" and "nicklist changed" */
+static void nicklist_snapshot_changed(CHANNEL_REC *chan, NICK_REC *nick)
+{
+    PyNickList *self = signal_get_user_data();
+
+    if (chan == VIEW_CHANNEL(self->channel))
+        nicklist_snapshot_drop(self);
+}
+
+static void nicklist_snapshot_take(PyNickList *self, CHANNEL_REC *chan)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+    int count = nicklist_count(chan), i = 0;
+
+    self->names = g_new0(char *, count + 1);
+    self->chain_pos = g_new(int, count);
+    self->count = count;
+
+    g_hash_table_iter_init(&iter, chan->nicks);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+    {
+        NICK_REC *nick;
+        int pos = 0;
+
+        for (nick = value; nick != NULL && i < count; nick = nick->next)
+        {
+            self->names[i] = g_strdup(nick->nick);
+            self->chain_pos[i++] = pos++;
+        }
+    }
+
+    signal_add_last_data("nicklist new", nicklist_snapshot_changed, self);
+    signal_add_last_data("nicklist remove", nicklist_snapshot_changed, self);
+    signal_add_last_data("nicklist changed", nicklist_snapshot_changed, self);
+}
+
+/* the snapshot must have been taken */
+static NICK_REC *nicklist_nth(PyNickList *self, CHANNEL_REC *chan, Py_ssize_t index)
+{
+    NICK_REC *nick;
+    int i;
+
+    if (index < 0 || index >= self->count)
+        return NULL;
+
+    nick = g_hash_table_lookup(chan->nicks, self->names[index]);
+    for (i = 0; nick != NULL && i < self->chain_pos[index]; i++)
+        nick = nick->next;
+
+    return nick;
+}
+
+static void PyNickList_dealloc(PyNickList *self)
+{
+    nicklist_snapshot_drop(self);
+    Py_XDECREF(self->channel);
+
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static Py_ssize_t PyNickList_length(PyNickList *self)
+{
+    CHANNEL_REC *chan = VIEW_CHANNEL(self->channel);
+
+    RET_N1_IF_INVALID(chan);
+
+    if (self->names)
+        return self->count;
+
+    return nicklist_count(chan);
+}
+
+static int PyNickList_contains(PyNickList *self, PyObject *key)
+{
+    CHANNEL_REC *chan = VIEW_CHANNEL(self->channel);
+    NICK_REC *nick;
+    const char *name;
+
+    RET_N1_IF_INVALID(chan);
+
+    if (pynick_check(key))
+    {
+        NICK_REC *target = DATA(key);
+
+        if (!target)
+            return 0;
+
+        nick = g_hash_table_lookup(chan->nicks, target->nick);
+        for (; nick != NULL; nick = nick->next)
+            if (nick == target)
+                return 1;
+
+        return 0;
+    }
+
+    if (!PyBytes_Check(key) && !PyUnicode_Check(key))
+    {
+        PyErr_Format(PyExc_TypeError, "expected nick name or Nick object");
+        return -1;
+    }
+
+    if (!py_str_conv(key, &name))
+        return -1;
+
+    return nicklist_find(chan, name) != NULL;
+}
+
+static PyObject *PyNickList_subscript(PyNickList *self, PyObject *key)
+{
+    CHANNEL_REC *chan = VIEW_CHANNEL(self->channel);
+    NICK_REC *nick;
+    const char *name;
+
+    RET_NULL_IF_INVALID(chan);
+
+    /* index lookups go through the snapshot, name lookups are a hash lookup */
+    if (PyIndex_Check(key))
+    {
+        Py_ssize_t i = PyNumber_AsSsize_t(key, PyExc_IndexError);
+
+        if (i == -1 && PyErr_Occurred())
+            return NULL;
+
+        if (!self->names)
+            nicklist_snapshot_take(self, chan);
+
+        if (i < 0)
+            i += self->count;
+
+        nick = nicklist_nth(self, chan, i);
+        if (!nick)
+            return PyErr_Format(PyExc_IndexError, "nicklist index out of range");
+
+        return py_irssi_chat_new(nick, 1);
+    }
+
+    if (PySlice_Check(key))
+    {
+        Py_ssize_t start, stop, step, len, i;
+        PyObject *list;
+
+        if (PySlice_Unpack(key, &start, &stop, &step) < 0)
+            return NULL;
+
+        if (!self->names)
+            nicklist_snapshot_take(self, chan);
+
+        len = PySlice_AdjustIndices(self->count, &start, &stop, step);
+        list = PyList_New(len);
+        if (!list)
+            return NULL;
+
+        for (i = 0; i < len; i++, start += step)
+        {
+            PyObject *obj = py_irssi_chat_new(nicklist_nth(self, chan, start), 1);
+
+            if (!obj)
+            {
+                Py_DECREF(list);
+                return NULL;
+            }
+
+            PyList_SET_ITEM(list, i, obj);
+        }
+
+        return list;
+    }
+
+    if (!PyBytes_Check(key) && !PyUnicode_Check(key))
+        return PyErr_Format(PyExc_TypeError, "nick name must be bytes or str");
+
+    if (!py_str_conv(key, &name))
+        return NULL;
+
+    nick = nicklist_find(chan, name);
+    if (!nick)
+    {
+        PyErr_SetObject(PyExc_KeyError, key);
+        return NULL;
+    }
+
+    return py_irssi_chat_new(nick, 1);
+}
+
+static void collect_names(char *key, NICK_REC *nick, char ***names)
+{
+    **names = g_strdup(nick->nick);
+    (*names)++;
+}
+
+static PyObject *PyNickList_iter(PyNickList *self)
+{
+    CHANNEL_REC *chan = VIEW_CHANNEL(self->channel);
+    PyNickListIter *iter;
+    char **pos;
+
+    RET_NULL_IF_INVALID(chan);
+
+    iter = py_inst(PyNickListIter, PyNickListIterType);
+    if (!iter)
+        return NULL;
+
+    iter->names = g_new0(char *, g_hash_table_size(chan->nicks) + 1);
+    pos = iter->names;
+    g_hash_table_foreach(chan->nicks, (GHFunc)collect_names, &pos);
+
+    iter->channel = self->channel;
+    Py_INCREF(iter->channel);
+
+    return (PyObject *)iter;
+}
+
+PyDoc_STRVAR(PyNickList_find_mask_doc,
+    "find_mask(mask) -> Nick object or None\n"
+    "\n"
+    "Find nick mask from nicklist, wildcards allowed.\n"
+);
+static PyObject *PyNickList_find_mask(PyNickList *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"mask", NULL};
+    CHANNEL_REC *chan = VIEW_CHANNEL(self->channel);
+    char *mask = "";
+
+    RET_NULL_IF_INVALID(chan);
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &mask))
+        return NULL;
+
+    return py_irssi_chat_new(nicklist_find_mask(chan, mask), 1);
+}
+
+/* Methods for object */
+static PyMethodDef PyNickList_methods[] = {
+    {"find_mask", (PyCFunction)PyNickList_find_mask, METH_VARARGS | METH_KEYWORDS,
+        PyNickList_find_mask_doc},
+    {NULL}  /* Sentinel */
+};
+
+static PySequenceMethods PyNickList_as_sequence = {
+    .sq_length    = (lenfunc)PyNickList_length,
+    .sq_contains  = (objobjproc)PyNickList_contains,
+};
+
+static PyMappingMethods PyNickList_as_mapping = {
+    .mp_length    = (lenfunc)PyNickList_length,
+    .mp_subscript = (binaryfunc)PyNickList_subscript,
+};
+
+PyTypeObject PyNickListType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name        = "irssi.NickList",                       /*tp_name*/
+    .tp_basicsize   = sizeof(PyNickList),                     /*tp_basicsize*/
+    .tp_dealloc     = (destructor)PyNickList_dealloc,         /*tp_dealloc*/
+    .tp_as_sequence = &PyNickList_as_sequence,                /*tp_as_sequence*/
+    .tp_as_mapping  = &PyNickList_as_mapping,                 /*tp_as_mapping*/
+    .tp_flags       = Py_TPFLAGS_DEFAULT,                     /*tp_flags*/
+    .tp_doc         = "Live view of the nicks in a channel",  /* tp_doc */
+    .tp_iter        = (getiterfunc)PyNickList_iter,           /* tp_iter */
+    .tp_methods     = PyNickList_methods,                     /* tp_methods */
+};
+
+static void PyNickListIter_dealloc(PyNickListIter *self)
+{
+    Py_XDECREF(self->channel);
+    g_strfreev(self->names);
+
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *PyNickListIter_next(PyNickListIter *self)
+{
+    CHANNEL_REC *chan = VIEW_CHANNEL(self->channel);
+
+    RET_NULL_IF_INVALID(chan);
+
+    while (self->names[self->pos] != NULL)
+    {
+        NICK_REC *nick;
+        int i;
+
+        nick = g_hash_table_lookup(chan->nicks, self->names[self->pos]);
+        for (i = 0; nick != NULL && i < self->chain_pos; i++)
+            nick = nick->next;
+
+        if (nick)
+        {
+            self->chain_pos++;
+            return py_irssi_chat_new(nick, 1);
+        }
+
+        self->pos++;
+        self->chain_pos = 0;
+    }
+
+    return NULL;
+}
+
+PyTypeObject PyNickListIterType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name      = "irssi.NickListIter",                     /*tp_name*/
+    .tp_basicsize = sizeof(PyNickListIter),                   /*tp_basicsize*/
+    .tp_dealloc   = (destructor)PyNickListIter_dealloc,       /*tp_dealloc*/
+    .tp_flags     = Py_TPFLAGS_DEFAULT,                       /*tp_flags*/
+    .tp_doc       = "NickList iterator",                      /* tp_doc */
+    .tp_iter      = PyObject_SelfIter,                        /* tp_iter */
+    .tp_iternext  = (iternextfunc)PyNickListIter_next,        /* tp_iternext */
+};
+
+/* nicklist view factory function */
+PyObject *pynicklist_new(PyObject *channel)
+{
+    PyNickList *view;
+
+    g_return_val_if_fail(pychannel_check(channel), NULL);
+
+    view = py_inst(PyNickList, PyNickListType);
+    if (!view)
+        return NULL;
+
+    view->channel = channel;
+    Py_INCREF(channel);
+
+    return (PyObject *)view;
+}
+
+int nicklist_object_init(void)
+{
+    g_return_val_if_fail(py_module != NULL, 0);
+
+    if (PyType_Ready(&PyNickListType) < 0)
+        return 0;
+
+    if (PyType_Ready(&PyNickListIterType) < 0)
+        return 0;
+
+    Py_INCREF(&PyNickListType);
+    PyModule_AddObject(py_module, "NickList", (PyObject *)&PyNickListType);
+
+    return 1;
+}
@@ -0,0 +1,36 @@
+#ifndef _NICKLIST_OBJECT_H_
+#define _NICKLIST_OBJECT_H_
+
+#include <Python.h>
+
+/* Live view of a channel's nicklist. Nick wrappers are only created
+   for the members that are actually accessed. */
+typedef struct
+{
+    PyObject_HEAD
+    PyObject *channel; /* Channel wrapper the view reads from */
+
+    /* order for index access, kept until the channel's nicks change */
+    char **names;      /* a name per nick, NULL terminated */
+    int *chain_pos;    /* position of the nick in the chain of its name */
+    int count;
+} PyNickList;
+
+/* Iterator over a snapshot of the nick names taken when iteration starts */
+typedef struct
+{
+    PyObject_HEAD
+    PyObject *channel;
+    char **names;   /* NULL terminated */
+    int pos;        /* current name */
+    int chain_pos;  /* position in the chain of nicks sharing that name */
+} PyNickListIter;
+
+extern PyTypeObject PyNickListType;
+extern PyTypeObject PyNickListIterType;
+
+int nicklist_object_init(void);
+PyObject *pynicklist_new(PyObject *channel);
+#define pynicklist_check(op) PyObject_TypeCheck(op, &PyNickListType)
+
+#endif
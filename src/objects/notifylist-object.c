@@ -141,7 +141,8 @@ static PyObject *PyNotifylist_ircnets_match(PyNotifylist *self, PyObject *args,
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &ircnet))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &ircnet))
         return NULL;
 
     return PyBool_FromLong(notifylist_ircnets_match(self->data, ircnet));
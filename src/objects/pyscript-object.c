@@ -27,6 +27,10 @@
 #include "pysource.h"
 #include "pythemes.h"
 #include "pystatusbar.h"
+#include "pyasync.h"
+#include "pyworker.h"
+#include "pyloader.h"
+#include "pyutils.h"
 
 #if !defined(IRSSI_ABI_VERSION) || IRSSI_ABI_VERSION < 32
 #define i_slist_find_icase_string gslist_find_icase_string
@@ -41,6 +45,7 @@ static int PyScript_traverse(PyScript *self, visitproc visit, void *arg)
     Py_VISIT(self->module);
     Py_VISIT(self->argv);
     Py_VISIT(self->modules);
+    Py_VISIT(self->tasks);
 
     return 0;
 }
@@ -50,6 +55,7 @@ static int PyScript_clear(PyScript *self)
     Py_CLEAR(self->module);
     Py_CLEAR(self->argv);
     Py_CLEAR(self->modules);
+    Py_CLEAR(self->tasks);
 
     return 0;
 }
@@ -66,7 +72,7 @@ static void PyScript_dealloc(PyScript* self)
 static PyObject *PyScript_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
     PyScript *self; 
-    PyObject *argv = NULL, *modules = NULL;
+    PyObject *argv = NULL, *modules = NULL, *tasks = NULL;
 
     argv = PyList_New(0);
     if (!argv)
@@ -76,18 +82,24 @@ static PyObject *PyScript_new(PyTypeObject *type, PyObject *args, PyObject *kwds
     if (!modules)
         goto error;
 
+    tasks = PySet_New(NULL);
+    if (!tasks)
+        goto error;
+
     self = (PyScript *)type->tp_alloc(type, 0);
     if (!self)
         goto error;
 
     self->argv = argv;
     self->modules = modules;
+    self->tasks = tasks;
     
     return (PyObject *)self;
 
 error:
     Py_XDECREF(argv);
     Py_XDECREF(modules);
+    Py_XDECREF(tasks);
     return NULL;
 }
 
@@ -95,6 +107,8 @@ PyDoc_STRVAR(PyScript_command_bind_doc,
     "command_bind(command, func, catetory=None, priority=SIGNAL_PRIORITY_DEFAULT) -> None\n"
     "\n"
     "Add handler for a command\n"
+    "\n"
+    "func may be an async def function, see signal_add().\n"
 );
 static PyObject *PyScript_command_bind(PyScript *self, PyObject *args, PyObject *kwds)
 {
@@ -104,40 +118,176 @@ static PyObject *PyScript_command_bind(PyScript *self, PyObject *args, PyObject
     char *category = NULL;
     int priority = SIGNAL_PRIORITY_DEFAULT;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yO|zi", kwlist, &cmd, &func,
-                                     &category, &priority))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O|zi", kwlist,
+                                     py_str_conv, &cmd, &func, &category,
+                                     &priority))
         return NULL;
 
     if (!PyCallable_Check(func))
         return PyErr_Format(PyExc_TypeError, "func must be callable");
   
-    if (!pysignals_command_bind_list(&self->signals, cmd, func, category, priority))
+    if (!pysignals_command_bind_list(&self->signals, (PyObject *)self, cmd, func, 
+                category, priority))
         return PyErr_Format(PyExc_RuntimeError, "unable to bind command");
     
     Py_RETURN_NONE;
 }
 
+/* sequence of bytes or str -> NULL terminated string array */
+static char **py_strv_new(PyObject *seq, const char *what)
+{
+    PyObject *fast;
+    char **strv;
+    Py_ssize_t i, len;
+
+    fast = PySequence_Fast(seq, "");
+    if (!fast)
+    {
+        PyErr_Format(PyExc_TypeError, "%s must be a sequence of bytes or str", what);
+        return NULL;
+    }
+
+    len = PySequence_Fast_GET_SIZE(fast);
+    strv = g_new0(char *, len + 1);
+    for (i = 0; i < len; i++)
+    {
+        PyObject *item = PySequence_Fast_GET_ITEM(fast, i);
+        const char *str;
+
+        if (!py_str_conv(item, &str))
+        {
+            PyErr_Format(PyExc_TypeError, "%s must be a sequence of bytes or str", what);
+            g_strfreev(strv);
+            Py_DECREF(fast);
+            return NULL;
+        }
+
+        strv[i] = g_strdup(str);
+    }
+
+    Py_DECREF(fast);
+    return strv;
+}
+
+/* build a signal filter from the signal_add() keywords, *filter is NULL if
+   none are given. Returns 0 on error. */
+static int py_filter_new(PY_SIGNAL_FILTER_REC **filter, PyObject *tags, 
+        PyObject *targets, char *nick, char *regex)
+{
+    PY_SIGNAL_FILTER_REC *rec;
+    GError *error = NULL;
+
+    *filter = NULL;
+    if (!tags && !targets && !nick && !regex)
+        return 1;
+
+    rec = g_new0(PY_SIGNAL_FILTER_REC, 1);
+
+    if (tags && !(rec->tags = py_strv_new(tags, "tags")))
+        goto error;
+
+    if (targets && !(rec->targets = py_strv_new(targets, "targets")))
+        goto error;
+
+    rec->nick = g_strdup(nick);
+
+    if (regex)
+    {
+        rec->regex = g_regex_new(regex, G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, &error);
+        if (!rec->regex)
+        {
+            PyErr_Format(PyExc_ValueError, "bad regex: %s", error->message);
+            g_error_free(error);
+            goto error;
+        }
+    }
+
+    *filter = rec;
+    return 1;
+
+error:
+    pysignals_filter_free(rec);
+    return 0;
+}
+
 PyDoc_STRVAR(PyScript_signal_add_doc,
-    "signal_add(signal, func, priority=SIGNAL_PRIORITY_DEFAULT) -> None\n"
+    "signal_add(signal, func, priority=SIGNAL_PRIORITY_DEFAULT, batch_ms=0,\n"
+    "           tags=None, targets=None, nick=b'', regex=b'', message=False,\n"
+    "           views=False) -> None\n"
+    "\n"
+    "Add handler for signal\n"
+    "\n"
+    "With batch_ms, emissions are collected and func is called at most once\n"
+    "every batch_ms milliseconds with a list of argument tuples, one per\n"
+    "emission. The handler can't stop or alter batched signals.\n"
     "\n"
-    "Add handler for signal"
+    "tags, targets, nick and regex filter emissions before func is called:\n"
+    "tags and targets are sequences of server tags and channel or target\n"
+    "names, nick is a nick mask and regex is matched against the message\n"
+    "text. ValueError is raised if the signal has nothing to filter on.\n"
+    "\n"
+    "With message=True, the line of \"server incoming\", \"server event\" and\n"
+    "\"event <cmd>\" signals is passed as an irssi.IrcMessage, which parses\n"
+    "tags, prefix, command and parameters in C when they are first read.\n"
+    "Its fields, and the nick and address, follow text_mode.\n"
+    "\n"
+    "With views=True, string arguments are passed as irssi.StrView, a read-only\n"
+    "bytes-like view of Irssi's own string instead of a copy. A view expires\n"
+    "when the handler returns; keep view.copy() if the data is needed later.\n"
+    "Its methods don't copy, but memoryview(), re and other buffer users get\n"
+    "a copy, made once per view.\n"
+    "\n"
+    "func may be an async def function. Its code up to the first await runs\n"
+    "while the signal is emitted and can stop it or change IN/OUT arguments;\n"
+    "the rest runs as a task of the script and must not use the arguments'\n"
+    "lists or signal_stop() any more.\n"
 );
 static PyObject *PyScript_signal_add(PyScript *self, PyObject *args, PyObject *kwds)
 {
-    static char *kwlist[] = {"signal", "func", "priority", NULL};
+    static char *kwlist[] = {"signal", "func", "priority", "batch_ms", 
+        "tags", "targets", "nick", "regex", "message", 
+        "views", NULL};
     char *signal;
     PyObject *func;
     int priority = SIGNAL_PRIORITY_DEFAULT;
-
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yO|i", kwlist, &signal, &func,
-                                     &priority))
+    int batch_ms = 0;
+    PyObject *tags = NULL;
+    PyObject *targets = NULL;
+    char *nick = "";
+    char *regex = "";
+    int message = 0;
+    int views = 0;
+    PY_SIGNAL_FILTER_REC *filter;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O|iiOOO&O&pp", kwlist,
+                                     py_str_conv, &signal, &func, &priority,
+                                     &batch_ms, &tags, &targets,
+                                     py_str_conv, &nick, py_str_conv, &regex,
+                                     &message, &views))
         return NULL;
 
     if (!PyCallable_Check(func))
         return PyErr_Format(PyExc_TypeError, "func must be callable");
 
-    if (!pysignals_signal_add_list(&self->signals, signal, func, priority))
-        return PyErr_Format(PyExc_KeyError, "unable to find signal, '%s'", signal);
+    if (batch_ms < 0)
+        return PyErr_Format(PyExc_ValueError, "batch_ms must not be negative");
+
+    if (tags == Py_None)
+        tags = NULL;
+    if (targets == Py_None)
+        targets = NULL;
+
+    if (!py_filter_new(&filter, tags, targets, *nick? nick : NULL, *regex? regex : NULL))
+        return NULL;
+
+    if (!pysignals_signal_add_list(&self->signals, (PyObject *)self, signal, func, 
+                priority, batch_ms, filter, 
+                (message? PY_ARGS_MESSAGE : 0) | (views? PY_ARGS_VIEWS : 0)))
+    {
+        if (!PyErr_Occurred())
+            PyErr_Format(PyExc_KeyError, "unable to find signal, '%s'", signal);
+        return NULL;
+    }
     
     Py_RETURN_NONE;
 }
@@ -153,7 +303,8 @@ static PyObject *PyScript_signal_remove(PyScript *self, PyObject *args, PyObject
     char *signal = "";
     PyObject *func = Py_None;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y|O", kwlist, &signal, &func))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|O", kwlist,
+                                     py_str_conv, &signal, &func))
         return NULL;
 
     if (!PyCallable_Check(func) && func != Py_None)
@@ -179,8 +330,8 @@ static PyObject *PyScript_command_unbind(PyScript *self, PyObject *args, PyObjec
     char *command = "";
     PyObject *func = Py_None;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y|O", kwlist, &command,
-                                     &func))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|O", kwlist,
+                                     py_str_conv, &command, &func))
         return NULL;
 
     if (!PyCallable_Check(func) && func != Py_None)
@@ -239,8 +390,8 @@ static PyObject *PyScript_signal_register(PyScript *self, PyObject *args, PyObje
     char *arglist = "";
     int i;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yy", kwlist, &signal,
-                                     &arglist))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&", kwlist,
+                                     py_str_conv, &signal, py_str_conv, &arglist))
         return NULL;
 
     for (i = 0; arglist[i]; i++)
@@ -272,7 +423,8 @@ static PyObject *PyScript_signal_unregister(PyScript *self, PyObject *args, PyOb
     char *signal = "";
     GSList *search;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &signal))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &signal))
         return NULL;
 
     search = g_slist_find_custom(self->registered_signals, signal, (GCompareFunc)strcmp);
@@ -316,7 +468,7 @@ static PyObject *PyScript_timeout_add(PyScript *self, PyObject *args, PyObject *
     if (!PyCallable_Check(func))
         return PyErr_Format(PyExc_TypeError, "func not callable");
 
-    ret = pysource_timeout_add_list(&self->sources, msecs, func, data);
+    ret = pysource_timeout_add_list(&self->sources, (PyObject *)self, msecs, func, data);
 
     return PyLong_FromLong(ret);
 }
@@ -345,7 +497,7 @@ static PyObject *PyScript_io_add_watch(PyScript *self, PyObject *args, PyObject
     if (!PyCallable_Check(func))
         return PyErr_Format(PyExc_TypeError, "func not callable");
     
-    ret = pysource_io_add_watch_list(&self->sources, fd, condition, func, data);
+    ret = pysource_io_add_watch_list(&self->sources, (PyObject *)self, fd, condition, func, data);
 
     return PyLong_FromLong(ret);
 }
@@ -401,6 +553,101 @@ static int py_settings_remove(PyScript *self, const char *name)
     return 1;
 }
 
+PyDoc_STRVAR(PyScript_create_task_doc,
+    "create_task(coro, name=None) -> asyncio.Task\n"
+    "\n"
+    "Run coroutine coro as a task on the asyncio loop. The script is current\n"
+    "while the coroutine runs, and the task is cancelled when the script is\n"
+    "unloaded. asyncio.create_task() and ensure_future() called from a\n"
+    "script end up here.\n"
+);
+static PyObject *PyScript_create_task(PyScript *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"coro", "name", NULL};
+    PyObject *coro = NULL;
+    PyObject *name = NULL;
+    PyObject *task, *discard, *ret;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O", kwlist, &coro, &name))
+        return NULL;
+
+    if (!self->tasks)
+        return PyErr_Format(PyExc_RuntimeError, "script has been unloaded");
+
+    task = pyasync_create_task((PyObject *)self, coro, name);
+    if (!task)
+        return NULL;
+
+    if (PySet_Add(self->tasks, task) != 0)
+        goto error;
+
+    /* finished tasks drop out of the set */
+    discard = PyObject_GetAttrString(self->tasks, "discard");
+    if (!discard)
+        goto error;
+
+    ret = PyObject_CallMethod(task, "add_done_callback", "O", discard);
+    Py_DECREF(discard);
+    if (!ret)
+        goto error;
+    Py_DECREF(ret);
+
+    return task;
+
+error:
+    Py_DECREF(task);
+    return NULL;
+}
+
+PyDoc_STRVAR(PyScript_run_in_worker_doc,
+    "run_in_worker(func, *args, callback=None) -> None\n"
+    "\n"
+    "Call func(*args) on a worker thread, then callback(result) on the main\n"
+    "thread with the script current. An exception raised by func is printed\n"
+    "instead. Nothing is called back once the script is unloaded, and\n"
+    "RuntimeError is raised if the script is already unloaded. func must\n"
+    "not call into Irssi; it can use irssi.call_soon_threadsafe() for that.\n"
+    "The pool has python_worker_threads threads.\n"
+);
+static PyObject *PyScript_run_in_worker(PyScript *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *func, *fargs, *callback = NULL;
+    int ret;
+
+    if (PyTuple_GET_SIZE(args) < 1)
+        return PyErr_Format(PyExc_TypeError, "run_in_worker() needs a function");
+
+    if (kwds)
+    {
+        callback = PyDict_GetItemString(kwds, "callback");
+        if (PyDict_Size(kwds) != (callback? 1 : 0))
+            return PyErr_Format(PyExc_TypeError, 
+                    "run_in_worker() only takes callback as a keyword");
+        if (callback == Py_None)
+            callback = NULL;
+    }
+
+    func = PyTuple_GET_ITEM(args, 0);
+    if (!PyCallable_Check(func) || (callback && !PyCallable_Check(callback)))
+        return PyErr_Format(PyExc_TypeError, "func and callback must be callable");
+
+    /* the tasks set goes away on unload, see pyscript_remove_tasks(); 
+       pyloader_script_loaded() would also turn away calls made at load time */
+    if (!self->tasks)
+        return PyErr_Format(PyExc_RuntimeError, "script has been unloaded");
+
+    fargs = PyTuple_GetSlice(args, 1, PyTuple_GET_SIZE(args));
+    if (!fargs)
+        return NULL;
+
+    ret = pyworker_submit((PyObject *)self, func, fargs, callback);
+    Py_DECREF(fargs);
+    if (!ret)
+        return NULL;
+
+    Py_RETURN_NONE;
+}
+
 PyDoc_STRVAR(PyScript_settings_add_str_doc,
     "settings_add_str(section, key, def) -> None\n"
 );
@@ -411,8 +658,9 @@ static PyObject *PyScript_settings_add_str(PyScript *self, PyObject *args, PyObj
     char *key = "";
     char *def = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyy", kwlist, &section, &key,
-                                     &def))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&O&", kwlist,
+                                     py_str_conv, &section, py_str_conv, &key,
+                                     py_str_conv, &def))
         return NULL;
 
     if (!py_settings_add(self, key))
@@ -433,7 +681,8 @@ static PyObject *PyScript_settings_add_int(PyScript *self, PyObject *args, PyObj
     char *key = "";
     int def = 0;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyi", kwlist, &section, &key,
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&i", kwlist,
+                                     py_str_conv, &section, py_str_conv, &key,
                                      &def))
         return NULL;
 
@@ -455,7 +704,8 @@ static PyObject *PyScript_settings_add_bool(PyScript *self, PyObject *args, PyOb
     char *key = "";
     int def = 0;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyi", kwlist, &section, &key,
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&i", kwlist,
+                                     py_str_conv, &section, py_str_conv, &key,
                                      &def))
         return NULL;
 
@@ -477,8 +727,9 @@ static PyObject *PyScript_settings_add_time(PyScript *self, PyObject *args, PyOb
     char *key = "";
     char *def = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyy", kwlist, &section, &key,
-                                     &def))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&O&", kwlist,
+                                     py_str_conv, &section, py_str_conv, &key,
+                                     py_str_conv, &def))
         return NULL;
 
     if (!py_settings_add(self, key))
@@ -499,8 +750,9 @@ static PyObject *PyScript_settings_add_level(PyScript *self, PyObject *args, PyO
     char *key = "";
     char *def = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyy", kwlist, &section, &key,
-                                     &def))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&O&", kwlist,
+                                     py_str_conv, &section, py_str_conv, &key,
+                                     py_str_conv, &def))
         return NULL;
 
     if (!py_settings_add(self, key))
@@ -521,8 +773,9 @@ static PyObject *PyScript_settings_add_size(PyScript *self, PyObject *args, PyOb
     char *key = "";
     char *def = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyy", kwlist, &section, &key,
-                                     &def))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&O&", kwlist,
+                                     py_str_conv, &section, py_str_conv, &key,
+                                     py_str_conv, &def))
         return NULL;
 
     if (!py_settings_add(self, key))
@@ -541,7 +794,7 @@ static PyObject *PyScript_settings_remove(PyScript *self, PyObject *args, PyObje
     static char *kwlist[] = {"key", NULL};
     char *key = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &key))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &key))
         return NULL;
 
     return PyBool_FromLong(py_settings_remove(self, key));
@@ -575,8 +828,8 @@ static PyObject *PyScript_statusbar_item_register(PyScript *self, PyObject *args
     char *value = NULL;
     PyObject *func = NULL;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y|zO", kwlist, &name, &value,
-                                     &func))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|zO", kwlist,
+                                     py_str_conv, &name, &value, &func))
         return NULL;
 
     pystatusbar_item_register((PyObject *)self, name, value, func);
@@ -584,6 +837,51 @@ static PyObject *PyScript_statusbar_item_register(PyScript *self, PyObject *args
     Py_RETURN_NONE;
 }
 
+static void py_stats_append(const char *kind, const char *name, 
+        PyObject *handler, PY_STATS_REC *stats, PyObject *list)
+{
+    PyObject *dict;
+
+    if (PyErr_Occurred())
+        return;
+
+    dict = pystats_to_dict(kind, name, handler, stats);
+    if (dict)
+    {
+        PyList_Append(list, dict);
+        Py_DECREF(dict);
+    }
+}
+
+PyDoc_STRVAR(PyScript_stats_doc,
+    "stats() -> list of dicts\n"
+    "\n"
+    "Return call statistics for the signal and command handlers, sources\n"
+    "and statusbar items of the script. Each dict has the keys kind, name,\n"
+    "handler, calls, total and max (in seconds) and histogram, a tuple of\n"
+    "call counts where item i counts calls that took 2**i to 2**(i+1)\n"
+    "microseconds. Times leave out Python handlers run from inside the\n"
+    "call. Counters only advance while /py stats on is in effect.\n"
+    "strikes and suspended report the python_handler_budget watchdog.\n"
+);
+static PyObject *PyScript_stats(PyScript *self, PyObject *args)
+{
+    PyObject *list;
+
+    list = PyList_New(0);
+    if (!list)
+        return NULL;
+
+    pyscript_stats_foreach((PyObject *)self, (PY_STATS_FUNC)py_stats_append, list);
+    if (PyErr_Occurred())
+    {
+        Py_DECREF(list);
+        return NULL;
+    }
+
+    return list;
+}
+
 /* Methods for object */
 static PyMethodDef PyScript_methods[] = {
     {"command_bind", (PyCFunction)PyScript_command_bind, METH_VARARGS | METH_KEYWORDS, 
@@ -604,6 +902,10 @@ static PyMethodDef PyScript_methods[] = {
         PyScript_io_add_watch_doc},
     {"source_remove", (PyCFunction)PyScript_source_remove, METH_VARARGS | METH_KEYWORDS,
         PyScript_source_remove_doc},
+    {"create_task", (PyCFunction)PyScript_create_task, METH_VARARGS | METH_KEYWORDS,
+        PyScript_create_task_doc},
+    {"run_in_worker", (PyCFunction)PyScript_run_in_worker, METH_VARARGS | METH_KEYWORDS,
+        PyScript_run_in_worker_doc},
     {"settings_add_str", (PyCFunction)PyScript_settings_add_str, METH_VARARGS | METH_KEYWORDS,
         PyScript_settings_add_str_doc},
     {"settings_add_int", (PyCFunction)PyScript_settings_add_int, METH_VARARGS | METH_KEYWORDS,
@@ -622,6 +924,8 @@ static PyMethodDef PyScript_methods[] = {
         PyScript_theme_register_doc},
     {"statusbar_item_register", (PyCFunction)PyScript_statusbar_item_register, METH_VARARGS | METH_KEYWORDS,
         PyScript_statusbar_item_register_doc},
+    {"stats", (PyCFunction)PyScript_stats, METH_NOARGS,
+        PyScript_stats_doc},
     {NULL}  /* Sentinel */
 };
 
@@ -634,17 +938,77 @@ static PyMemberDef PyScript_members[] = {
     { NULL } /* Sentinel */
 };
 
+/* Getters */
+PyDoc_STRVAR(PyScript_text_mode_doc,
+    "How Irssi strings are passed to the script: 'bytes' (the default) or\n"
+    "'str'. With 'str', object attributes and string signal arguments are\n"
+    "decoded from UTF-8, or from the recode_fallback charset when they\n"
+    "aren't valid UTF-8. Functions that take strings accept both, str is\n"
+    "encoded as UTF-8."
+);
+static PyObject *PyScript_text_mode_get(PyScript *self, void *closure)
+{
+    return PyUnicode_FromString(self->text_str? "str" : "bytes");
+}
+
+static int PyScript_text_mode_set(PyScript *self, PyObject *value, void *closure)
+{
+    const char *mode;
+
+    if (!value)
+    {
+        PyErr_Format(PyExc_AttributeError, "can't delete text_mode");
+        return -1;
+    }
+
+    mode = PyUnicode_Check(value)? PyUnicode_AsUTF8(value) : 
+        PyBytes_Check(value)? PyBytes_AS_STRING(value) : NULL;
+    if (!mode || (strcmp(mode, "str") != 0 && strcmp(mode, "bytes") != 0))
+    {
+        if (!PyErr_Occurred())
+            PyErr_Format(PyExc_ValueError, "text_mode must be 'bytes' or 'str'");
+        return -1;
+    }
+
+    self->text_str = strcmp(mode, "str") == 0;
+    pyloader_text_mode_sync();
+
+    return 0;
+}
+
+/* specialized getters/setters */
+static PyGetSetDef PyScript_getseters[] = {
+    {"text_mode", (getter)PyScript_text_mode_get, (setter)PyScript_text_mode_set,
+        PyScript_text_mode_doc, NULL},
+    {NULL}
+};
+
+#ifdef Py_GIL_DISABLED
+/* the methods change script state, see PY_CHECK_THREAD() */
+static PyObject *PyScript_getattro(PyObject *self, PyObject *name)
+{
+    if (!py_check_main_thread())
+        return NULL;
+
+    return PyObject_GenericGetAttr(self, name);
+}
+#else
+#define PyScript_getattro PyObject_GenericGetAttr
+#endif
+
 PyTypeObject PyScriptType = {
     PyVarObject_HEAD_INIT(NULL, 0)
     .tp_name      = "irssi.Script",                          /*tp_name*/
     .tp_basicsize = sizeof(PyScript),                        /*tp_basicsize*/
     .tp_dealloc   = (destructor)PyScript_dealloc,            /*tp_dealloc*/
+    .tp_getattro  = PyScript_getattro,                       /*tp_getattro*/
     .tp_flags     = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC, /*tp_flags*/
     .tp_doc       = "PyScript objects",                      /* tp_doc */
     .tp_traverse  = (traverseproc)PyScript_traverse,         /* tp_traverse */
     .tp_clear     = (inquiry)PyScript_clear,                 /* tp_clear */
     .tp_methods   = PyScript_methods,                        /* tp_methods */
     .tp_members   = PyScript_members,                        /* tp_members */
+    .tp_getset    = PyScript_getseters,                      /* tp_getset */
     .tp_new       = PyScript_new,                            /* tp_new */
 };
 
@@ -731,6 +1095,40 @@ void pyscript_remove_sources(PyObject *script)
     g_return_if_fail(self->sources == NULL);
 }
 
+/* cancellation is delivered by the next loop iterations */
+void pyscript_remove_tasks(PyObject *script)
+{
+    PyScript *self;
+    PyObject *tasks;
+    Py_ssize_t i;
+
+    g_return_if_fail(pyscript_check(script));
+
+    self = (PyScript *) script;
+    if (!self->tasks)
+        return;
+
+    /* the done callbacks change the set */
+    tasks = PySequence_List(self->tasks);
+    if (!tasks)
+        PyErr_Print();
+
+    for (i = 0; tasks && i < PyList_GET_SIZE(tasks); i++)
+    {
+        PyObject *ret = PyObject_CallMethod(PyList_GET_ITEM(tasks, i), "cancel", NULL);
+
+        if (!ret)
+            PyErr_Print();
+        Py_XDECREF(ret);
+    }
+
+    Py_XDECREF(tasks);
+
+    /* create_task() refuses to start new ones from now on, eg. from the 
+       finally clause of a cancelled task */
+    Py_CLEAR(self->tasks);
+}
+
 void pyscript_remove_settings(PyObject *script)
 {
     PyScript *self;
@@ -771,6 +1169,7 @@ void pyscript_clear_modules(PyObject *script)
 
 void pyscript_cleanup(PyObject *script)
 {
+    pyscript_remove_tasks(script);
     pyscript_remove_signals(script);
     pyscript_remove_sources(script);
     pyscript_remove_settings(script);
@@ -779,6 +1178,19 @@ void pyscript_cleanup(PyObject *script)
     pyscript_clear_modules(script);
 }
 
+void pyscript_stats_foreach(PyObject *script, PY_STATS_FUNC func, void *data)
+{
+    PyScript *self;
+
+    g_return_if_fail(pyscript_check(script));
+
+    self = (PyScript *) script;
+
+    pysignals_stats_foreach(self->signals, func, data);
+    pysource_stats_foreach(script, func, data);
+    pystatusbar_stats_foreach(script, func, data);
+}
+
 int pyscript_init(void) 
 {
     if (PyType_Ready(&PyScriptType) < 0)
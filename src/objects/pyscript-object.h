@@ -2,6 +2,7 @@
 #define _PYSCRIPT_OBJECT_H_ 
 #include <Python.h>
 #include <glib.h>
+#include "pystats.h"
 
 typedef struct {
     PyObject_HEAD
@@ -12,6 +13,10 @@ typedef struct {
     GSList *registered_signals; /* list of signal names registered */
     GSList *sources; /* list of io and timeout sources */
     GSList *settings; /* list of settings from settings_add_*() */
+    PyObject *tasks; /* set of asyncio tasks from create_task() */
+    int text_str; /* text_mode is 'str', see py_text_new() */
+    PyThreadState *tstate; /* own interpreter from /py isolate, else NULL */
+    int workers; /* worker jobs keeping that interpreter alive, atomic */
 } PyScript;
 
 extern PyTypeObject PyScriptType;
@@ -20,13 +25,16 @@ int pyscript_init(void);
 PyObject *pyscript_new(PyObject *module, char **argv);
 void pyscript_remove_signals(PyObject *script);
 void pyscript_remove_sources(PyObject *script);
+void pyscript_remove_tasks(PyObject *script);
 void pyscript_remove_settings(PyObject *script);
 void pyscript_remove_themes(PyObject *script);
 void pyscript_remove_statusbars(PyObject *script);
 void pyscript_clear_modules(PyObject *script);
 void pyscript_cleanup(PyObject *script);
+void pyscript_stats_foreach(PyObject *script, PY_STATS_FUNC func, void *data);
 #define pyscript_check(op) PyObject_TypeCheck(op, &PyScriptType)
 #define pyscript_get_name(scr) PyModule_GetName(((PyScript*)scr)->module)
 #define pyscript_get_module(scr) (((PyScript*)scr)->module)
+#define pyscript_get_tstate(scr) (((PyScript*)scr)->tstate)
 
 #endif
@@ -46,6 +46,7 @@ static void PyQuery_dealloc(PyQuery *self)
         signal_remove_data("query destroyed", query_cleanup, self);
 
     Py_XDECREF(self->server);
+    py_text_cache_free(&self->text);
 
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
@@ -168,7 +168,7 @@ static PyObject *PyRawlog_input(PyRawlog *self, PyObject *args, PyObject *kwds)
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &str))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &str))
         return NULL;
 
     rawlog_input(self->data, str);
@@ -188,7 +188,7 @@ static PyObject *PyRawlog_output(PyRawlog *self, PyObject *args, PyObject *kwds)
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &str))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &str))
         return NULL;
 
     rawlog_output(self->data, str);
@@ -208,7 +208,7 @@ static PyObject *PyRawlog_redirect(PyRawlog *self, PyObject *args, PyObject *kwd
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &str))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &str))
         return NULL;
 
     rawlog_redirect(self->data, str);
@@ -228,7 +228,8 @@ static PyObject *PyRawlog_open(PyRawlog *self, PyObject *args, PyObject *kwds)
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &fname))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &fname))
         return NULL;
 
     rawlog_open(self->data, fname);
@@ -262,7 +263,8 @@ static PyObject *PyRawlog_save(PyRawlog *self, PyObject *args, PyObject *kwds)
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &fname))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &fname))
         return NULL;
 
     rawlog_save(self->data, fname);
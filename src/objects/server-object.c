@@ -25,31 +25,14 @@
 #include "pycore.h"
 #include "pyutils.h"
 
-static void server_cleanup(SERVER_REC *server)
-{
-    PyServer *pyserver = signal_get_user_data();
-
-    if (server == pyserver->data)
-    {
-        if (pyserver->connect)
-            ((PyConnect *)pyserver->connect)->data = NULL;
-
-        if (pyserver->rawlog)
-            ((PyRawlog *)pyserver->rawlog)->data = NULL;
-
-        pyserver->data = NULL;
-        pyserver->cleanup_installed = 0;
-        signal_remove_data("server disconnected", server_cleanup, pyserver);
-    }
-}
-
+/* "server disconnected" invalidation is handled by the factory */
 static void PyServer_dealloc(PyServer *self)
 {
-    if (self->cleanup_installed)
-        signal_remove_data("server disconnected", server_cleanup, self);
+    py_irssi_wrapper_remove(self->data, (PyObject *)self);
 
     Py_XDECREF(self->connect);
     Py_XDECREF(self->rawlog);
+    py_text_cache_free(&self->text);
 
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
@@ -79,7 +62,7 @@ PyDoc_STRVAR(PyServer_tag_doc,
 static PyObject *PyServer_tag_get(PyServer *self, void *closure)
 {
     RET_NULL_IF_INVALID(self->data);
-    RET_AS_STRING_OR_NONE(self->data->tag);
+    RET_AS_TEXT_CACHED(PY_TEXT_TAG, self->data->tag);
 }
 
 PyDoc_STRVAR(PyServer_nick_doc,
@@ -88,7 +71,7 @@ PyDoc_STRVAR(PyServer_nick_doc,
 static PyObject *PyServer_nick_get(PyServer *self, void *closure)
 {
     RET_NULL_IF_INVALID(self->data);
-    RET_AS_STRING_OR_NONE(self->data->nick);
+    RET_AS_TEXT_CACHED(PY_TEXT_NICK, self->data->nick);
 }
 
 PyDoc_STRVAR(PyServer_connected_doc,
@@ -238,7 +221,8 @@ static PyObject *PyServer_prnt(PyServer *self, PyObject *args, PyObject *kwds)
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yy|i", kwlist, &channel, &str,
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&|i", kwlist,
+                                     py_str_conv, &channel, py_str_conv, &str,
                                      &level))
         return NULL;
 
@@ -259,7 +243,7 @@ static PyObject *PyServer_command(PyServer *self, PyObject *args, PyObject *kwds
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &cmd))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &cmd))
         return NULL;
 
     py_command(cmd, self->data, NULL);
@@ -315,7 +299,8 @@ static PyObject *PyServer_ischannel(PyServer *self, PyObject *args, PyObject *kw
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &data))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &data))
         return NULL;
 
     ret = self->data->ischannel(self->data, data);
@@ -352,7 +337,8 @@ static PyObject *PyServer_send_message(PyServer *self, PyObject *args, PyObject
     
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyi", kwlist, &target, &msg,
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&i", kwlist,
+                                     py_str_conv, &target, py_str_conv, &msg,
                                      &target_type))
         return NULL;
 
@@ -378,8 +364,8 @@ static PyObject *PyServer_channels_join(PyServer *self, PyObject *args, PyObject
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y|i", kwlist, &channels,
-                                     &automatic))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|i", kwlist,
+                                     py_str_conv, &channels, &automatic))
         return NULL;
 
     self->data->channels_join(self->data, channels, automatic);
@@ -399,7 +385,8 @@ static PyObject *PyServer_window_item_find(PyServer *self, PyObject *args, PyObj
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &name))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &name))
         return NULL;
 
     return py_irssi_chat_new(window_item_find(self->data, name), 1);
@@ -418,7 +405,8 @@ static PyObject *PyServer_window_find_item(PyServer *self, PyObject *args, PyObj
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &name))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &name))
         return NULL;
 
     win = window_find_item(self->data, name);
@@ -467,7 +455,8 @@ static PyObject *PyServer_window_find_closest(PyServer *self, PyObject *args, Py
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yi", kwlist, &name, &level))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&i", kwlist,
+                                     py_str_conv, &name, &level))
         return NULL;
 
     win = window_find_closest(self->data, name, level);
@@ -501,7 +490,8 @@ static PyObject *PyServer_channel_find(PyServer *self, PyObject *args, PyObject
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &name))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &name))
         return NULL;
 
     return py_irssi_chat_new(channel_find(self->data, name), 1);
@@ -522,7 +512,8 @@ static PyObject *PyServer_nicks_get_same(PyServer *self, PyObject *args, PyObjec
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &nick))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &nick))
         return NULL;
     
     pylist = PyList_New(0);
@@ -580,7 +571,8 @@ static PyObject *PyServer_query_find(PyServer *self, PyObject *args, PyObject *k
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &nick))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &nick))
         return NULL;
 
     return py_irssi_chat_new(query_find(self->data, nick), 1);
@@ -601,8 +593,9 @@ static PyObject *PyServer_mask_match(PyServer *self, PyObject *args, PyObject *k
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyyy", kwlist, &mask, &nick,
-                                     &user, &host))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&O&O&", kwlist,
+                                     py_str_conv, &mask, py_str_conv, &nick,
+                                     py_str_conv, &user, py_str_conv, &host))
         return NULL;
 
     return PyBool_FromLong(mask_match(self->data, mask, nick, user, host));
@@ -622,8 +615,9 @@ static PyObject *PyServer_mask_match_address(PyServer *self, PyObject *args, PyO
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyy", kwlist, &mask, &nick,
-                                     &address))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&O&", kwlist,
+                                     py_str_conv, &mask, py_str_conv, &nick,
+                                     py_str_conv, &address))
         return NULL;
 
     return PyBool_FromLong(mask_match_address(self->data, mask, nick, address));
@@ -644,8 +638,9 @@ static PyObject *PyServer_masks_match(PyServer *self, PyObject *args, PyObject *
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyy", kwlist, &masks, &nick,
-                                     &address))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&O&", kwlist,
+                                     py_str_conv, &masks, py_str_conv, &nick,
+                                     py_str_conv, &address))
         return NULL;
 
     return PyBool_FromLong(masks_match(self->data, masks, nick, address));
@@ -667,8 +662,10 @@ static PyObject *PyServer_ignore_check(PyServer *self, PyObject *args, PyObject
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyyyi", kwlist, &nick, &host,
-                                     &channel, &text, &level))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&O&O&i", kwlist,
+                                     py_str_conv, &nick, py_str_conv, &host,
+                                     py_str_conv, &channel, py_str_conv, &text,
+                                     &level))
         return NULL;
 
     return PyBool_FromLong(ignore_check(self->data, 
@@ -746,6 +743,10 @@ PyObject *pyserver_sub_new(void *server, PyTypeObject *subclass)
     
     g_return_val_if_fail(server != NULL, NULL);
 
+    pyserver = (PyServer *)py_irssi_wrapper_find(server);
+    if (pyserver)
+        return (PyObject *)pyserver;
+
     connect = py_irssi_chat_new(srec->connrec, 0); 
     if (!connect)
         return NULL;
@@ -766,8 +767,7 @@ PyObject *pyserver_sub_new(void *server, PyTypeObject *subclass)
 
     pyserver->base_name = SERVER_TYPE;
     pyserver->data = server;
-    signal_add_last_data("server disconnected", server_cleanup, pyserver);
-    pyserver->cleanup_installed = 1;
+    py_irssi_wrapper_add(server, (PyObject *)pyserver);
     pyserver->rawlog = rawlog;
     pyserver->connect = connect;
 
@@ -0,0 +1,165 @@
+/* 
+    irssi-python
+
+    Copyright (C) 2006 Christopher Davis
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <Python.h>
+#include "pyirssi.h"
+#include "pymodule.h"
+#include "pysignals.h"
+#include "factory.h"
+#include "signal-object.h"
+
+/* The handle resolves the signal once: the spec (and its conversion plan)
+ * is pinned with a reference and the Irssi signal id is looked up up front,
+ * so emit() only has to convert the arguments.
+ */
+
+static void PySignal_dealloc(PySignal *self)
+{
+    if (self->spec)
+        pysignals_spec_put(self->spec);
+
+    Py_XDECREF(self->name);
+
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *PySignal_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"signal", NULL};
+    PySignal *self;
+    PyObject *name;
+    const char *str;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O", kwlist, &name))
+        return NULL;
+
+    if (!PyBytes_Check(name) && !PyUnicode_Check(name))
+        return PyErr_Format(PyExc_TypeError, "signal must be bytes or str");
+
+    if (!py_str_conv(name, &str))
+        return NULL;
+
+    self = (PySignal *)type->tp_alloc(type, 0);
+    if (!self)
+        return NULL;
+
+    self->spec = pysignals_spec_get(str);
+    if (!self->spec)
+    {
+        Py_DECREF(self);
+        return NULL;
+    }
+
+    self->signal_id = signal_get_uniq_id(str);
+    self->name = name;
+    Py_INCREF(name);
+
+    return (PyObject *)self;
+}
+
+/* Getters */
+PyDoc_STRVAR(PySignal_name_doc,
+    "Signal name"
+);
+static PyObject *PySignal_name_get(PySignal *self, void *closure)
+{
+    Py_INCREF(self->name);
+    return self->name;
+}
+
+/* specialized getters/setters */
+static PyGetSetDef PySignal_getseters[] = {
+    {"name", (getter)PySignal_name_get, NULL,
+        PySignal_name_doc, NULL},
+    {NULL}
+};
+
+static PyObject *PySignal_repr(PySignal *self)
+{
+    return PyUnicode_FromFormat("<irssi.Signal %R>", self->name);
+}
+
+/* Methods */
+PyDoc_STRVAR(PySignal_emit_doc,
+    "emit(*args) -> None\n"
+    "\n"
+    "Emit the signal with up to 6 arguments\n"
+);
+static PyObject *PySignal_emit(PySignal *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    const char *name;
+
+    if (!PY_CHECK_THREAD())
+        return NULL;
+
+    if (nargs > SIGNAL_MAX_ARGUMENTS)
+        return PyErr_Format(PyExc_TypeError, 
+                "no more than %d arguments for signal accepted", SIGNAL_MAX_ARGUMENTS);
+
+    /* the name was checked by PySignal_new(), str keeps its UTF-8 */
+    if (!py_str_conv(self->name, &name))
+        return NULL;
+
+    if (!pysignals_emit_spec(self->spec, self->signal_id, 
+                name, args, nargs))
+        return NULL;
+
+    Py_RETURN_NONE;
+}
+
+/* Methods for object */
+static PyMethodDef PySignal_methods[] = {
+    {"emit", (PyCFunction)(void (*)(void))PySignal_emit, METH_FASTCALL,
+        PySignal_emit_doc},
+    {NULL}  /* Sentinel */
+};
+
+PyDoc_STRVAR(PySignal_doc,
+    "Signal(signal)\n"
+    "\n"
+    "Prepared handle for emitting a signal repeatedly. The signal must be\n"
+    "known (builtin or registered with signal_register) when it is created,\n"
+    "and stays registered while the handle exists.\n"
+);
+PyTypeObject PySignalType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name      = "irssi.Signal",                           /*tp_name*/
+    .tp_basicsize = sizeof(PySignal),                         /*tp_basicsize*/
+    .tp_dealloc   = (destructor)PySignal_dealloc,             /*tp_dealloc*/
+    .tp_repr      = (reprfunc)PySignal_repr,                  /*tp_repr*/
+    .tp_flags     = Py_TPFLAGS_DEFAULT,                       /*tp_flags*/
+    .tp_doc       = PySignal_doc,                             /* tp_doc */
+    .tp_methods   = PySignal_methods,                         /* tp_methods */
+    .tp_getset    = PySignal_getseters,                       /* tp_getset */
+    .tp_new       = PySignal_new,                             /* tp_new */
+};
+
+int signal_object_init(void)
+{
+    g_return_val_if_fail(py_module != NULL, 0);
+
+    if (PyType_Ready(&PySignalType) < 0)
+        return 0;
+
+    Py_INCREF(&PySignalType);
+    PyModule_AddObject(py_module, "Signal", (PyObject *)&PySignalType);
+
+    return 1;
+}
@@ -0,0 +1,22 @@
+#ifndef _SIGNAL_OBJECT_H_
+#define _SIGNAL_OBJECT_H_
+
+#include <Python.h>
+
+struct _PY_SIGNAL_SPEC_REC;
+
+/* Signal name resolved once for repeated emission */
+typedef struct
+{
+    PyObject_HEAD
+    PyObject *name;                    /* bytes */
+    struct _PY_SIGNAL_SPEC_REC *spec;  /* referenced while the handle lives */
+    int signal_id;
+} PySignal;
+
+extern PyTypeObject PySignalType;
+
+int signal_object_init(void);
+#define pysignal_check(op) PyObject_TypeCheck(op, &PySignalType)
+
+#endif
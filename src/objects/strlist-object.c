@@ -0,0 +1,711 @@
+/* 
+    irssi-python
+
+    Copyright (C) 2006 Christopher Davis
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <Python.h>
+#include "pyirssi.h"
+#include "pymodule.h"
+#include "factory.h"
+#include "strlist-object.h"
+
+/* The GList ** of an IN/OUT string list argument (eg. the completions of
+ * "complete word") is edited in place: only the nodes that change are
+ * touched, and the last node is remembered so append is O(1). Strings are
+ * g_strdup'd and freed with g_free, as the emitter expects. The list is
+ * invalidated by the signal code once the handler returns.
+ *
+ * Only the handler has the list while it runs, until it passes the list on
+ * to Irssi (signal_continue(), signal_emit()). Irssi can then change it and
+ * free the nodes we remember, so from then on the list is recounted before
+ * every operation. Before that, a moved head is the only change to notice.
+ */
+
+#define RET_NULL_IF_EXPIRED(seq)                                                \
+    if (!strlist_sync(seq))                                                     \
+        return NULL
+
+#define RET_N1_IF_EXPIRED(seq)                                                  \
+    if (!strlist_sync(seq))                                                     \
+        return -1
+
+static int strlist_sync(PyStrList *self)
+{
+    if (!PY_CHECK_THREAD())
+        return 0;
+
+    if (!self->valid)
+    {
+        PyErr_Format(PyExc_RuntimeError, "signal argument list has expired");
+        return 0;
+    }
+
+    /* the cached nodes may be gone, only *self->list can be read */
+    if (self->lent || *self->list != self->head)
+    {
+        self->head = *self->list;
+        self->last = g_list_last(self->head);
+        self->length = g_list_length(self->head);
+        self->cursor = NULL;
+    }
+
+    return 1;
+}
+
+/* i must be in range */
+static GList *strlist_nth(PyStrList *self, Py_ssize_t i)
+{
+    GList *node;
+    Py_ssize_t pos;
+
+    if (i == self->length - 1)
+        return self->last;
+
+    /* continue from the last lookup, so an indexed loop stays linear */
+    if (self->cursor && i >= self->cursor_pos)
+    {
+        node = self->cursor;
+        pos = self->cursor_pos;
+    }
+    else
+    {
+        node = self->head;
+        pos = 0;
+    }
+
+    for (; pos < i; pos++)
+        node = node->next;
+
+    self->cursor = node;
+    self->cursor_pos = pos;
+
+    return node;
+}
+
+/* items are bytes, or str encoded as UTF-8 */
+static int strlist_check_str(PyObject *str)
+{
+    const char *value;
+
+    if (!PyBytes_Check(str) && !PyUnicode_Check(str))
+    {
+        PyErr_Format(PyExc_TypeError, "string list items must be bytes or str");
+        return 0;
+    }
+
+    return py_str_conv(str, &value);
+}
+
+/* str must have passed strlist_check_str() */
+static const char *strlist_str(PyObject *str)
+{
+    return PyBytes_Check(str)? PyBytes_AS_STRING(str) : PyUnicode_AsUTF8(str);
+}
+
+static void strlist_append(PyStrList *self, const char *str)
+{
+    GList *node = g_list_alloc();
+
+    node->data = g_strdup(str);
+    node->prev = self->last;
+    if (self->last)
+        self->last->next = node;
+    else
+        *self->list = node;
+
+    self->head = *self->list;
+    self->last = node;
+    self->length++;
+}
+
+/* str must have passed strlist_check_str() */
+static void strlist_insert(PyStrList *self, Py_ssize_t i, PyObject *str)
+{
+    if (i >= self->length)
+    {
+        strlist_append(self, strlist_str(str));
+        return;
+    }
+
+    *self->list = g_list_insert_before(*self->list, strlist_nth(self, i), 
+            g_strdup(strlist_str(str)));
+    self->head = *self->list;
+    self->length++;
+    self->cursor = NULL;
+}
+
+static void strlist_delete(PyStrList *self, GList *node)
+{
+    if (node == self->last)
+        self->last = node->prev;
+
+    g_free(node->data);
+    *self->list = g_list_delete_link(*self->list, node);
+    self->head = *self->list;
+    self->length--;
+    self->cursor = NULL;
+}
+
+/* replaces the string only if it changed */
+static void strlist_set(GList *node, PyObject *str)
+{
+    const char *value = strlist_str(str);
+
+    if (strcmp(node->data, value) == 0)
+        return;
+
+    g_free(node->data);
+    node->data = g_strdup(value);
+}
+
+static int strlist_index(PyStrList *self, Py_ssize_t *i)
+{
+    if (*i < 0)
+        *i += self->length;
+
+    if (*i < 0 || *i >= self->length)
+    {
+        PyErr_Format(PyExc_IndexError, "list index out of range");
+        return 0;
+    }
+
+    return 1;
+}
+
+static void PyStrList_dealloc(PyStrList *self)
+{
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static Py_ssize_t PyStrList_length(PyStrList *self)
+{
+    RET_N1_IF_EXPIRED(self);
+
+    return self->length;
+}
+
+static PyObject *PyStrList_item(PyStrList *self, Py_ssize_t i)
+{
+    RET_NULL_IF_EXPIRED(self);
+
+    if (i < 0 || i >= self->length)
+        return PyErr_Format(PyExc_IndexError, "list index out of range");
+
+    return py_text_new(strlist_nth(self, i)->data);
+}
+
+static int PyStrList_ass_item(PyStrList *self, Py_ssize_t i, PyObject *value)
+{
+    RET_N1_IF_EXPIRED(self);
+
+    if (i < 0 || i >= self->length)
+    {
+        PyErr_Format(PyExc_IndexError, "list assignment index out of range");
+        return -1;
+    }
+
+    if (!value)
+    {
+        strlist_delete(self, strlist_nth(self, i));
+        return 0;
+    }
+
+    if (!strlist_check_str(value))
+        return -1;
+
+    strlist_set(strlist_nth(self, i), value);
+    return 0;
+}
+
+static int PyStrList_contains(PyStrList *self, PyObject *key)
+{
+    GList *node;
+
+    RET_N1_IF_EXPIRED(self);
+
+    if (!strlist_check_str(key))
+        return -1;
+
+    for (node = self->head; node != NULL; node = node->next)
+        if (strcmp(node->data, strlist_str(key)) == 0)
+            return 1;
+
+    return 0;
+}
+
+static PyObject *PyStrList_subscript(PyStrList *self, PyObject *key)
+{
+    Py_ssize_t start, stop, step, len, i;
+    PyObject *ret;
+
+    /* synced after __index__, which may pass the list on */
+    if (PyIndex_Check(key))
+    {
+        i = PyNumber_AsSsize_t(key, PyExc_IndexError);
+        if (i == -1 && PyErr_Occurred())
+            return NULL;
+
+        RET_NULL_IF_EXPIRED(self);
+
+        if (!strlist_index(self, &i))
+            return NULL;
+
+        return py_text_new(strlist_nth(self, i)->data);
+    }
+
+    if (!PySlice_Check(key))
+        return PyErr_Format(PyExc_TypeError, "list indices must be integers or slices");
+
+    if (PySlice_Unpack(key, &start, &stop, &step) < 0)
+        return NULL;
+
+    RET_NULL_IF_EXPIRED(self);
+    len = PySlice_AdjustIndices(self->length, &start, &stop, step);
+
+    /* slices are copied out */
+    ret = PyList_New(len);
+    if (!ret)
+        return NULL;
+
+    for (i = 0; i < len; i++)
+    {
+        PyObject *str = py_text_new(strlist_nth(self, start + i * step)->data);
+
+        if (!str)
+        {
+            Py_DECREF(ret);
+            return NULL;
+        }
+
+        PyList_SET_ITEM(ret, i, str);
+    }
+
+    return ret;
+}
+
+static int PyStrList_ass_subscript(PyStrList *self, PyObject *key, PyObject *value)
+{
+    Py_ssize_t start, stop, step, len, i;
+    PyObject *seq;
+
+    /* synced after running Python code, which may pass the list on */
+    if (PyIndex_Check(key))
+    {
+        i = PyNumber_AsSsize_t(key, PyExc_IndexError);
+        if (i == -1 && PyErr_Occurred())
+            return -1;
+
+        RET_N1_IF_EXPIRED(self);
+
+        if (i < 0)
+            i += self->length;
+
+        return PyStrList_ass_item(self, i, value);
+    }
+
+    if (!PySlice_Check(key))
+    {
+        PyErr_Format(PyExc_TypeError, "list indices must be integers or slices");
+        return -1;
+    }
+
+    if (PySlice_Unpack(key, &start, &stop, &step) < 0)
+        return -1;
+
+    if (step != 1)
+    {
+        PyErr_Format(PyExc_ValueError, "extended slices are not supported");
+        return -1;
+    }
+
+    seq = NULL;
+    if (value)
+    {
+        seq = PySequence_Fast(value, "can only assign an iterable");
+        if (!seq)
+            return -1;
+
+        for (i = 0; i < PySequence_Fast_GET_SIZE(seq); i++)
+        {
+            if (!strlist_check_str(PySequence_Fast_GET_ITEM(seq, i)))
+            {
+                Py_DECREF(seq);
+                return -1;
+            }
+        }
+    }
+
+    if (!strlist_sync(self))
+    {
+        Py_XDECREF(seq);
+        return -1;
+    }
+    len = PySlice_AdjustIndices(self->length, &start, &stop, step);
+
+    /* strings at the same positions are replaced, the rest is removed 
+       or inserted */
+    for (i = 0; seq && i < len && i < PySequence_Fast_GET_SIZE(seq); i++)
+        strlist_set(strlist_nth(self, start + i), PySequence_Fast_GET_ITEM(seq, i));
+
+    for (; i < len; len--)
+        strlist_delete(self, strlist_nth(self, start + i));
+
+    for (; seq && i < PySequence_Fast_GET_SIZE(seq); i++)
+        strlist_insert(self, start + i, PySequence_Fast_GET_ITEM(seq, i));
+
+    Py_XDECREF(seq);
+    return 0;
+}
+
+static PyObject *PyStrList_iter(PyStrList *self)
+{
+    PyStrListIter *iter;
+
+    RET_NULL_IF_EXPIRED(self);
+
+    iter = py_inst(PyStrListIter, PyStrListIterType);
+    if (!iter)
+        return NULL;
+
+    iter->owner = (PyObject *)self;
+    Py_INCREF(self);
+    iter->pos = 0;
+
+    return (PyObject *)iter;
+}
+
+/* Methods */
+PyDoc_STRVAR(PyStrList_append_doc,
+    "append(str) -> None\n"
+    "\n"
+    "Add a string to the end of the list\n"
+);
+static PyObject *PyStrList_append(PyStrList *self, PyObject *str)
+{
+    RET_NULL_IF_EXPIRED(self);
+
+    if (!strlist_check_str(str))
+        return NULL;
+
+    strlist_append(self, strlist_str(str));
+
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(PyStrList_extend_doc,
+    "extend(iterable) -> None\n"
+    "\n"
+    "Add the strings from iterable to the end of the list\n"
+);
+static PyObject *PyStrList_extend(PyStrList *self, PyObject *iterable)
+{
+    PyObject *seq;
+    Py_ssize_t i;
+
+    seq = PySequence_Fast(iterable, "argument must be iterable");
+    if (!seq)
+        return NULL;
+
+    /* after the iterable ran, it may have passed the list on */
+    if (!strlist_sync(self))
+    {
+        Py_DECREF(seq);
+        return NULL;
+    }
+
+    for (i = 0; i < PySequence_Fast_GET_SIZE(seq); i++)
+    {
+        if (!strlist_check_str(PySequence_Fast_GET_ITEM(seq, i)))
+        {
+            Py_DECREF(seq);
+            return NULL;
+        }
+    }
+
+    for (i = 0; i < PySequence_Fast_GET_SIZE(seq); i++)
+        strlist_append(self, strlist_str(PySequence_Fast_GET_ITEM(seq, i)));
+
+    Py_DECREF(seq);
+    Py_RETURN_NONE;
+}
+
+static PyObject *PyStrList_inplace_concat(PyStrList *self, PyObject *iterable)
+{
+    PyObject *ret = PyStrList_extend(self, iterable);
+
+    if (!ret)
+        return NULL;
+
+    Py_DECREF(ret);
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+PyDoc_STRVAR(PyStrList_insert_doc,
+    "insert(index, str) -> None\n"
+    "\n"
+    "Insert a string before index\n"
+);
+static PyObject *PyStrList_insert(PyStrList *self, PyObject *args)
+{
+    Py_ssize_t i;
+    PyObject *str;
+
+    if (!PyArg_ParseTuple(args, "nO", &i, &str))
+        return NULL;
+
+    RET_NULL_IF_EXPIRED(self);
+
+    if (!strlist_check_str(str))
+        return NULL;
+
+    if (i < 0)
+        i = MAX(i + self->length, 0);
+
+    strlist_insert(self, i, str);
+
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(PyStrList_pop_doc,
+    "pop(index=-1) -> str\n"
+    "\n"
+    "Remove and return the string at index\n"
+);
+static PyObject *PyStrList_pop(PyStrList *self, PyObject *args)
+{
+    Py_ssize_t i = -1;
+    GList *node;
+    PyObject *ret;
+
+    if (!PyArg_ParseTuple(args, "|n", &i))
+        return NULL;
+
+    RET_NULL_IF_EXPIRED(self);
+
+    if (self->length == 0)
+        return PyErr_Format(PyExc_IndexError, "pop from empty list");
+
+    if (!strlist_index(self, &i))
+        return NULL;
+
+    node = strlist_nth(self, i);
+    ret = py_text_new(node->data);
+    if (ret)
+        strlist_delete(self, node);
+
+    return ret;
+}
+
+PyDoc_STRVAR(PyStrList_remove_doc,
+    "remove(str) -> None\n"
+    "\n"
+    "Remove the first occurrence of str\n"
+);
+static PyObject *PyStrList_remove(PyStrList *self, PyObject *str)
+{
+    GList *node;
+
+    RET_NULL_IF_EXPIRED(self);
+
+    if (!strlist_check_str(str))
+        return NULL;
+
+    for (node = self->head; node != NULL; node = node->next)
+    {
+        if (strcmp(node->data, strlist_str(str)) == 0)
+        {
+            strlist_delete(self, node);
+            Py_RETURN_NONE;
+        }
+    }
+
+    return PyErr_Format(PyExc_ValueError, "string not in list");
+}
+
+PyDoc_STRVAR(PyStrList_clear_doc,
+    "clear() -> None\n"
+    "\n"
+    "Remove all strings from the list\n"
+);
+static PyObject *PyStrList_clear(PyStrList *self, PyObject *args)
+{
+    RET_NULL_IF_EXPIRED(self);
+
+    g_list_free_full(*self->list, g_free);
+    *self->list = NULL;
+    self->head = self->last = self->cursor = NULL;
+    self->length = 0;
+
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(PyStrList_sort_doc,
+    "sort() -> None\n"
+    "\n"
+    "Sort the strings bytewise, in place\n"
+);
+static PyObject *PyStrList_sort(PyStrList *self, PyObject *args)
+{
+    RET_NULL_IF_EXPIRED(self);
+
+    *self->list = g_list_sort(*self->list, (GCompareFunc)strcmp);
+    self->head = *self->list;
+    self->last = g_list_last(self->head);
+    self->cursor = NULL;
+
+    Py_RETURN_NONE;
+}
+
+/* Methods for object */
+static PyMethodDef PyStrList_methods[] = {
+    {"append", (PyCFunction)PyStrList_append, METH_O,
+        PyStrList_append_doc},
+    {"extend", (PyCFunction)PyStrList_extend, METH_O,
+        PyStrList_extend_doc},
+    {"insert", (PyCFunction)PyStrList_insert, METH_VARARGS,
+        PyStrList_insert_doc},
+    {"pop", (PyCFunction)PyStrList_pop, METH_VARARGS,
+        PyStrList_pop_doc},
+    {"remove", (PyCFunction)PyStrList_remove, METH_O,
+        PyStrList_remove_doc},
+    {"clear", (PyCFunction)PyStrList_clear, METH_NOARGS,
+        PyStrList_clear_doc},
+    {"sort", (PyCFunction)PyStrList_sort, METH_NOARGS,
+        PyStrList_sort_doc},
+    {NULL}  /* Sentinel */
+};
+
+static PySequenceMethods PyStrList_as_sequence = {
+    .sq_length         = (lenfunc)PyStrList_length,
+    .sq_item           = (ssizeargfunc)PyStrList_item,
+    .sq_ass_item       = (ssizeobjargproc)PyStrList_ass_item,
+    .sq_contains       = (objobjproc)PyStrList_contains,
+    .sq_inplace_concat = (binaryfunc)PyStrList_inplace_concat,
+};
+
+static PyMappingMethods PyStrList_as_mapping = {
+    .mp_length        = (lenfunc)PyStrList_length,
+    .mp_subscript     = (binaryfunc)PyStrList_subscript,
+    .mp_ass_subscript = (objobjargproc)PyStrList_ass_subscript,
+};
+
+PyTypeObject PyStrListType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name        = "irssi.StrList",                        /*tp_name*/
+    .tp_basicsize   = sizeof(PyStrList),                      /*tp_basicsize*/
+    .tp_dealloc     = (destructor)PyStrList_dealloc,          /*tp_dealloc*/
+    .tp_as_sequence = &PyStrList_as_sequence,                 /*tp_as_sequence*/
+    .tp_as_mapping  = &PyStrList_as_mapping,                  /*tp_as_mapping*/
+    .tp_flags       = Py_TPFLAGS_DEFAULT,                     /*tp_flags*/
+    .tp_doc         = "String list passed to a signal, changed in place; valid until the handler returns", /* tp_doc */
+    .tp_iter        = (getiterfunc)PyStrList_iter,            /* tp_iter */
+    .tp_methods     = PyStrList_methods,                      /* tp_methods */
+};
+
+static void PyStrListIter_dealloc(PyStrListIter *self)
+{
+    Py_XDECREF(self->owner);
+
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+/* iterates by position, so the handler may change the list while looping */
+static PyObject *PyStrListIter_next(PyStrListIter *self)
+{
+    PyStrList *owner = (PyStrList *)self->owner;
+
+    RET_NULL_IF_EXPIRED(owner);
+
+    if (self->pos >= owner->length)
+        return NULL;
+
+    return py_text_new(strlist_nth(owner, self->pos++)->data);
+}
+
+PyTypeObject PyStrListIterType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name      = "irssi.StrListIter",                      /*tp_name*/
+    .tp_basicsize = sizeof(PyStrListIter),                    /*tp_basicsize*/
+    .tp_dealloc   = (destructor)PyStrListIter_dealloc,        /*tp_dealloc*/
+    .tp_flags     = Py_TPFLAGS_DEFAULT,                       /*tp_flags*/
+    .tp_doc       = "StrList iterator",                       /* tp_doc */
+    .tp_iter      = PyObject_SelfIter,                        /* tp_iter */
+    .tp_iternext  = (iternextfunc)PyStrListIter_next,         /* tp_iternext */
+};
+
+/* strlist factory function */
+PyObject *pystrlist_new(GList **list)
+{
+    PyStrList *seq;
+
+    g_return_val_if_fail(list != NULL, NULL);
+
+    seq = py_inst(PyStrList, PyStrListType);
+    if (!seq)
+        return NULL;
+
+    seq->valid = 1;
+    seq->list = list;
+    seq->head = *list;
+    seq->last = g_list_last(*list);
+    seq->length = g_list_length(*list);
+
+    return (PyObject *)seq;
+}
+
+/* called when the handler returns; the list may be freed after this */
+void pystrlist_invalidate(PyObject *obj)
+{
+    PyStrList *seq = (PyStrList *)obj;
+
+    g_return_if_fail(pystrlist_check(obj));
+
+    seq->valid = 0;
+    seq->list = NULL;
+    seq->head = seq->last = seq->cursor = NULL;
+    seq->length = 0;
+}
+
+/* the list to pass on to Irssi; it's recounted from now on */
+GList **pystrlist_lend(PyObject *obj)
+{
+    PyStrList *seq = (PyStrList *)obj;
+
+    g_return_val_if_fail(pystrlist_check(obj) && seq->valid, NULL);
+
+    seq->lent = 1;
+    seq->cursor = NULL;
+    return seq->list;
+}
+
+int strlist_object_init(void)
+{
+    g_return_val_if_fail(py_module != NULL, 0);
+
+    if (PyType_Ready(&PyStrListType) < 0)
+        return 0;
+
+    if (PyType_Ready(&PyStrListIterType) < 0)
+        return 0;
+
+    Py_INCREF(&PyStrListType);
+    PyModule_AddObject(py_module, "StrList", (PyObject *)&PyStrListType);
+
+    return 1;
+}
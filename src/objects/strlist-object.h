@@ -0,0 +1,37 @@
+#ifndef _STRLIST_OBJECT_H_
+#define _STRLIST_OBJECT_H_
+
+#include <Python.h>
+
+/* Mutable sequence over the GList of strings of an IN/OUT signal argument.
+   Edits go straight to the emitter's list. */
+typedef struct
+{
+    PyObject_HEAD
+    int valid;              /* cleared when the handler returns */
+    GList **list;           /* borrowed from the signal emitter */
+    GList *head;            /* *list as last seen, to notice outside changes */
+    GList *last;
+    Py_ssize_t length;
+    GList *cursor;          /* last node looked up by index */
+    Py_ssize_t cursor_pos;
+    int lent;               /* passed on to Irssi, the cache can't be trusted */
+} PyStrList;
+
+typedef struct
+{
+    PyObject_HEAD
+    PyObject *owner;        /* the PyStrList being iterated */
+    Py_ssize_t pos;
+} PyStrListIter;
+
+extern PyTypeObject PyStrListType;
+extern PyTypeObject PyStrListIterType;
+
+int strlist_object_init(void);
+PyObject *pystrlist_new(GList **list);
+void pystrlist_invalidate(PyObject *obj);
+GList **pystrlist_lend(PyObject *obj);
+#define pystrlist_check(op) PyObject_TypeCheck(op, &PyStrListType)
+
+#endif
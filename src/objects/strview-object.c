@@ -0,0 +1,443 @@
+/* 
+    irssi-python
+
+    Copyright (C) 2006 Christopher Davis
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <Python.h>
+#include <string.h>
+#include "pyirssi.h"
+#include "pymodule.h"
+#include "factory.h"
+#include "strview-object.h"
+
+/* Handlers added with views=True get their string arguments as StrViews
+ * instead of bytes. The view points at the emitter's own string, so 
+ * nothing is copied unless the handler asks for it, and the length is 
+ * only counted when needed. The read-only bytes operations handlers use
+ * most work on the string in place; copy() gives a bytes object that can 
+ * be kept.
+ *
+ * The signal code invalidates the view when the handler returns, and 
+ * gives the next handler a view of its own. A buffer (memoryview(), re, 
+ * file writes) can outlive that and can't be taken back, so Irssi's memory
+ * is never exported: the first buffer request makes the copy, and every 
+ * buffer is taken from it. Only the StrView methods are free of copies.
+ */
+
+#define RET_NULL_IF_EXPIRED(view)                                               \
+    if (!strview_check_valid(view))                                            \
+        return NULL
+
+#define RET_N1_IF_EXPIRED(view)                                                 \
+    if (!strview_check_valid(view))                                            \
+        return -1
+
+static int strview_check_valid(PyStrView *self)
+{
+    if (!PY_CHECK_THREAD())
+        return 0;
+
+    if (!self->valid)
+    {
+        PyErr_Format(PyExc_RuntimeError, "signal argument has expired; use copy() to keep it");
+        return 0;
+    }
+
+    if (self->len < 0)
+        self->len = strlen(self->str);
+
+    return 1;
+}
+
+/* memmem() isn't portable */
+static const char *strview_search(const char *str, Py_ssize_t len, 
+        const char *sub, Py_ssize_t sublen)
+{
+    const char *end;
+
+    if (sublen == 0)
+        return str;
+    if (sublen > len)
+        return NULL;
+
+    end = str + len - sublen;
+
+    for (; str <= end; str++)
+    {
+        str = memchr(str, sub[0], end - str + 1);
+        if (!str)
+            return NULL;
+        if (memcmp(str, sub, sublen) == 0)
+            return str;
+    }
+
+    return NULL;
+}
+
+/* bytes-like argument of a method; release with PyBuffer_Release */
+static int strview_get_arg(PyObject *obj, Py_buffer *buf)
+{
+    if (PyObject_GetBuffer(obj, buf, PyBUF_SIMPLE) < 0)
+    {
+        PyErr_Format(PyExc_TypeError, "a bytes-like object is required, not '%s'",
+                Py_TYPE(obj)->tp_name);
+        return 0;
+    }
+
+    return 1;
+}
+
+/* the copy handed out by copy() and the buffer protocol */
+static PyObject *strview_copy(PyStrView *self)
+{
+    RET_NULL_IF_EXPIRED(self);
+
+    if (!self->copy)
+        self->copy = PyBytes_FromStringAndSize(self->str, self->len);
+
+    return self->copy;
+}
+
+static void PyStrView_dealloc(PyStrView *self)
+{
+    Py_XDECREF(self->copy);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *PyStrView_repr(PyStrView *self)
+{
+    PyObject *str, *ret;
+
+    if (!self->valid)
+        return PyUnicode_FromString("<irssi.StrView expired>");
+
+    RET_NULL_IF_EXPIRED(self);
+
+    str = PyBytes_FromStringAndSize(self->str, self->len);
+    if (!str)
+        return NULL;
+
+    ret = PyUnicode_FromFormat("<irssi.StrView %R>", str);
+    Py_DECREF(str);
+    return ret;
+}
+
+/* Buffer protocol */
+static int PyStrView_getbuffer(PyStrView *self, Py_buffer *view, int flags)
+{
+    PyObject *copy = strview_copy(self);
+
+    if (!copy)
+        return -1;
+
+    return PyBuffer_FillInfo(view, (PyObject *)self, PyBytes_AS_STRING(copy), 
+            PyBytes_GET_SIZE(copy), 1, flags);
+}
+
+static PyBufferProcs PyStrView_as_buffer = {
+    .bf_getbuffer     = (getbufferproc)PyStrView_getbuffer,
+};
+
+/* Sequence */
+static Py_ssize_t PyStrView_length(PyStrView *self)
+{
+    RET_N1_IF_EXPIRED(self);
+
+    return self->len;
+}
+
+static int PyStrView_contains(PyStrView *self, PyObject *sub)
+{
+    Py_buffer buf;
+    int ret;
+
+    RET_N1_IF_EXPIRED(self);
+
+    if (PyLong_Check(sub))
+    {
+        long c = PyLong_AsLong(sub);
+
+        if (c < 0 || c > 255)
+        {
+            if (!PyErr_Occurred())
+                PyErr_Format(PyExc_ValueError, "byte must be in range(0, 256)");
+            return -1;
+        }
+
+        return memchr(self->str, (int)c, self->len) != NULL;
+    }
+
+    if (!strview_get_arg(sub, &buf))
+        return -1;
+
+    ret = strview_search(self->str, self->len, buf.buf, buf.len) != NULL;
+    PyBuffer_Release(&buf);
+
+    return ret;
+}
+
+static PyObject *PyStrView_subscript(PyStrView *self, PyObject *item)
+{
+    RET_NULL_IF_EXPIRED(self);
+
+    if (PyIndex_Check(item))
+    {
+        Py_ssize_t i = PyNumber_AsSsize_t(item, PyExc_IndexError);
+
+        if (i == -1 && PyErr_Occurred())
+            return NULL;
+        if (i < 0)
+            i += self->len;
+        if (i < 0 || i >= self->len)
+            return PyErr_Format(PyExc_IndexError, "index out of range");
+
+        return PyLong_FromLong((unsigned char)self->str[i]);
+    }
+
+    if (PySlice_Check(item))
+    {
+        Py_ssize_t start, stop, step, len, i;
+        PyObject *ret;
+        char *out;
+
+        if (PySlice_Unpack(item, &start, &stop, &step) < 0)
+            return NULL;
+        len = PySlice_AdjustIndices(self->len, &start, &stop, step);
+
+        if (step == 1)
+            return PyBytes_FromStringAndSize(self->str + start, len);
+
+        ret = PyBytes_FromStringAndSize(NULL, len);
+        if (!ret)
+            return NULL;
+
+        out = PyBytes_AS_STRING(ret);
+        for (i = 0; i < len; i++, start += step)
+            out[i] = self->str[start];
+
+        return ret;
+    }
+
+    return PyErr_Format(PyExc_TypeError, "indices must be integers or slices, not %s",
+            Py_TYPE(item)->tp_name);
+}
+
+static PyObject *PyStrView_richcompare(PyStrView *self, PyObject *other, int op)
+{
+    Py_buffer buf;
+    int equal;
+
+    if (op != Py_EQ && op != Py_NE)
+        Py_RETURN_NOTIMPLEMENTED;
+
+    RET_NULL_IF_EXPIRED(self);
+
+    if (!PyObject_CheckBuffer(other))
+        Py_RETURN_NOTIMPLEMENTED;
+
+    if (PyObject_GetBuffer(other, &buf, PyBUF_SIMPLE) < 0)
+        return NULL;
+
+    equal = buf.len == self->len && memcmp(buf.buf, self->str, self->len) == 0;
+    PyBuffer_Release(&buf);
+
+    return PyBool_FromLong(op == Py_EQ? equal : !equal);
+}
+
+/* Methods */
+PyDoc_STRVAR(PyStrView_copy_doc,
+    "copy() -> bytes\n"
+    "\n"
+    "Copy of the string that stays valid after the handler returns\n"
+);
+static PyObject *PyStrView_copy(PyStrView *self, PyObject *unused)
+{
+    PyObject *copy = strview_copy(self);
+
+    Py_XINCREF(copy);
+    return copy;
+}
+
+PyDoc_STRVAR(PyStrView_decode_doc,
+    "decode(encoding='utf-8', errors='strict') -> str\n"
+    "\n"
+    "Decode the string\n"
+);
+static PyObject *PyStrView_decode(PyStrView *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"encoding", "errors", NULL};
+    const char *encoding = "utf-8";
+    const char *errors = "strict";
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|ss", kwlist, &encoding, &errors))
+        return NULL;
+
+    RET_NULL_IF_EXPIRED(self);
+
+    return PyUnicode_Decode(self->str, self->len, encoding, errors);
+}
+
+PyDoc_STRVAR(PyStrView_find_doc,
+    "find(sub, start=0) -> int\n"
+    "\n"
+    "Lowest index of sub at or after start, -1 if not found\n"
+);
+static PyObject *PyStrView_find(PyStrView *self, PyObject *args)
+{
+    PyObject *sub;
+    Py_ssize_t start = 0;
+    Py_buffer buf;
+    const char *found;
+
+    if (!PyArg_ParseTuple(args, "O|n", &sub, &start))
+        return NULL;
+
+    RET_NULL_IF_EXPIRED(self);
+
+    if (start < 0)
+        start = MAX(start + self->len, 0);
+    if (start > self->len)
+        return PyLong_FromLong(-1);
+
+    if (!strview_get_arg(sub, &buf))
+        return NULL;
+
+    found = strview_search(self->str + start, self->len - start, buf.buf, buf.len);
+    PyBuffer_Release(&buf);
+
+    return PyLong_FromSsize_t(found? found - self->str : -1);
+}
+
+static PyObject *strview_affix(PyStrView *self, PyObject *affix, int end)
+{
+    Py_buffer buf;
+    int ret;
+
+    RET_NULL_IF_EXPIRED(self);
+
+    if (!strview_get_arg(affix, &buf))
+        return NULL;
+
+    ret = buf.len <= self->len && 
+        memcmp(self->str + (end? self->len - buf.len : 0), buf.buf, buf.len) == 0;
+    PyBuffer_Release(&buf);
+
+    return PyBool_FromLong(ret);
+}
+
+PyDoc_STRVAR(PyStrView_startswith_doc,
+    "startswith(prefix) -> bool\n"
+);
+static PyObject *PyStrView_startswith(PyStrView *self, PyObject *prefix)
+{
+    return strview_affix(self, prefix, 0);
+}
+
+PyDoc_STRVAR(PyStrView_endswith_doc,
+    "endswith(suffix) -> bool\n"
+);
+static PyObject *PyStrView_endswith(PyStrView *self, PyObject *suffix)
+{
+    return strview_affix(self, suffix, 1);
+}
+
+/* Methods for object */
+static PyMethodDef PyStrView_methods[] = {
+    {"copy", (PyCFunction)PyStrView_copy, METH_NOARGS,
+        PyStrView_copy_doc},
+    {"__bytes__", (PyCFunction)PyStrView_copy, METH_NOARGS,
+        PyStrView_copy_doc},
+    {"decode", (PyCFunction)PyStrView_decode, METH_VARARGS | METH_KEYWORDS,
+        PyStrView_decode_doc},
+    {"find", (PyCFunction)PyStrView_find, METH_VARARGS,
+        PyStrView_find_doc},
+    {"startswith", (PyCFunction)PyStrView_startswith, METH_O,
+        PyStrView_startswith_doc},
+    {"endswith", (PyCFunction)PyStrView_endswith, METH_O,
+        PyStrView_endswith_doc},
+    {NULL}  /* Sentinel */
+};
+
+static PySequenceMethods PyStrView_as_sequence = {
+    .sq_length   = (lenfunc)PyStrView_length,
+    .sq_contains = (objobjproc)PyStrView_contains,
+};
+
+static PyMappingMethods PyStrView_as_mapping = {
+    .mp_length    = (lenfunc)PyStrView_length,
+    .mp_subscript = (binaryfunc)PyStrView_subscript,
+};
+
+PyTypeObject PyStrViewType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name        = "irssi.StrView",                        /*tp_name*/
+    .tp_basicsize   = sizeof(PyStrView),                      /*tp_basicsize*/
+    .tp_dealloc     = (destructor)PyStrView_dealloc,          /*tp_dealloc*/
+    .tp_repr        = (reprfunc)PyStrView_repr,               /*tp_repr*/
+    .tp_as_sequence = &PyStrView_as_sequence,                 /*tp_as_sequence*/
+    .tp_as_mapping  = &PyStrView_as_mapping,                  /*tp_as_mapping*/
+    .tp_as_buffer   = &PyStrView_as_buffer,                   /*tp_as_buffer*/
+    .tp_flags       = Py_TPFLAGS_DEFAULT,                     /*tp_flags*/
+    .tp_doc         = "Read-only view of a string signal argument; valid until the handler returns.\n"
+                      "Its own methods read the string in place, buffers (memoryview(), re)\n"
+                      "are taken from a copy made on the first request.", /* tp_doc */
+    .tp_richcompare = (richcmpfunc)PyStrView_richcompare,     /* tp_richcompare */
+    .tp_methods     = PyStrView_methods,                      /* tp_methods */
+};
+
+/* strview factory function */
+PyObject *pystrview_new(const char *str)
+{
+    PyStrView *view;
+
+    g_return_val_if_fail(str != NULL, NULL);
+
+    view = py_inst(PyStrView, PyStrViewType);
+    if (!view)
+        return NULL;
+
+    view->valid = 1;
+    view->str = str;
+    view->len = -1;
+
+    return (PyObject *)view;
+}
+
+/* called when the handler returns; the string may be freed after this */
+void pystrview_invalidate(PyObject *obj)
+{
+    PyStrView *view = (PyStrView *)obj;
+
+    g_return_if_fail(pystrview_check(obj));
+
+    view->valid = 0;
+    view->str = NULL;
+}
+
+int strview_object_init(void)
+{
+    g_return_val_if_fail(py_module != NULL, 0);
+
+    if (PyType_Ready(&PyStrViewType) < 0)
+        return 0;
+
+    Py_INCREF(&PyStrViewType);
+    PyModule_AddObject(py_module, "StrView", (PyObject *)&PyStrViewType);
+
+    return 1;
+}
@@ -0,0 +1,24 @@
+#ifndef _STRVIEW_OBJECT_H_
+#define _STRVIEW_OBJECT_H_
+
+#include <Python.h>
+
+/* Read-only bytes-like view of a string signal argument, without copying
+   it. Invalid once the handler returns; exported buffers are copies. */
+typedef struct
+{
+    PyObject_HEAD
+    int valid;              /* cleared when the handler returns */
+    const char *str;        /* borrowed from the signal emitter */
+    Py_ssize_t len;         /* -1 until needed */
+    PyObject *copy;         /* bytes behind exported buffers, made on demand */
+} PyStrView;
+
+extern PyTypeObject PyStrViewType;
+
+int strview_object_init(void);
+PyObject *pystrview_new(const char *str);
+void pystrview_invalidate(PyObject *obj);
+#define pystrview_check(op) PyObject_TypeCheck(op, &PyStrViewType)
+
+#endif
@@ -67,8 +67,9 @@ static int PyTextDest_init(PyTextDest *self, PyObject *args, PyObject *kwds)
     PyObject *server = NULL, *window = NULL;
     TEXT_DEST_REC *dest;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y|ioo", kwlist, &target,
-                                     &level, &server, &window))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|ioo", kwlist,
+                                     py_str_conv, &target, &level, &server,
+                                     &window))
         return -1;
  
     if (server == Py_None)
@@ -188,7 +189,7 @@ static PyObject *PyTextDest_prnt(PyTextDest *self, PyObject *args, PyObject *kwd
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &str))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &str))
         return NULL;
 
     printtext_dest(self->data, "%s", str);
@@ -76,8 +76,8 @@ static PyObject *PyTheme_format_expand(PyTheme *self, PyObject *args, PyObject *
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y|i", kwlist, &format,
-                                     &flags))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|i", kwlist,
+                                     py_str_conv, &format, &flags))
         return NULL;
 
     if (flags == 0)
@@ -114,7 +114,8 @@ static PyObject *PyTheme_get_format(PyTheme *self, PyObject *args, PyObject *kwd
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yy", kwlist, &module, &tag))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&", kwlist,
+                                     py_str_conv, &module, py_str_conv, &tag))
         return NULL;
 
     formats = g_hash_table_lookup(default_formats, module);
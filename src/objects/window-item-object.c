@@ -44,7 +44,7 @@ PyDoc_STRVAR(PyWindowItem_name_doc,
 static PyObject *PyWindowItem_name_get(PyWindowItem *self, void *closure)
 {
     RET_NULL_IF_INVALID(self->data);
-    RET_AS_STRING_OR_NONE(self->data->visible_name);
+    RET_AS_TEXT_CACHED(PY_TEXT_NAME, self->data->visible_name);
 }
 
 PyDoc_STRVAR(PyWindowItem_createtime_doc,
@@ -103,7 +103,8 @@ static PyObject *PyWindowItem_prnt(PyWindowItem *self, PyObject *args, PyObject
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y|i", kwlist, &str, &level))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|i", kwlist,
+                                     py_str_conv, &str, &level))
         return NULL;
 
     printtext_string(self->data->server, self->data->visible_name, level, str);
@@ -123,7 +124,7 @@ static PyObject *PyWindowItem_command(PyWindowItem *self, PyObject *args, PyObje
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &cmd))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &cmd))
         return NULL;
 
     py_command(cmd, self->data->server, self->data);
@@ -211,8 +212,8 @@ static PyObject *PyWindowItem_activity(PyWindowItem *self, PyObject *args, PyObj
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "iy", kwlist, &data_level,
-                                     &hilight_color))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "iO&", kwlist, &data_level,
+                                     py_str_conv, &hilight_color))
         return NULL;
 
     window_item_activity(self->data, data_level, hilight_color);
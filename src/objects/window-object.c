@@ -26,23 +26,10 @@
 #include "pycore.h"
 #include "pyutils.h"
 
-/* monitor "window destroyed" signal */
-static void window_cleanup(WINDOW_REC *win)
-{
-    PyWindow *pywindow = signal_get_user_data();
-
-    if (win == pywindow->data)
-    {
-        pywindow->data = NULL;
-        pywindow->cleanup_installed = 0;
-        signal_remove_data("window destroyed", window_cleanup, pywindow);
-    }
-}
-
+/* "window destroyed" invalidation is handled by the factory */
 static void PyWindow_dealloc(PyWindow *self)
 {
-    if (self->cleanup_installed)
-        signal_remove_data("window destroyed", window_cleanup, self);
+    py_irssi_wrapper_remove(self->data, (PyObject *)self);
 
     Py_TYPE(self)->tp_free((PyObject *)self);
 }
@@ -256,7 +243,8 @@ static PyObject *PyWindow_prnt(PyWindow *self, PyObject *args, PyObject *kwds)
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y|i", kwlist, &str, &level))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|i", kwlist,
+                                     py_str_conv, &str, &level))
         return NULL;
 
     printtext_string_window(self->data, level, str);
@@ -277,7 +265,7 @@ static PyObject *PyWindow_command(PyWindow *self, PyObject *args, PyObject *kwds
     
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &cmd))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &cmd))
         return NULL;
 
     old = active_win;
@@ -475,7 +463,8 @@ static PyObject *PyWindow_set_name(PyWindow *self, PyObject *args, PyObject *kwd
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &name))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &name))
         return NULL;
 
     window_set_name(self->data, name);
@@ -495,7 +484,8 @@ static PyObject *PyWindow_set_history(PyWindow *self, PyObject *args, PyObject *
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &history))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &history))
         return NULL;
 
     window_set_history(self->data, history);
@@ -570,7 +560,8 @@ static PyObject *PyWindow_item_find(PyWindow *self, PyObject *args, PyObject *kw
 
     RET_NULL_IF_INVALID(self->data);
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "Oy", kwlist, &server, &name))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO&", kwlist, &server,
+                                     py_str_conv, &name))
         return NULL;
 
     if (!pyserver_check(server))
@@ -637,13 +628,16 @@ PyObject *pywindow_new(void *win)
 {
     PyWindow *pywindow;
 
+    pywindow = (PyWindow *)py_irssi_wrapper_find(win);
+    if (pywindow)
+        return (PyObject *)pywindow;
+
     pywindow = py_inst(PyWindow, PyWindowType);
     if (!pywindow)
         return NULL;
 
     pywindow->data = win;
-    pywindow->cleanup_installed = 1;
-    signal_add_last_data("window destroyed", window_cleanup, pywindow);
+    py_irssi_wrapper_add(win, (PyObject *)pywindow);
 
     return (PyObject *)pywindow;
 }
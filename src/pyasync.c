@@ -0,0 +1,678 @@
+/* 
+    irssi-python
+
+    Copyright (C) 2006 Christopher Davis
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <Python.h>
+#include "pyirssi.h"
+#include "pymodule.h"
+#include "pyasync.h"
+#include "pyloader.h"
+
+/* asyncio runs on top of the Irssi (GLib) main loop. irssi_asyncio.py 
+ * subclasses asyncio's selector event loop and hands the two things it
+ * would otherwise block on to a LoopDriver:
+ *
+ *  - file descriptors become GLib io watches; readiness is collected until
+ *    the loop's selector asks for it, the selector itself never blocks.
+ *  - the loop's next deadline becomes a single GLib timeout, which runs one
+ *    iteration of the asyncio loop when it fires.
+ *
+ * Every interpreter has its own asyncio and loop; an isolated script's 
+ * loop iterations run on the thread state it was created with.
+ *
+ * Tasks created by scripts run their coroutines wrapped in a 
+ * ScriptCoroutine, so each step runs with the owning script current, like
+ * signal handlers and timeouts do.
+ *
+ * Signal and command handlers may be coroutine functions. The first step of
+ * the coroutine is taken while the signal is being emitted, so the part 
+ * before the first await can still use signal_stop() and the IN/OUT 
+ * arguments; the rest runs as a task of the script.
+ */
+
+/* selectors.EVENT_READ and EVENT_WRITE */
+#define PY_EVENT_READ 1
+#define PY_EVENT_WRITE 2
+
+typedef struct _PY_WATCH_REC
+{
+    PyLoopDriver *driver;
+    int fd;
+    int events;
+    int ready;          /* events seen since the last ready() */
+    guint tag;
+} PY_WATCH_REC;
+
+/* all live drivers, their sources are removed on deinit */
+static GSList *py_drivers = NULL;
+
+static void py_driver_timer_remove(PyLoopDriver *self)
+{
+    if (self->timer)
+        g_source_remove(self->timer);
+    self->timer = 0;
+}
+
+static gboolean py_driver_dispatch(PyLoopDriver *self)
+{
+    PyThreadState *prev;
+    PyObject *ret;
+
+    /* nested main loop inside an iteration, try again later */
+    if (self->running)
+        return TRUE;
+
+    self->timer = 0;
+    self->running = 1;
+    prev = PyThreadState_Swap(self->tstate);
+    Py_INCREF(self);
+
+    ret = PyObject_CallObject(self->callback, NULL);
+    if (!ret)
+        PyErr_Print();
+    Py_XDECREF(ret);
+
+    self->running = 0;
+    Py_DECREF(self);
+    PyThreadState_Swap(prev);
+
+    return FALSE;
+}
+
+static void py_driver_schedule(PyLoopDriver *self, int msecs)
+{
+    py_driver_timer_remove(self);
+    if (!self->tstate)
+        return;
+
+    self->timer_msecs = msecs;
+    self->timer = g_timeout_add_full(G_PRIORITY_DEFAULT, msecs, 
+            (GSourceFunc)py_driver_dispatch, self, NULL);
+}
+
+static void py_driver_wakeup(PyLoopDriver *self)
+{
+    if (self->timer && self->timer_msecs == 0)
+        return;
+
+    py_driver_schedule(self, 0);
+}
+
+static gboolean py_watch_proxy(GIOChannel *src, GIOCondition cond, PY_WATCH_REC *rec)
+{
+    PyLoopDriver *driver = rec->driver;
+    int mask = 0;
+
+    /* like selectors.PollSelector: a hung up or failed fd is ready both
+       ways, or a watch for writing only would be woken up forever */
+    if (cond & (G_IO_IN | G_IO_PRI | G_IO_HUP | G_IO_ERR))
+        mask |= PY_EVENT_READ;
+    if (cond & (G_IO_OUT | G_IO_HUP | G_IO_ERR))
+        mask |= PY_EVENT_WRITE;
+    mask &= rec->events;
+
+    if (mask)
+    {
+        if (!rec->ready)
+            driver->ready = g_slist_prepend(driver->ready, rec);
+        rec->ready |= mask;
+
+        py_driver_wakeup(driver);
+    }
+
+    return TRUE;
+}
+
+static void py_watch_destroy(PY_WATCH_REC *rec)
+{
+    rec->driver->ready = g_slist_remove(rec->driver->ready, rec);
+    g_free(rec);
+}
+
+static void py_driver_unwatch(PyLoopDriver *self, int fd)
+{
+    PY_WATCH_REC *rec;
+
+    rec = g_hash_table_lookup(self->watches, GINT_TO_POINTER(fd));
+    if (!rec)
+        return;
+
+    g_hash_table_remove(self->watches, GINT_TO_POINTER(fd));
+    g_source_remove(rec->tag);
+}
+
+static void py_driver_close(PyLoopDriver *self)
+{
+    GList *fds, *node;
+
+    py_driver_timer_remove(self);
+
+    if (!self->watches)
+        return;
+
+    fds = g_hash_table_get_keys(self->watches);
+    for (node = fds; node != NULL; node = node->next)
+        py_driver_unwatch(self, GPOINTER_TO_INT(node->data));
+    g_list_free(fds);
+}
+
+static void PyLoopDriver_dealloc(PyLoopDriver *self)
+{
+    py_driver_close(self);
+    if (self->watches)
+        g_hash_table_destroy(self->watches);
+    py_drivers = g_slist_remove(py_drivers, self);
+
+    Py_XDECREF(self->callback);
+
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *PyLoopDriver_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"callback", NULL};
+    PyLoopDriver *self;
+    PyObject *callback;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O", kwlist, &callback))
+        return NULL;
+
+    if (!PyCallable_Check(callback))
+        return PyErr_Format(PyExc_TypeError, "callback must be callable");
+
+    self = (PyLoopDriver *)type->tp_alloc(type, 0);
+    if (!self)
+        return NULL;
+
+    self->callback = callback;
+    Py_INCREF(callback);
+    self->tstate = PyThreadState_Get();
+    self->watches = g_hash_table_new(g_direct_hash, g_direct_equal);
+    py_drivers = g_slist_prepend(py_drivers, self);
+
+    return (PyObject *)self;
+}
+
+/* Methods */
+PyDoc_STRVAR(PyLoopDriver_watch_doc,
+    "watch(fd, events) -> None\n"
+    "\n"
+    "Watch fd for selectors.EVENT_READ and/or EVENT_WRITE. 0 stops watching.\n"
+);
+static PyObject *PyLoopDriver_watch(PyLoopDriver *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"fd", "events", NULL};
+    PY_WATCH_REC *rec;
+    GIOChannel *channel;
+    int fd, events;
+    int cond = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "ii", kwlist, &fd, &events))
+        return NULL;
+
+    py_driver_unwatch(self, fd);
+
+    events &= PY_EVENT_READ | PY_EVENT_WRITE;
+    if (!events || !self->tstate)
+        Py_RETURN_NONE;
+
+    if (events & PY_EVENT_READ)
+        cond |= G_IO_IN | G_IO_PRI | G_IO_HUP | G_IO_ERR;
+    if (events & PY_EVENT_WRITE)
+        cond |= G_IO_OUT | G_IO_ERR;
+
+    rec = g_new0(PY_WATCH_REC, 1);
+    rec->driver = self;
+    rec->fd = fd;
+    rec->events = events;
+
+    channel = g_io_channel_unix_new(fd);
+    rec->tag = g_io_add_watch_full(channel, G_PRIORITY_DEFAULT, cond, 
+            (GIOFunc)py_watch_proxy, rec, (GDestroyNotify)py_watch_destroy);
+    g_io_channel_unref(channel);
+
+    g_hash_table_insert(self->watches, GINT_TO_POINTER(fd), rec);
+
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(PyLoopDriver_ready_doc,
+    "ready() -> list of (fd, events)\n"
+    "\n"
+    "Return and forget the events seen since the last call\n"
+);
+static PyObject *PyLoopDriver_ready(PyLoopDriver *self, PyObject *args)
+{
+    PyObject *list;
+    GSList *node;
+
+    list = PyList_New(0);
+    if (!list)
+        return NULL;
+
+    for (node = self->ready; node != NULL; node = node->next)
+    {
+        PY_WATCH_REC *rec = node->data;
+        PyObject *item;
+
+        item = Py_BuildValue("(ii)", rec->fd, rec->ready);
+        if (!item || PyList_Append(list, item) != 0)
+        {
+            Py_XDECREF(item);
+            Py_DECREF(list);
+            return NULL;
+        }
+
+        Py_DECREF(item);
+    }
+
+    for (node = self->ready; node != NULL; node = node->next)
+        ((PY_WATCH_REC *)node->data)->ready = 0;
+    g_slist_free(self->ready);
+    self->ready = NULL;
+
+    return list;
+}
+
+PyDoc_STRVAR(PyLoopDriver_schedule_doc,
+    "schedule(timeout) -> None\n"
+    "\n"
+    "Call the callback after timeout seconds, replacing the previous\n"
+    "schedule. None cancels it.\n"
+);
+static PyObject *PyLoopDriver_schedule(PyLoopDriver *self, PyObject *timeout)
+{
+    double secs;
+
+    if (timeout == Py_None)
+    {
+        py_driver_timer_remove(self);
+        Py_RETURN_NONE;
+    }
+
+    secs = PyFloat_AsDouble(timeout);
+    if (secs == -1.0 && PyErr_Occurred())
+        return NULL;
+
+    /* rounded up, an early wakeup would only schedule another one */
+    secs = ceil(secs * 1000);
+    py_driver_schedule(self, CLAMP(secs, 0, G_MAXINT));
+
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(PyLoopDriver_wakeup_doc,
+    "wakeup() -> None\n"
+    "\n"
+    "Call the callback as soon as the main loop is idle\n"
+);
+static PyObject *PyLoopDriver_wakeup(PyLoopDriver *self, PyObject *args)
+{
+    py_driver_wakeup(self);
+
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(PyLoopDriver_close_doc,
+    "close() -> None\n"
+    "\n"
+    "Remove all watches and the pending timeout\n"
+);
+static PyObject *PyLoopDriver_close(PyLoopDriver *self, PyObject *args)
+{
+    py_driver_close(self);
+
+    Py_RETURN_NONE;
+}
+
+/* Methods for object */
+static PyMethodDef PyLoopDriver_methods[] = {
+    {"watch", (PyCFunction)PyLoopDriver_watch, METH_VARARGS | METH_KEYWORDS,
+        PyLoopDriver_watch_doc},
+    {"ready", (PyCFunction)PyLoopDriver_ready, METH_NOARGS,
+        PyLoopDriver_ready_doc},
+    {"schedule", (PyCFunction)PyLoopDriver_schedule, METH_O,
+        PyLoopDriver_schedule_doc},
+    {"wakeup", (PyCFunction)PyLoopDriver_wakeup, METH_NOARGS,
+        PyLoopDriver_wakeup_doc},
+    {"close", (PyCFunction)PyLoopDriver_close, METH_NOARGS,
+        PyLoopDriver_close_doc},
+    {NULL}  /* Sentinel */
+};
+
+PyTypeObject PyLoopDriverType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name      = "irssi.LoopDriver",                       /*tp_name*/
+    .tp_basicsize = sizeof(PyLoopDriver),                     /*tp_basicsize*/
+    .tp_dealloc   = (destructor)PyLoopDriver_dealloc,         /*tp_dealloc*/
+    .tp_flags     = Py_TPFLAGS_DEFAULT,                       /*tp_flags*/
+    .tp_doc       = "GLib sources for an asyncio event loop", /* tp_doc */
+    .tp_methods   = PyLoopDriver_methods,                     /* tp_methods */
+    .tp_new       = PyLoopDriver_new,                         /* tp_new */
+};
+
+/* ScriptCoroutine; the wrapped coroutine's frame can easily refer back to
+   its task, so the wrapper takes part in garbage collection */
+static int PyScriptCoroutine_traverse(PyScriptCoroutine *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->coro);
+    Py_VISIT(self->script);
+    Py_VISIT(self->pending);
+
+    return 0;
+}
+
+static int PyScriptCoroutine_clear(PyScriptCoroutine *self)
+{
+    Py_CLEAR(self->coro);
+    Py_CLEAR(self->script);
+    Py_CLEAR(self->pending);
+
+    return 0;
+}
+
+static void PyScriptCoroutine_dealloc(PyScriptCoroutine *self)
+{
+    PyObject_GC_UnTrack(self);
+    PyScriptCoroutine_clear(self);
+
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *py_coro_call(PyScriptCoroutine *self, const char *method, PyObject *args)
+{
+    PyObject *func, *ret, *prev;
+
+    if (!self->coro)
+        return PyErr_Format(PyExc_RuntimeError, "coroutine already cleared");
+
+    func = PyObject_GetAttrString(self->coro, method);
+    if (!func)
+        return NULL;
+
+    prev = pyloader_script_enter(self->script);
+    ret = PyObject_Call(func, args, NULL);
+    pyloader_script_leave(prev);
+
+    Py_DECREF(func);
+    return ret;
+}
+
+PyDoc_STRVAR(PyScriptCoroutine_send_doc,
+    "send(value) -> next yielded value\n"
+);
+static PyObject *PyScriptCoroutine_send(PyScriptCoroutine *self, PyObject *value)
+{
+    PyObject *args, *ret;
+
+    /* the task's first step gets what the handler's step yielded */
+    if (self->pending)
+    {
+        ret = self->pending;
+        self->pending = NULL;
+        return ret;
+    }
+
+    args = PyTuple_Pack(1, value);
+    if (!args)
+        return NULL;
+
+    ret = py_coro_call(self, "send", args);
+    Py_DECREF(args);
+    return ret;
+}
+
+PyDoc_STRVAR(PyScriptCoroutine_throw_doc,
+    "throw(typ[, val[, tb]]) -> next yielded value\n"
+);
+static PyObject *PyScriptCoroutine_throw(PyScriptCoroutine *self, PyObject *args)
+{
+    Py_CLEAR(self->pending);
+    return py_coro_call(self, "throw", args);
+}
+
+PyDoc_STRVAR(PyScriptCoroutine_close_doc,
+    "close() -> None\n"
+);
+static PyObject *PyScriptCoroutine_close(PyScriptCoroutine *self, PyObject *unused)
+{
+    PyObject *args, *ret;
+
+    Py_CLEAR(self->pending);
+    args = PyTuple_New(0);
+    if (!args)
+        return NULL;
+
+    ret = py_coro_call(self, "close", args);
+    Py_DECREF(args);
+    return ret;
+}
+
+static PyObject *PyScriptCoroutine_iternext(PyScriptCoroutine *self)
+{
+    return PyScriptCoroutine_send(self, Py_None);
+}
+
+static PyObject *PyScriptCoroutine_await(PyScriptCoroutine *self)
+{
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+/* cr_frame, __qualname__ and friends come from the wrapped coroutine */
+static PyObject *PyScriptCoroutine_getattro(PyScriptCoroutine *self, PyObject *name)
+{
+    PyObject *ret = PyObject_GenericGetAttr((PyObject *)self, name);
+
+    if (!ret && self->coro && PyErr_ExceptionMatches(PyExc_AttributeError))
+    {
+        PyErr_Clear();
+        ret = PyObject_GetAttr(self->coro, name);
+    }
+
+    return ret;
+}
+
+static PyObject *PyScriptCoroutine_repr(PyScriptCoroutine *self)
+{
+    return PyUnicode_FromFormat("<ScriptCoroutine %R>", self->coro);
+}
+
+/* Methods for object */
+static PyMethodDef PyScriptCoroutine_methods[] = {
+    {"send", (PyCFunction)PyScriptCoroutine_send, METH_O,
+        PyScriptCoroutine_send_doc},
+    {"throw", (PyCFunction)PyScriptCoroutine_throw, METH_VARARGS,
+        PyScriptCoroutine_throw_doc},
+    {"close", (PyCFunction)PyScriptCoroutine_close, METH_NOARGS,
+        PyScriptCoroutine_close_doc},
+    {NULL}  /* Sentinel */
+};
+
+static PyAsyncMethods PyScriptCoroutine_as_async = {
+    .am_await = (unaryfunc)PyScriptCoroutine_await,
+};
+
+PyTypeObject PyScriptCoroutineType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name      = "irssi.ScriptCoroutine",                  /*tp_name*/
+    .tp_basicsize = sizeof(PyScriptCoroutine),                /*tp_basicsize*/
+    .tp_dealloc   = (destructor)PyScriptCoroutine_dealloc,    /*tp_dealloc*/
+    .tp_as_async  = &PyScriptCoroutine_as_async,              /*tp_as_async*/
+    .tp_repr      = (reprfunc)PyScriptCoroutine_repr,         /*tp_repr*/
+    .tp_getattro  = (getattrofunc)PyScriptCoroutine_getattro, /*tp_getattro*/
+    .tp_flags     = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,  /*tp_flags*/
+    .tp_doc       = "Coroutine that runs with its script current", /* tp_doc */
+    .tp_traverse  = (traverseproc)PyScriptCoroutine_traverse, /* tp_traverse */
+    .tp_clear     = (inquiry)PyScriptCoroutine_clear,         /* tp_clear */
+    .tp_iter      = PyObject_SelfIter,                        /* tp_iter */
+    .tp_iternext  = (iternextfunc)PyScriptCoroutine_iternext, /* tp_iternext */
+    .tp_methods   = PyScriptCoroutine_methods,                /* tp_methods */
+};
+
+PyObject *pyasync_coroutine_new(PyObject *coro, PyObject *script)
+{
+    PyScriptCoroutine *self;
+
+    self = (PyScriptCoroutine *)PyScriptCoroutineType.tp_alloc(&PyScriptCoroutineType, 0);
+    if (!self)
+        return NULL;
+
+    self->coro = coro;
+    Py_INCREF(coro);
+    self->script = script;
+    Py_XINCREF(script);
+
+    return (PyObject *)self;
+}
+
+/* Start coro as a task of script on the asyncio loop. Returns a new 
+   reference to the task. */
+PyObject *pyasync_create_task(PyObject *script, PyObject *coro, PyObject *name)
+{
+    PyObject *asyncio, *loop, *wrapped, *func, *args, *kwds;
+    PyObject *task = NULL;
+
+    asyncio = PyImport_ImportModule("asyncio");
+    if (!asyncio)
+        return NULL;
+
+    loop = PyObject_CallMethod(asyncio, "get_event_loop", NULL);
+    Py_DECREF(asyncio);
+    if (!loop)
+        return NULL;
+
+    if (pyscript_coroutine_check(coro))
+    {
+        wrapped = coro;
+        Py_INCREF(wrapped);
+    }
+    else
+        wrapped = pyasync_coroutine_new(coro, script);
+    func = PyObject_GetAttrString(loop, "create_task");
+    args = wrapped? PyTuple_Pack(1, wrapped) : NULL;
+    kwds = PyDict_New();
+    if (!func || !args || !kwds)
+        goto error;
+
+    if (name && name != Py_None && PyDict_SetItemString(kwds, "name", name) != 0)
+        goto error;
+
+    task = PyObject_Call(func, args, kwds);
+
+error:
+    Py_XDECREF(kwds);
+    Py_XDECREF(args);
+    Py_XDECREF(func);
+    Py_XDECREF(wrapped);
+    Py_DECREF(loop);
+    return task;
+}
+
+/* Take the first step of coroutine handler coro, see the note at the top.
+   Steals coro. Returns the handler's return value if it finished right 
+   away, None if it was made a task, and NULL on error. */
+PyObject *pyasync_run_handler(PyObject *script, PyObject *coro)
+{
+    PyScriptCoroutine *wrapped;
+    PyObject *yielded, *task;
+
+    wrapped = (PyScriptCoroutine *)pyasync_coroutine_new(coro, script);
+    Py_DECREF(coro);
+    if (!wrapped)
+        return NULL;
+
+    yielded = PyScriptCoroutine_send(wrapped, Py_None);
+    if (!yielded)
+    {
+        PyObject *type, *value, *tb, *ret = NULL;
+
+        Py_DECREF(wrapped);
+        if (!PyErr_ExceptionMatches(PyExc_StopIteration))
+            return NULL;
+
+        /* finished without awaiting anything */
+        PyErr_Fetch(&type, &value, &tb);
+        PyErr_NormalizeException(&type, &value, &tb);
+        if (value)
+            ret = PyObject_GetAttrString(value, "value");
+        Py_XDECREF(type);
+        Py_XDECREF(value);
+        Py_XDECREF(tb);
+
+        return ret;
+    }
+
+    wrapped->pending = yielded;
+
+    /* the script keeps track of its tasks */
+    if (script)
+        task = PyObject_CallMethod(script, "create_task", "O", (PyObject *)wrapped);
+    else
+        task = pyasync_create_task(NULL, (PyObject *)wrapped, NULL);
+
+    Py_DECREF(wrapped);
+    if (!task)
+        return NULL;
+
+    Py_DECREF(task);
+    Py_RETURN_NONE;
+}
+
+int pyasync_init(void)
+{
+    g_return_val_if_fail(py_module != NULL, 0);
+
+    if (PyType_Ready(&PyLoopDriverType) < 0)
+        return 0;
+
+    if (PyType_Ready(&PyScriptCoroutineType) < 0)
+        return 0;
+
+    Py_INCREF(&PyLoopDriverType);
+    PyModule_AddObject(py_module, "LoopDriver", (PyObject *)&PyLoopDriverType);
+    Py_INCREF(&PyScriptCoroutineType);
+    PyModule_AddObject(py_module, "ScriptCoroutine", (PyObject *)&PyScriptCoroutineType);
+
+    return 1;
+}
+
+/* GLib must not call into Python after it's gone */
+/* before the interpreter of tstate ends; its loops never run again, 
+   even if it schedules them while shutting down */
+void pyasync_close_drivers(PyThreadState *tstate)
+{
+    GSList *node;
+
+    for (node = py_drivers; node != NULL; node = node->next)
+    {
+        PyLoopDriver *driver = node->data;
+
+        if (driver->tstate == tstate)
+        {
+            driver->tstate = NULL;
+            py_driver_close(driver);
+        }
+    }
+}
+
+void pyasync_deinit(void)
+{
+    g_slist_foreach(py_drivers, (GFunc)py_driver_close, NULL);
+}
@@ -0,0 +1,41 @@
+#ifndef _PYASYNC_H_
+#define _PYASYNC_H_
+
+#include <Python.h>
+#include <glib.h>
+
+/* GLib side of the asyncio event loop, see irssi_asyncio.py */
+typedef struct _PyLoopDriver
+{
+    PyObject_HEAD
+    PyObject *callback;     /* runs one iteration of the asyncio loop */
+    GHashTable *watches;    /* fd -> PY_WATCH_REC */
+    GSList *ready;          /* watches with events not yet collected */
+    guint timer;            /* the next iteration */
+    int timer_msecs;
+    int running;
+    PyThreadState *tstate;  /* of the interpreter the loop belongs to, 
+                               NULL once that has ended */
+} PyLoopDriver;
+
+/* Coroutine wrapper that makes script the current script for each step */
+typedef struct
+{
+    PyObject_HEAD
+    PyObject *coro;
+    PyObject *script;
+    PyObject *pending;  /* yielded by a step taken before the task existed */
+} PyScriptCoroutine;
+
+extern PyTypeObject PyLoopDriverType;
+extern PyTypeObject PyScriptCoroutineType;
+
+PyObject *pyasync_coroutine_new(PyObject *coro, PyObject *script);
+PyObject *pyasync_create_task(PyObject *script, PyObject *coro, PyObject *name);
+PyObject *pyasync_run_handler(PyObject *script, PyObject *coro);
+void pyasync_close_drivers(PyThreadState *tstate);
+#define pyscript_coroutine_check(op) PyObject_TypeCheck(op, &PyScriptCoroutineType)
+int pyasync_init(void);
+void pyasync_deinit(void);
+
+#endif
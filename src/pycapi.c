@@ -0,0 +1,131 @@
+/* 
+    irssi-python
+
+    Copyright (C) 2006 Christopher Davis
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <Python.h>
+#include "pyirssi.h"
+#include "pycapi.h"
+#include "pymodule.h"
+#include "pysignals.h"
+#include "pyloader.h"
+#include "pyutils.h"
+#include "pyscript-object.h"
+
+/* The C API table, exported as the capsule _irssi._C_API. See pycapi.h.
+   Native hooks are PY_SIGNAL_RECs in the script's signal list, so they 
+   are removed by pyscript_cleanup() like its Python handlers. */
+
+static void *py_capi_hook_add(PyObject *script, const char *signal, int priority,
+        IRSSI_PYTHON_HOOK hook, void *data, void (*destroy)(void *))
+{
+    if (!PY_CHECK_THREAD())
+        return NULL;
+
+    if (!script || !pyscript_check(script))
+    {
+        PyErr_Format(PyExc_TypeError, "hook_add() needs a Script");
+        return NULL;
+    }
+
+    if (!hook || !signal)
+    {
+        PyErr_Format(PyExc_ValueError, "hook_add() needs a signal and a hook");
+        return NULL;
+    }
+
+    return pysignals_hook_add_list(&((PyScript *)script)->signals, script, 
+            signal, priority, (PY_SIGNAL_HOOK)hook, data, destroy);
+}
+
+static int py_capi_hook_remove(PyObject *script, void *hook)
+{
+    GSList **list, *node;
+
+    if (!PY_CHECK_THREAD())
+        return 0;
+
+    if (!script || !pyscript_check(script))
+    {
+        PyErr_Format(PyExc_TypeError, "hook_remove() needs a Script");
+        return 0;
+    }
+
+    list = &((PyScript *)script)->signals;
+    node = g_slist_find(*list, hook);
+    if (!node || !((PY_SIGNAL_REC *)hook)->hook)
+    {
+        PyErr_Format(PyExc_KeyError, "hook not found");
+        return 0;
+    }
+
+    pysignals_remove_generic(hook);
+    *list = g_slist_delete_link(*list, node);
+
+    return 1;
+}
+
+static void *py_capi_data(char code, PyObject *obj)
+{
+    if (!PY_CHECK_THREAD())
+        return NULL;
+
+    return pysignals_unwrap(code, obj);
+}
+
+static PyObject *py_capi_wrap(char code, void *record)
+{
+    if (!PY_CHECK_THREAD())
+        return NULL;
+
+    return pysignals_wrap(code, record);
+}
+
+static PyObject *py_capi_current_script(void)
+{
+    return pyloader_find_script_obj();
+}
+
+static const IRSSI_PYTHON_CAPI py_capi = {
+    .version = IRSSI_PYTHON_CAPI_VERSION,
+    .hook_add = py_capi_hook_add,
+    .hook_remove = py_capi_hook_remove,
+    .signal_stop = pysignals_stop,
+    .data = py_capi_data,
+    .wrap = py_capi_wrap,
+    .current_script = py_capi_current_script,
+};
+
+int pycapi_init(void)
+{
+    PyObject *capsule;
+
+    g_return_val_if_fail(py_module != NULL, 0);
+
+    capsule = PyCapsule_New((void *)&py_capi, IRSSI_PYTHON_CAPI_NAME, NULL);
+    if (!capsule)
+        return 0;
+
+    if (PyModule_AddObject(py_module, "_C_API", capsule) < 0)
+    {
+        Py_DECREF(capsule);
+        return 0;
+    }
+
+    return 1;
+}
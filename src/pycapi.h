@@ -0,0 +1,84 @@
+#ifndef _PYCAPI_H_
+#define _PYCAPI_H_
+
+/* C API of the _irssi module, for compiled extensions used by scripts.
+ *
+ * An extension gets the table once, typically from its module init:
+ *
+ *     static const IRSSI_PYTHON_CAPI *irssi_api;
+ *
+ *     irssi_api = irssi_python_capi_import();
+ *     if (!irssi_api)
+ *         return NULL;
+ *
+ * and registers native handlers for a script, eg. from a function the
+ * script calls with irssi.get_script():
+ *
+ *     static int on_public(void *data, void **args)
+ *     {
+ *         SERVER_REC *server = args[0];
+ *         const char *msg = args[1];
+ *         ...
+ *         return 0;   (1 stops the signal)
+ *     }
+ *
+ *     irssi_api->hook_add(script, "message public", 0, on_public, state, free);
+ *
+ * Hooks run in the same fan-out as the Python handlers of the signal, with
+ * the script current and under /py stats and the time budget, but get the
+ * raw Irssi arguments and no Python objects are built for them. They are
+ * removed with the script's other handlers when it is unloaded, and 
+ * destroy(data) is called then.
+ *
+ * Everything here must be called from the main thread.
+ */
+
+#include <Python.h>
+
+#define IRSSI_PYTHON_CAPI_NAME "_irssi._C_API"
+#define IRSSI_PYTHON_CAPI_VERSION 1
+
+typedef int (*IRSSI_PYTHON_HOOK)(void *data, void **args);
+
+typedef struct
+{
+    int version;        /* IRSSI_PYTHON_CAPI_VERSION */
+
+    /* Returns a handle for hook_remove(), or NULL with an exception set,
+       in which case destroy is not called. */
+    void *(*hook_add)(PyObject *script, const char *signal, int priority,
+            IRSSI_PYTHON_HOOK hook, void *data, void (*destroy)(void *));
+    /* 0 with KeyError set if script doesn't own hook */
+    int (*hook_remove)(PyObject *script, void *hook);
+    /* signal_stop() for hooks that don't return 1 */
+    void (*signal_stop)(void);
+
+    /* Wrappers and records by the signal argument type codes of 
+       sig2code.txt, eg. 'S' SERVER_REC, 'C' CHANNEL_REC, 'n' NICK_REC,
+       'w' WINDOW_REC. data() is the record of a wrapper, NULL for None or
+       with an exception set if obj is of another type or its record is 
+       gone. wrap() returns a new reference, Py_None for a NULL record. */
+    void *(*data)(char code, PyObject *obj);
+    PyObject *(*wrap)(char code, void *record);
+
+    /* borrowed, NULL if no script is running */
+    PyObject *(*current_script)(void);
+} IRSSI_PYTHON_CAPI;
+
+/* NULL with an exception set if _irssi is missing or too old */
+static inline const IRSSI_PYTHON_CAPI *irssi_python_capi_import(void)
+{
+    const IRSSI_PYTHON_CAPI *api;
+
+    api = (const IRSSI_PYTHON_CAPI *)PyCapsule_Import(IRSSI_PYTHON_CAPI_NAME, 0);
+    if (api && api->version < IRSSI_PYTHON_CAPI_VERSION)
+    {
+        PyErr_Format(PyExc_ImportError, "_irssi C API version %d, need %d",
+                api->version, IRSSI_PYTHON_CAPI_VERSION);
+        return NULL;
+    }
+
+    return api;
+}
+
+#endif
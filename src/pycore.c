@@ -29,6 +29,11 @@
 #include "pysignals.h"
 #include "pythemes.h"
 #include "pystatusbar.h"
+#include "pystats.h"
+#include "pyasync.h"
+#include "pyworker.h"
+#include "pyutils.h"
+#include "pyscript-object.h"
 #include "pyconstants.h"
 #include "factory.h"
 
@@ -90,6 +95,36 @@ static void cmd_load(const char *data)
     g_strfreev(argv);
 }
 
+static void cmd_host(const char *data)
+{
+    char **argv;
+
+    argv = g_strsplit(data, " ", -1);
+    if (*argv == NULL || **argv == '\0')
+    {
+        g_strfreev(argv);
+        cmd_return_error(CMDERR_NOT_ENOUGH_PARAMS);
+    }
+
+    pyloader_host_script_argv(argv);
+    g_strfreev(argv);
+}
+
+static void cmd_isolate(const char *data)
+{
+    char **argv;
+
+    argv = g_strsplit(data, " ", -1);
+    if (*argv == NULL || **argv == '\0')
+    {
+        g_strfreev(argv);
+        cmd_return_error(CMDERR_NOT_ENOUGH_PARAMS);
+    }
+
+    pyloader_isolate_script_argv(argv);
+    g_strfreev(argv);
+}
+
 static void cmd_unload(const char *data)
 {
     void *free_arg;
@@ -134,6 +169,83 @@ static void cmd_list()
     pyloader_list_destroy(&list);
 }
 
+/* /py stats [on|off|reset] [script] */
+static void cmd_stats(const char *data)
+{
+    GSList *list, *node;
+    char **argv;
+    const char *action = NULL, *name;
+
+    argv = g_strsplit(data, " ", -1);
+    name = argv[0];
+
+    if (name && (!strcmp(name, "on") || !strcmp(name, "off") || !strcmp(name, "reset")))
+    {
+        action = name;
+        name = argv[1];
+    }
+
+    if (action && strcmp(action, "reset") != 0)
+    {
+        pystats_enabled = !strcmp(action, "on");
+        printtext(NULL, NULL, MSGLEVEL_CLIENTNOTICE, "Python handler statistics %s",
+                pystats_enabled? "enabled" : "disabled");
+        g_strfreev(argv);
+        return;
+    }
+
+    list = pyloader_list();
+    for (node = list; node != NULL; node = node->next)
+    {
+        PY_LIST_REC *item = node->data;
+        PyObject *script;
+
+        if (name && *name && strcmp(name, item->name) != 0)
+            continue;
+
+        script = pyloader_get_script(item->name);
+        if (!script)
+            continue;
+
+        if (action)
+            pyscript_stats_foreach(script, pystats_reset, NULL);
+        else
+        {
+            printtext(NULL, NULL, MSGLEVEL_CLIENTCRAP, "%s:", item->name);
+            pystats_print_header();
+            pyscript_stats_foreach(script, pystats_print, NULL);
+        }
+    }
+    pyloader_list_destroy(&list);
+
+    if (!action && !pystats_enabled)
+        printtext_string(NULL, NULL, MSGLEVEL_CLIENTNOTICE, 
+                "Python handler statistics are off, enable them with /py stats on");
+
+    g_strfreev(argv);
+}
+
+/* /py resume [script] */
+static void cmd_resume(const char *data)
+{
+    GSList *list, *node;
+
+    list = pyloader_list();
+    for (node = list; node != NULL; node = node->next)
+    {
+        PY_LIST_REC *item = node->data;
+        PyObject *script;
+
+        if (*data && strcmp(data, item->name) != 0)
+            continue;
+
+        script = pyloader_get_script(item->name);
+        if (script)
+            pyscript_stats_foreach(script, pystats_resume, NULL);
+    }
+    pyloader_list_destroy(&list);
+}
+
 #if 0
 /* why doesn't this get called? */
 static void intr_catch(int sig)
@@ -147,10 +259,13 @@ void python_init(void)
 {
     PyImport_AppendInittab("_irssi", &PyInit_IrssiModule);
     Py_InitializeEx(0);
+    py_main_thread_init();
 
     pysignals_init();
     pystatusbar_init();
-    if (!pyloader_init() || !pymodule_init() || !factory_init() || !pythemes_init()) 
+    pystats_init();
+    if (!pyloader_init() || !pymodule_init() || !factory_init() || !pythemes_init() ||
+            !pyasync_init() || !pyworker_init() || !pycapi_init()) 
     {
         printtext(NULL, NULL, MSGLEVEL_CLIENTERROR, "Failed to load Python");
         return;
@@ -170,9 +285,13 @@ void python_init(void)
     
     command_bind("py", NULL, (SIGNAL_FUNC) cmd_default);
     command_bind("py load", NULL, (SIGNAL_FUNC) cmd_load);
+    command_bind("py host", NULL, (SIGNAL_FUNC) cmd_host);
+    command_bind("py isolate", NULL, (SIGNAL_FUNC) cmd_isolate);
     command_bind("py unload", NULL, (SIGNAL_FUNC) cmd_unload);
     command_bind("py list", NULL, (SIGNAL_FUNC) cmd_list);
     command_bind("py exec", NULL, (SIGNAL_FUNC) cmd_exec);
+    command_bind("py stats", NULL, (SIGNAL_FUNC) cmd_stats);
+    command_bind("py resume", NULL, (SIGNAL_FUNC) cmd_resume);
     module_register(MODULE_NAME, "core");
 }
 
@@ -180,14 +299,22 @@ void python_deinit(void)
 {
     command_unbind("py", (SIGNAL_FUNC) cmd_default);
     command_unbind("py load", (SIGNAL_FUNC) cmd_load);
+    command_unbind("py host", (SIGNAL_FUNC) cmd_host);
+    command_unbind("py isolate", (SIGNAL_FUNC) cmd_isolate);
     command_unbind("py unload", (SIGNAL_FUNC) cmd_unload);
     command_unbind("py list", (SIGNAL_FUNC) cmd_list);
     command_unbind("py exec", (SIGNAL_FUNC) cmd_exec);
+    command_unbind("py stats", (SIGNAL_FUNC) cmd_stats);
+    command_unbind("py resume", (SIGNAL_FUNC) cmd_resume);
 
+    pyworker_deinit();
     pymodule_deinit();
     pyloader_deinit();
+    pyasync_deinit();
     pystatusbar_deinit();
+    pystats_deinit();
     pysignals_deinit();
+    factory_deinit();
     Py_Finalize();
 }
 
@@ -25,6 +25,8 @@
 #include "pyloader.h"
 #include "pyutils.h"
 #include "pyscript-object.h"
+#include "pyworker.h"
+#include "pyasync.h"
 
 /* List of loaded modules */
 static PyObject *script_modules;
@@ -32,8 +34,38 @@ static PyObject *script_modules;
 /* List of load paths for scripts */
 static GSList *script_paths = NULL;
 
+/* Script whose code is running right now, set by the proxies that call
+   into Python. Holds a reference while set. */
+static PyObject *current_script = NULL;
+
+/* Scripts loaded with /py isolate run in an interpreter of their own. It
+ * is made with the legacy settings: the GIL and the object allocator are
+ * shared with the main interpreter, which is what lets Irssi objects, the
+ * static types in src/objects and signal arguments cross over. The script
+ * gets its own sys.modules, builtins and asyncio loop, and everything it
+ * imported or leaked goes away with the interpreter when it is unloaded.
+ *
+ * pyloader_script_enter() switches to the thread state of the script's
+ * interpreter, and pyloader_script_leave() back to the one it was entered
+ * from, kept on tstate_stack; an exception raised in there comes along.
+ */
+enum
+{
+    PY_LOAD_MAIN,
+    PY_LOAD_HOSTED,
+    PY_LOAD_ISOLATED
+};
+
+static PyThreadState *main_tstate = NULL;
+static GPtrArray *tstate_stack = NULL;
+
+/* unloaded isolated scripts whose interpreter was still in use */
+static GSList *dying_scripts = NULL;
+static guint dying_tag = 0;
+
 static PyObject *py_get_script(const char *name, int *id);
 static int py_load_module(PyObject *module, const char *path);
+static int py_host_module(PyObject *script, const char *path);
 static char *py_find_script(const char *name);
 
 /* Add to the list of script load paths */
@@ -47,6 +79,164 @@ void pyloader_add_script_path(const char *path)
     }
 }
 
+/* Switch thread states on the main thread, taking a pending exception
+   along */
+static void py_tstate_switch(PyThreadState *tstate)
+{
+    PyObject *type, *value, *tb;
+
+    if (PyThreadState_Get() == tstate)
+        return;
+
+    PyErr_Fetch(&type, &value, &tb);
+    PyThreadState_Swap(tstate);
+    PyErr_Restore(type, value, tb);
+}
+
+/* New interpreter for an isolated script, made current; the main thread
+   state is current again if it fails */
+static PyThreadState *py_interp_new(void)
+{
+    PyThreadState *tstate;
+    PyObject *startup;
+#if PY_VERSION_HEX >= 0x030C0000
+    PyInterpreterConfig config = {
+        .use_main_obmalloc = 1,
+        .allow_fork = 0,
+        .allow_exec = 0,
+        .allow_threads = 1,
+        .allow_daemon_threads = 0,      /* they'd outlive Py_EndInterpreter() */
+        .check_multi_interp_extensions = 0,     /* _irssi is single-phase */
+        .gil = PyInterpreterConfig_SHARED_GIL,
+    };
+    PyStatus status;
+
+    status = Py_NewInterpreterFromConfig(&tstate, &config);
+    if (PyStatus_Exception(status))
+    {
+        PyErr_Format(PyExc_RuntimeError, "cannot create interpreter: %s",
+                status.err_msg? status.err_msg : "unknown error");
+        return NULL;
+    }
+#else
+    tstate = Py_NewInterpreter();
+    if (!tstate)
+    {
+        PyErr_Format(PyExc_RuntimeError, "cannot create interpreter");
+        return NULL;
+    }
+#endif
+
+    /* output handlers and the asyncio loop, as in the main interpreter */
+    startup = PyImport_ImportModule("irssi_startup");
+    if (!startup)
+    {
+        PyObject *type, *value, *tb;
+
+        PyErr_Fetch(&type, &value, &tb);
+        Py_EndInterpreter(tstate);
+        PyThreadState_Swap(main_tstate);
+        PyErr_Restore(type, value, tb);
+        return NULL;
+    }
+
+    Py_DECREF(startup);
+    return tstate;
+}
+
+static int py_interp_busy(PyThreadState *tstate, PyScript *script)
+{
+    guint i;
+
+    if (g_atomic_int_get(&script->workers) > 0 || PyThreadState_Get() == tstate)
+        return 1;
+
+    for (i = 0; i < tstate_stack->len; i++)
+    {
+        if (g_ptr_array_index(tstate_stack, i) == tstate)
+            return 1;
+    }
+
+    return 0;
+}
+
+/* End the interpreter of an unloaded isolated script and drop the
+   reference to the script. Waits for the threads the script started. */
+static void py_interp_end(PyObject *script)
+{
+    PyScript *self = (PyScript *)script;
+    PyThreadState *tstate = self->tstate, *prev;
+    PyObject *type, *value, *tb;
+
+    self->tstate = NULL;
+    pyasync_close_drivers(tstate);
+
+    PyErr_Fetch(&type, &value, &tb);
+    prev = PyThreadState_Swap(tstate);
+    Py_EndInterpreter(tstate);
+    PyThreadState_Swap(prev);
+    PyErr_Restore(type, value, tb);
+
+    Py_DECREF(script);
+}
+
+static gboolean py_interp_reap(gpointer unused)
+{
+    GSList *node, *next;
+
+    for (node = dying_scripts; node != NULL; node = next)
+    {
+        PyScript *script = node->data;
+
+        next = node->next;
+        if (py_interp_busy(script->tstate, script))
+            continue;
+
+        dying_scripts = g_slist_delete_link(dying_scripts, node);
+        py_interp_end((PyObject *)script);
+    }
+
+    if (dying_scripts)
+        return TRUE;
+
+    dying_tag = 0;
+    return FALSE;
+}
+
+/* Steals script. /py unload from one of the script's own handlers, or
+   while a worker job of it runs, leaves the interpreter for later. */
+static void py_interp_release(PyObject *script)
+{
+    PyScript *self = (PyScript *)script;
+
+    if (!py_interp_busy(self->tstate, self))
+    {
+        py_interp_end(script);
+        return;
+    }
+
+    dying_scripts = g_slist_append(dying_scripts, script);
+    if (!dying_tag)
+        dying_tag = g_timeout_add(100, py_interp_reap, NULL);
+}
+
+/* Cleanup runs Python code (cancelled tasks, settings), which for an
+   isolated script belongs in its interpreter */
+static void py_script_cleanup(PyObject *script)
+{
+    PyObject *prev;
+
+    if (!pyscript_get_tstate(script))
+    {
+        pyscript_cleanup(script);
+        return;
+    }
+
+    prev = pyloader_script_enter(script);
+    pyscript_cleanup(script);
+    pyloader_script_leave(prev);
+}
+
 /* Loads a file into a module; it is not inserted into sys.modules */
 static int py_load_module(PyObject *module, const char *path) 
 {
@@ -69,6 +259,25 @@ static int py_load_module(PyObject *module, const char *path)
 
 }
 
+/* Hosted scripts run in a process of their own; the module in Irssi only
+   holds the proxy from irssi_host.py */
+static int py_host_module(PyObject *script, const char *path)
+{
+    PyObject *host, *ret;
+
+    host = PyImport_ImportModule("irssi_host");
+    if (!host)
+        return 0;
+
+    ret = PyObject_CallMethod(host, "attach", "Oy", script, path);
+    Py_DECREF(host);
+    if (!ret)
+        return 0;
+
+    Py_DECREF(ret);
+    return 1;
+}
+
 /* looks up name in Irssi script directories
    returns full path or NULL if not found */
 static char *py_find_script(const char *name)
@@ -106,10 +315,16 @@ static char *py_find_script(const char *name)
  * (such as from g_strsplit) of the command line.
  * The array needs at least one item
  */
-static int py_load_script_path_argv(const char *path, char **argv)
+static int py_load_script_path_argv(const char *path, char **argv, int mode)
 {
-    PyObject *module = NULL, *script = NULL;
+    PyObject *module = NULL, *script = NULL, *prev;
+    PyThreadState *tstate = NULL;
     char *name = NULL; 
+    int ret;
+
+    /* the module and script are made in the interpreter they run in */
+    if (mode == PY_LOAD_ISOLATED && !(tstate = py_interp_new()))
+        goto error;
 
     name = file_get_filename(path);
     module = PyModule_New(name);
@@ -121,6 +336,7 @@ static int py_load_script_path_argv(const char *path, char **argv)
     Py_DECREF(module);
     if (!script)
         goto error;
+    ((PyScript *)script)->tstate = tstate;
    
     /* insert script obj into module dict, load file */
     if (PyModule_AddObject(module, "_script", script) != 0)
@@ -128,13 +344,24 @@ static int py_load_script_path_argv(const char *path, char **argv)
 
     Py_INCREF(script);
     
-    if (!py_load_module(module, path))
+    prev = pyloader_script_enter(script);
+    if (mode == PY_LOAD_HOSTED)
+        ret = PyModule_AddStringConstant(module, "__file__", (char *)path) == 0 &&
+            py_host_module(script, path);
+    else
+        ret = py_load_module(module, path);
+    pyloader_script_leave(prev);
+    py_tstate_switch(main_tstate);
+    if (!ret)
         goto error;
     
     if (PyList_Append(script_modules, script) != 0)
         goto error;
 
-    printtext(NULL, NULL, MSGLEVEL_CLIENTERROR, "loaded script %s", argv[0]); 
+    printtext(NULL, NULL, MSGLEVEL_CLIENTERROR,
+            mode == PY_LOAD_HOSTED? "loaded script %s in a host process" :
+            mode == PY_LOAD_ISOLATED? "loaded script %s in its own interpreter" :
+            "loaded script %s", argv[0]);
     /* PySys_WriteStdout("load %s, script -> 0x%x\n", argv[0], script); */
 
     Py_DECREF(script);
@@ -142,6 +369,7 @@ static int py_load_script_path_argv(const char *path, char **argv)
     return 1;
 
 error:
+    py_tstate_switch(main_tstate);
     if (PyErr_Occurred())
         PyErr_Print();
     
@@ -151,8 +379,17 @@ error:
     {
         /* make sure to clean up any formats, signals, commands that may have been
            attached before the exception took place */
-        pyscript_cleanup(script);
-        Py_DECREF(script);
+        py_script_cleanup(script);
+        if (tstate)
+            py_interp_release(script);
+        else
+            Py_DECREF(script);
+    }
+    else if (tstate)
+    {
+        PyThreadState_Swap(tstate);
+        Py_EndInterpreter(tstate);
+        PyThreadState_Swap(main_tstate);
     }
     
     return 0;
@@ -169,13 +406,13 @@ static int py_load_script_path(const char *path)
     if (py_get_script(argv[0], NULL) != NULL)
         pyloader_unload_script(argv[0]);
 
-    ret = py_load_script_path_argv(path, argv);
+    ret = py_load_script_path_argv(path, argv, PY_LOAD_MAIN);
     g_free(argv[0]);
 
     return ret;
 }
 
-int pyloader_load_script_argv(char **argv)
+static int py_load_script_argv(char **argv, int mode)
 {
     char *path;
     int ret;
@@ -190,12 +427,29 @@ int pyloader_load_script_argv(char **argv)
         return 0;
     }
 
-    ret = py_load_script_path_argv(path, argv);
+    ret = py_load_script_path_argv(path, argv, mode);
     g_free(path);
 
     return ret;
 }
 
+int pyloader_load_script_argv(char **argv)
+{
+    return py_load_script_argv(argv, PY_LOAD_MAIN);
+}
+
+/* like pyloader_load_script_argv(), in a host process */
+int pyloader_host_script_argv(char **argv)
+{
+    return py_load_script_argv(argv, PY_LOAD_HOSTED);
+}
+
+/* like pyloader_load_script_argv(), in an interpreter of its own */
+int pyloader_isolate_script_argv(char **argv)
+{
+    return py_load_script_argv(argv, PY_LOAD_ISOLATED);
+}
+
 int pyloader_load_script(char *name)
 {
     char *argv[2];
@@ -231,6 +485,26 @@ static PyObject *py_get_script(const char *name, int *id)
     return NULL;
 }
 
+/* returns borrowed reference to the loaded script, or NULL */
+PyObject *pyloader_get_script(const char *name)
+{
+    return py_get_script(name, NULL);
+}
+
+/* true while script is in the list of loaded scripts */
+int pyloader_script_loaded(PyObject *script)
+{
+    Py_ssize_t i;
+
+    for (i = 0; i < PyList_GET_SIZE(script_modules); i++)
+    {
+        if (PyList_GET_ITEM(script_modules, i) == script)
+            return 1;
+    }
+
+    return 0;
+}
+
 int pyloader_unload_script(const char *name)
 {
     int id;
@@ -244,15 +518,23 @@ int pyloader_unload_script(const char *name)
 
     /* PySys_WriteStdout("unload %s, script -> 0x%x\n", name, script); */
     
-    pyscript_cleanup(script);
+    py_script_cleanup(script);
 
+    /* the list's reference goes to py_interp_release() */
+    Py_INCREF(script);
     if (PySequence_DelItem(script_modules, id) < 0)
     {
+        Py_DECREF(script);
         PyErr_Print();
         printtext(NULL, NULL, MSGLEVEL_CLIENTERROR, "error unloading script %s", name); 
         return 0;
     }
 
+    if (pyscript_get_tstate(script))
+        py_interp_release(script);
+    else
+        Py_DECREF(script);
+
     /* Probably a good time to call the garbage collecter to clean up reference cycles */
     PyGC_Collect();
     printtext(NULL, NULL, MSGLEVEL_CLIENTERROR, "unloaded script %s", name); 
@@ -275,11 +557,71 @@ static inline PyObject* PyFrame_GetGlobals(PyFrameObject *frame)
 }
 #endif
 
-/* Traverse stack backwards to find the nearest valid _script object in globals */
+/* py_text_str follows the text_mode of the running script */
+void pyloader_text_mode_sync(void)
+{
+    py_text_str = current_script && ((PyScript *)current_script)->text_str;
+}
+
+/* Mark script as the one running until the matching pyloader_script_leave().
+ * Returns the previous script, which must be passed to pyloader_script_leave().
+ * Calls nest, so a handler emitting a signal into another script is fine.
+ */
+PyObject *pyloader_script_enter(PyObject *script)
+{
+    PyObject *prev = current_script;
+
+    g_ptr_array_add(tstate_stack, PyThreadState_Get());
+    if (script)
+        py_tstate_switch(pyscript_get_tstate(script)? pyscript_get_tstate(script) : main_tstate);
+
+    Py_XINCREF(script);
+    current_script = script;
+    pyloader_text_mode_sync();
+
+    return prev;
+}
+
+void pyloader_script_leave(PyObject *prev)
+{
+    PyObject *script = current_script;
+    PyThreadState *tstate;
+
+    current_script = prev;
+    pyloader_text_mode_sync();
+
+    tstate = g_ptr_array_index(tstate_stack, tstate_stack->len - 1);
+    g_ptr_array_set_size(tstate_stack, tstate_stack->len - 1);
+    py_tstate_switch(tstate);
+
+    Py_XDECREF(script);
+}
+
+/* Return the running script. Code entered through a signal, command, timeout,
+ * io watch or statusbar handler, or running at load time, has its script set
+ * by the caller. Anything else (eg. /py exec) falls back to traversing the
+ * stack backwards to find the nearest valid _script object in globals.
+ *
+ * current_script belongs to the main thread. A worker job runs for the 
+ * script that submitted it, other threads only have their own stack.
+ */
 PyObject *pyloader_find_script_obj(void)
 {
     PyFrameObject *frame;
 
+    if (py_is_main_thread())
+    {
+        if (current_script)
+            return current_script;
+    }
+    else
+    {
+        PyObject *script = pyworker_current_script();
+
+        if (script)
+            return script;
+    }
+
     frame = PyEval_GetFrame();
     Py_XINCREF(frame);
 
@@ -293,7 +635,15 @@ PyObject *pyloader_find_script_obj(void)
             Py_XDECREF(frame);
             g_return_val_if_reached(NULL);
         }
+#ifdef Py_GIL_DISABLED
+        /* a worker thread may be changing the globals; the script itself 
+           is kept alive by script_modules */
+        if (PyDict_GetItemStringRef(globals, "_script", &script) < 0)
+            PyErr_Clear();
+        Py_XDECREF(script);
+#else
         script = PyDict_GetItemString(globals, "_script");
+#endif
 
         if (script && pyscript_check(script))
         {
@@ -430,6 +780,9 @@ int pyloader_init(void)
     script_modules = PyList_New(0);
     if (!script_modules)
         return 0;
+
+    main_tstate = PyThreadState_Get();
+    tstate_stack = g_ptr_array_new();
     
     /* Add script location to the load path */
     pyhome = g_strdup_printf("%s/scripts", get_irssi_dir());
@@ -438,6 +791,10 @@ int pyloader_init(void)
    
     /* typically /usr/local/share/irssi/scripts */
     pyloader_add_script_path(SCRIPTDIR);
+
+    /* /py host, see irssi_host.py */
+    settings_add_str("python", "python_host_interpreter", "");
+    settings_add_str("python", "python_host_record_dir", "");
    
     return 1;
 }
@@ -449,10 +806,30 @@ static void py_clear_scripts()
     for (i = 0; i < PyList_Size(script_modules); i++)
     {
         PyObject *scr = PyList_GET_ITEM(script_modules, i);
-        pyscript_cleanup(scr);
+
+        py_script_cleanup(scr);
+        if (pyscript_get_tstate(scr))
+        {
+            Py_INCREF(scr);
+            py_interp_end(scr);
+        }
+    }
+
+    /* nothing runs any more, the workers are gone too */
+    if (dying_tag)
+        g_source_remove(dying_tag);
+    dying_tag = 0;
+    while (dying_scripts)
+    {
+        PyObject *scr = dying_scripts->data;
+
+        dying_scripts = g_slist_delete_link(dying_scripts, dying_scripts);
+        py_interp_end(scr);
     }
 
     Py_DECREF(script_modules);
+    g_ptr_array_free(tstate_stack, TRUE);
+    tstate_stack = NULL;
 }
 
 void pyloader_deinit(void)
@@ -467,5 +844,8 @@ void pyloader_deinit(void)
     g_slist_free(script_paths);
     script_paths = NULL;
 
+    settings_remove("python_host_interpreter");
+    settings_remove("python_host_record_dir");
+
     py_clear_scripts();
 }
@@ -9,9 +9,16 @@ typedef struct
 
 void pyloader_add_script_path(const char *path);
 int pyloader_load_script_argv(char **argv);
+int pyloader_host_script_argv(char **argv);
+int pyloader_isolate_script_argv(char **argv);
 int pyloader_load_script(char *name);
 int pyloader_unload_script(const char *name);
 PyObject *pyloader_find_script_obj(void);
+PyObject *pyloader_get_script(const char *name);
+int pyloader_script_loaded(PyObject *script);
+PyObject *pyloader_script_enter(PyObject *script);
+void pyloader_script_leave(PyObject *prev);
+void pyloader_text_mode_sync(void);
 const char *pyloader_find_script_name(void);
 
 GSList *pyloader_list(void);
@@ -27,6 +27,7 @@
 #include "pyloader.h"
 #include "pythemes.h"
 #include "pystatusbar.h"
+#include "pyworker.h"
 
 /*
  * This module is some what different than the Perl's.
@@ -52,7 +53,7 @@ static PyObject *PY_command(PyObject *self, PyObject *args, PyObject *kwds)
     static char *kwlist[] = {"cmd", NULL};
     char *cmd = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &cmd))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &cmd))
         return NULL;
 
     py_command(cmd, NULL, NULL);
@@ -72,8 +73,8 @@ static PyObject *py_prnt(PyObject *self, PyObject *args, PyObject *kwargs)
     int msglvl = MSGLEVEL_CLIENTNOTICE;
     char *text = NULL;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y|i:prnt", kwlist, &text,
-                                     &msglvl))
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O&|i:prnt", kwlist,
+                                     py_str_conv, &text, &msglvl))
         return NULL;
 
     printtext_string(NULL, NULL, msglvl, text);
@@ -110,7 +111,8 @@ static PyObject *py_chatnet_find(PyObject *self, PyObject *args, PyObject *kwds)
     static char *kwlist[] = {"name", NULL};
     char *name = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &name))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &name))
         return NULL;
 
     return py_irssi_chat_new(chatnet_find(name), 1);
@@ -166,7 +168,8 @@ static PyObject *py_channel_find(PyObject *self, PyObject *args, PyObject *kwds)
     static char *kwlist[] = {"name", NULL};
     char *name = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &name))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &name))
         return NULL;
 
     return py_irssi_chat_new(channel_find(NULL, name), 1);
@@ -219,7 +222,8 @@ static PyObject *py_window_find_name(PyObject *self, PyObject *args, PyObject *k
     char *name = "";
     WINDOW_REC *win;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &name))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &name))
         return NULL;
 
     win = window_find_name(name);
@@ -330,7 +334,8 @@ static PyObject *py_window_find_item(PyObject *self, PyObject *args, PyObject *k
     char *name = "";
     WINDOW_REC *win;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &name))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &name))
         return NULL;
 
     win = window_find_item(NULL, name);
@@ -353,7 +358,8 @@ static PyObject *py_window_find_closest(PyObject *self, PyObject *args, PyObject
     int level = 0;
     WINDOW_REC *win;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yi", kwlist, &name, &level))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&i", kwlist,
+                                     py_str_conv, &name, &level))
         return NULL;
 
     win = window_find_closest(NULL, name, level);
@@ -373,7 +379,8 @@ static PyObject *py_window_item_find(PyObject *self, PyObject *args, PyObject *k
     static char *kwlist[] = {"name", NULL};
     char *name = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &name))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &name))
         return NULL;
 
     return py_irssi_chat_new(window_item_find(NULL, name), 1);
@@ -430,7 +437,7 @@ static PyObject *py_server_find_tag(PyObject *self, PyObject *args, PyObject *kw
     static char *kwlist[] = {"tag", NULL};
     char *tag = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &tag))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &tag))
         return NULL;
 
     return py_irssi_chat_new(server_find_tag(tag), 1);
@@ -446,7 +453,8 @@ static PyObject *py_server_find_chatnet(PyObject *self, PyObject *args, PyObject
     static char *kwlist[] = {"chatnet", NULL};
     char *chatnet = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &chatnet))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &chatnet))
         return NULL;
 
     return py_irssi_chat_new(server_find_chatnet(chatnet), 1);
@@ -472,7 +480,8 @@ static PyObject *py_query_find(PyObject *self, PyObject *args, PyObject *kwds)
     static char *kwlist[] = {"nick", NULL};
     char *nick = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &nick))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &nick))
         return NULL;
 
     return py_irssi_chat_new(query_find(NULL, nick), 1);
@@ -491,8 +500,9 @@ static PyObject *py_mask_match(PyObject *self, PyObject *args, PyObject *kwds)
     char *user = "";
     char *host = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyyy", kwlist, &mask, &nick,
-                                     &user, &host))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&O&O&", kwlist,
+                                     py_str_conv, &mask, py_str_conv, &nick,
+                                     py_str_conv, &user, py_str_conv, &host))
         return NULL;
 
     return PyBool_FromLong(mask_match(NULL, mask, nick, user, host));
@@ -510,8 +520,9 @@ static PyObject *py_mask_match_address(PyObject *self, PyObject *args, PyObject
     char *nick = "";
     char *address = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyy", kwlist, &mask, &nick,
-                                     &address))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&O&", kwlist,
+                                     py_str_conv, &mask, py_str_conv, &nick,
+                                     py_str_conv, &address))
         return NULL;
 
     return PyBool_FromLong(mask_match_address(NULL, mask, nick, address));
@@ -530,8 +541,9 @@ static PyObject *py_masks_match(PyObject *self, PyObject *args, PyObject *kwds)
     char *nick = "";
     char *address = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyy", kwlist, &masks, &nick,
-                                     &address))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&O&", kwlist,
+                                     py_str_conv, &masks, py_str_conv, &nick,
+                                     py_str_conv, &address))
         return NULL;
 
     return PyBool_FromLong(masks_match(NULL, masks, nick, address));
@@ -577,7 +589,8 @@ static PyObject *py_log_find(PyObject *self, PyObject *args, PyObject *kwds)
     char *fname = "";
     LOG_REC *log;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &fname))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &fname))
         return NULL;
 
     log = log_find(fname);
@@ -611,8 +624,10 @@ static PyObject *py_ignore_check(PyObject *self, PyObject *args, PyObject *kwds)
     char *text = "";
     int level = 0;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yyyyi", kwlist, &nick, &host,
-                                     &channel, &text, &level))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&O&O&i", kwlist,
+                                     py_str_conv, &nick, py_str_conv, &host,
+                                     py_str_conv, &channel, py_str_conv, &text,
+                                     &level))
         return NULL;
 
     return PyBool_FromLong(ignore_check(NULL, nick, host, channel, text, level));
@@ -638,7 +653,8 @@ static PyObject *py_dcc_register_type(PyObject *self, PyObject *args, PyObject *
     static char *kwlist[] = {"type", NULL};
     char *type = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &type))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &type))
         return NULL;
 
     dcc_register_type(type);
@@ -656,7 +672,8 @@ static PyObject *py_dcc_unregister_type(PyObject *self, PyObject *args, PyObject
     static char *kwlist[] = {"type", NULL};
     char *type = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &type))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &type))
         return NULL;
 
     dcc_unregister_type(type);
@@ -693,8 +710,8 @@ static PyObject *py_dcc_find_request(PyObject *self, PyObject *args, PyObject *k
     char *nick = "";
     char *arg = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "iyy", kwlist, &type, &nick,
-                                     &arg))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "iO&O&", kwlist, &type,
+                                     py_str_conv, &nick, py_str_conv, &arg))
         return NULL;
 
     return py_irssi_new(dcc_find_request(type, nick, arg), 1);
@@ -710,7 +727,7 @@ static PyObject *py_dcc_chat_find_id(PyObject *self, PyObject *args, PyObject *k
     static char *kwlist[] = {"id", NULL};
     char *id = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &id))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &id))
         return NULL;
 
     return py_irssi_new(dcc_chat_find_id(id), 1);
@@ -726,7 +743,8 @@ static PyObject *py_dcc_str2type(PyObject *self, PyObject *args, PyObject *kwds)
     static char *kwlist[] = {"type", NULL};
     char *type = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &type))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &type))
         return NULL;
 
     return PyLong_FromLong(dcc_str2type(type));
@@ -761,7 +779,8 @@ static PyObject *py_dcc_get_download_path(PyObject *self, PyObject *args, PyObje
     char *path;
     PyObject *pypath;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &fname))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &fname))
         return NULL;
 
     path = dcc_get_download_path(fname);
@@ -797,8 +816,8 @@ static PyObject *py_notifylist_add(PyObject *self, PyObject *args, PyObject *kwd
     int away_check = 0;
     NOTIFYLIST_REC *rec;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y|zi", kwlist, &mask,
-                                     &ircnets, &away_check))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|zi", kwlist,
+                                     py_str_conv, &mask, &ircnets, &away_check))
         return NULL;
 
     rec = notifylist_add(mask, ircnets, away_check);
@@ -818,7 +837,8 @@ static PyObject *py_notifylist_remove(PyObject *self, PyObject *args, PyObject *
     static char *kwlist[] = {"mask", NULL};
     char *mask = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &mask))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &mask))
         return NULL;
 
     notifylist_remove(mask);
@@ -838,8 +858,9 @@ static PyObject *py_notifylist_ison(PyObject *self, PyObject *args, PyObject *kw
     char *nick = "";
     char *serverlist = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y|y", kwlist, &nick,
-                                     &serverlist))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|O&", kwlist,
+                                     py_str_conv, &nick,
+                                     py_str_conv, &serverlist))
         return NULL;
 
     return py_irssi_chat_new(notifylist_ison(nick, serverlist), 1);
@@ -857,7 +878,8 @@ static PyObject *py_notifylist_find(PyObject *self, PyObject *args, PyObject *kw
     char *ircnet = NULL;
     NOTIFYLIST_REC *rec;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y|z", kwlist, &mask, &ircnet))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&|z", kwlist,
+                                     py_str_conv, &mask, &ircnet))
         return NULL;
 
     rec = notifylist_find(mask, ircnet);
@@ -888,7 +910,8 @@ static PyObject *py_level2bits(PyObject *self, PyObject *args, PyObject *kwds)
     char *level = "";
     int error = 0;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &level))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &level))
         return NULL;
 
     return PyLong_FromUnsignedLong(level2bits(level, &error));
@@ -932,7 +955,8 @@ static PyObject *py_combine_level(PyObject *self, PyObject *args, PyObject *kwds
     int level = 0;
     char *str = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "iy", kwlist, &level, &str))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "iO&", kwlist, &level,
+                                     py_str_conv, &str))
         return NULL;
 
     return PyLong_FromUnsignedLong(combine_level(level, str));
@@ -946,9 +970,7 @@ PyDoc_STRVAR(py_signal_emit_doc,
 static PyObject *py_signal_emit(PyObject *self, PyObject *args)
 {
     PyObject *pysig;
-    PyObject *sigargs;
     char *name;
-    int ret;
 
     if (PyTuple_Size(args) < 1)
         return PyErr_Format(PyExc_TypeError, "signal name required");
@@ -958,19 +980,44 @@ static PyObject *py_signal_emit(PyObject *self, PyObject *args)
                 "no more than %d arguments for signal accepted", SIGNAL_MAX_ARGUMENTS);
 
     pysig = PyTuple_GET_ITEM(args, 0);
-    if (!PyBytes_Check(pysig))
+    if (!PyBytes_Check(pysig) && !PyUnicode_Check(pysig))
         return PyErr_Format(PyExc_TypeError, "signal must be string");
 
-    name = PyBytes_AsString(pysig);
-    if (!name)
+    if (!py_str_conv(pysig, &name))
         return NULL;
     
-    sigargs = PySequence_GetSlice(args, 1, PyTuple_Size(args));
-    if (!sigargs)
+    /* the arguments are read in place, no need for a slice */
+    if (!pysignals_emit(name, &PyTuple_GET_ITEM(args, 1), PyTuple_GET_SIZE(args) - 1))
+        return NULL;
+
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(py_call_soon_threadsafe_doc,
+    "call_soon_threadsafe(func, *args) -> None\n"
+    "\n"
+    "Call func(*args) on the main thread. This is the only function of this\n"
+    "module that may be called from other threads. From a worker started by\n"
+    "run_in_worker(), func runs with that script current.\n"
+);
+static PyObject *py_call_soon_threadsafe(PyObject *self, PyObject *args)
+{
+    PyObject *func, *fargs;
+    int ret;
+
+    if (PyTuple_GET_SIZE(args) < 1)
+        return PyErr_Format(PyExc_TypeError, "call_soon_threadsafe() needs a function");
+
+    func = PyTuple_GET_ITEM(args, 0);
+    if (!PyCallable_Check(func))
+        return PyErr_Format(PyExc_TypeError, "func must be callable");
+
+    fargs = PyTuple_GetSlice(args, 1, PyTuple_GET_SIZE(args));
+    if (!fargs)
         return NULL;
 
-    ret = pysignals_emit(name, sigargs);
-    Py_DECREF(sigargs);
+    ret = pyworker_call_soon(pyworker_current_script(), func, fargs);
+    Py_DECREF(fargs);
     if (!ret)
         return NULL;
 
@@ -1001,7 +1048,7 @@ PyDoc_STRVAR(py_signal_stop_doc,
 );
 static PyObject *py_signal_stop(PyObject *self, PyObject *args)
 {
-    signal_stop();
+    pysignals_stop();
     Py_RETURN_NONE;
 }
 
@@ -1015,10 +1062,11 @@ static PyObject *py_signal_stop_by_name(PyObject *self, PyObject *args, PyObject
     static char *kwlist[] = {"signal", NULL};
     char *signal = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &signal))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &signal))
         return NULL;
 
-    signal_stop_by_name(signal);
+    pysignals_stop_by_name(signal);
     
     Py_RETURN_NONE;
 }
@@ -1053,7 +1101,7 @@ static PyObject *py_settings_get_str(PyObject *self, PyObject *args, PyObject *k
     static char *kwlist[] = {"key", NULL};
     char *key = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &key))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &key))
         return NULL;
 
     RET_AS_STRING_OR_NONE(settings_get_str(key));
@@ -1069,7 +1117,7 @@ static PyObject *py_settings_get_int(PyObject *self, PyObject *args, PyObject *k
     static char *kwlist[] = {"key", NULL};
     char *key = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &key))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &key))
         return NULL;
 
     return PyLong_FromLong(settings_get_int(key));
@@ -1085,7 +1133,7 @@ static PyObject *py_settings_get_bool(PyObject *self, PyObject *args, PyObject *
     static char *kwlist[] = {"key", NULL};
     char *key = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &key))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &key))
         return NULL;
 
     return PyBool_FromLong(settings_get_bool(key));
@@ -1101,7 +1149,7 @@ static PyObject *py_settings_get_time(PyObject *self, PyObject *args, PyObject *
     static char *kwlist[] = {"key", NULL};
     char *key = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &key))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &key))
         return NULL;
 
     return PyLong_FromLong(settings_get_time(key));
@@ -1117,7 +1165,7 @@ static PyObject *py_settings_get_level(PyObject *self, PyObject *args, PyObject
     static char *kwlist[] = {"key", NULL};
     char *key = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &key))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &key))
         return NULL;
 
     return PyLong_FromLong(settings_get_level(key));
@@ -1133,7 +1181,7 @@ static PyObject *py_settings_get_size(PyObject *self, PyObject *args, PyObject *
     static char *kwlist[] = {"key", NULL};
     char *key = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &key))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &key))
         return NULL;
 
     return PyLong_FromLong(settings_get_size(key));
@@ -1150,7 +1198,8 @@ static PyObject *py_settings_set_str(PyObject *self, PyObject *args, PyObject *k
     char *key = "";
     char *value = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yy", kwlist, &key, &value))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&", kwlist,
+                                     py_str_conv, &key, py_str_conv, &value))
         return NULL;
 
     settings_set_str(key, value);
@@ -1169,7 +1218,8 @@ static PyObject *py_settings_set_int(PyObject *self, PyObject *args, PyObject *k
     char *key = "";
     int value = 0;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yi", kwlist, &key, &value))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&i", kwlist,
+                                     py_str_conv, &key, &value))
         return NULL;
 
     settings_set_int(key, value);
@@ -1188,7 +1238,8 @@ static PyObject *py_settings_set_bool(PyObject *self, PyObject *args, PyObject *
     char *key = "";
     int value = 0;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yi", kwlist, &key, &value))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&i", kwlist,
+                                     py_str_conv, &key, &value))
         return NULL;
 
     settings_set_bool(key, value);
@@ -1207,7 +1258,8 @@ static PyObject *py_settings_set_time(PyObject *self, PyObject *args, PyObject *
     char *key = "";
     char *value = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yy", kwlist, &key, &value))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&", kwlist,
+                                     py_str_conv, &key, py_str_conv, &value))
         return NULL;
 
     return PyBool_FromLong(settings_set_time(key, value));
@@ -1224,7 +1276,8 @@ static PyObject *py_settings_set_level(PyObject *self, PyObject *args, PyObject
     char *key = "";
     char *value = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yy", kwlist, &key, &value))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&", kwlist,
+                                     py_str_conv, &key, py_str_conv, &value))
         return NULL;
 
     return PyBool_FromLong(settings_set_level(key, value));
@@ -1241,7 +1294,8 @@ static PyObject *py_settings_set_size(PyObject *self, PyObject *args, PyObject *
     char *key = "";
     char *value = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yy", kwlist, &key, &value))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&", kwlist,
+                                     py_str_conv, &key, py_str_conv, &value))
         return NULL;
 
     return PyBool_FromLong(settings_set_size(key, value));
@@ -1293,7 +1347,7 @@ static PyObject *py_format_get_length(PyObject *self, PyObject *args, PyObject *
     static char *kwlist[] = {"str", NULL};
     char *str = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &str))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, py_str_conv, &str))
         return NULL;
 
     return PyLong_FromLong(format_get_length(str));
@@ -1308,7 +1362,8 @@ static PyObject *py_format_real_length(PyObject *self, PyObject *args, PyObject
     char *str = "";
     int len;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yl", kwlist, &str, &len))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&l", kwlist,
+                                     py_str_conv, &str, &len))
         return NULL;
 
     return PyLong_FromLong(format_real_length(str, len));
@@ -1324,7 +1379,8 @@ static PyObject *py_strip_codes(PyObject *self, PyObject *args, PyObject *kwds)
     char *ret;
     PyObject *pyret;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &input))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &input))
         return NULL;
 
     ret = strip_codes(input);
@@ -1391,7 +1447,7 @@ static PyObject *py_format_get_text(PyObject *self, PyObject *varargs)
         PyObject *obj = PyTuple_GET_ITEM(pycharargs, i);
         char *str; 
        
-        if (!PyBytes_Check(obj))
+        if (!PyBytes_Check(obj) && !PyUnicode_Check(obj))
         {
             PyErr_Format(PyExc_TypeError, 
                     "non string in string argument list (arg %d)", 
@@ -1399,8 +1455,7 @@ static PyObject *py_format_get_text(PyObject *self, PyObject *varargs)
             goto error;
         }
         
-        str = PyBytes_AsString(obj);
-        if (!str)
+        if (!py_str_conv(obj, &str))
             goto error;
 
         charargs[i] = str;
@@ -1461,7 +1516,8 @@ static PyObject *py_statusbar_items_redraw(PyObject *self, PyObject *args, PyObj
     static char *kwlist[] = {"name", NULL};
     char *name = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &name))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &name))
         return NULL;
 
     statusbar_items_redraw(name);
@@ -1488,7 +1544,8 @@ static PyObject *py_statusbar_item_unregister(PyObject *self, PyObject *args, Py
     static char *kwlist[] = {"name", NULL};
     char *name = "";
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y", kwlist, &name))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist,
+                                     py_str_conv, &name))
         return NULL;
 
     pystatusbar_item_unregister(name);
@@ -1540,7 +1597,8 @@ static GSList *py_register_conv(PyObject *list)
         int val;
         PyObject *tup = PyList_GET_ITEM(list, i);
 
-        if (!PyTuple_Check(tup) || !PyArg_ParseTuple(tup, "yi", &key, &val))
+        if (!PyTuple_Check(tup) || !PyArg_ParseTuple(tup, "O&i",
+                                                     py_str_conv, &key, &val))
         {
             if (!PyErr_Occurred() || PyErr_ExceptionMatches(PyExc_TypeError))
             {
@@ -1614,8 +1672,9 @@ static PyObject *py_server_redirect_register(PyObject *self, PyObject *args, PyO
     GSList *gstop = NULL;
     GSList *gopt = NULL;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yO|OOii", kwlist, &command,
-                                     &stop, &start, &opt, &remote, &timeout))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O|OOii", kwlist,
+                                     py_str_conv, &command, &stop, &start, &opt,
+                                     &remote, &timeout))
         return NULL;
 
     gstart = py_register_conv(start); 
@@ -1680,7 +1739,8 @@ static PyObject *py_command_runsub(PyObject *self, PyObject *args, PyObject *kwd
     SERVER_REC *server = NULL;
     WI_ITEM_REC *item = NULL;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "yy|OO", kwlist, &cmd, &data,
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&|OO", kwlist,
+                                     py_str_conv, &cmd, py_str_conv, &data,
                                      &pserver, &pitem))
         return NULL;
 
@@ -1808,6 +1868,8 @@ static PyMethodDef ModuleMethods[] = {
         py_combine_level_doc},
     {"signal_emit", (PyCFunction)py_signal_emit, METH_VARARGS,
         py_signal_emit_doc},
+    {"call_soon_threadsafe", (PyCFunction)py_call_soon_threadsafe, METH_VARARGS,
+        py_call_soon_threadsafe_doc},
     {"signal_stop", (PyCFunction)py_signal_stop, METH_NOARGS,
         py_signal_stop_doc},
     {"signal_stop_by_name", (PyCFunction)py_signal_stop_by_name, METH_VARARGS | METH_KEYWORDS,
@@ -1882,9 +1944,95 @@ static struct PyModuleDef IrssiModuleDef = {
     .m_methods = ModuleMethods,
 };
 
+#ifdef Py_GIL_DISABLED
+/* Free-threaded builds: other threads may only use call_soon_threadsafe(),
+ * see PY_CHECK_THREAD(). The other functions are replaced by wrappers that
+ * check the thread first. The wrapper's self is a capsule holding the 
+ * original definition.
+ */
+static PyMethodDef py_guarded_methods[G_N_ELEMENTS(ModuleMethods)];
+
+static PyObject *py_guarded_call(PyObject *capsule, PyObject *args, PyObject *kwds)
+{
+    PyMethodDef *def = PyCapsule_GetPointer(capsule, NULL);
+
+    if (!def || !py_check_main_thread())
+        return NULL;
+
+    if (def->ml_flags & METH_KEYWORDS)
+        return ((PyCFunctionWithKeywords)(void (*)(void))def->ml_meth)(py_module, args, kwds);
+
+    if (kwds && PyDict_GET_SIZE(kwds) > 0)
+        return PyErr_Format(PyExc_TypeError, "%s() takes no keyword arguments", 
+                def->ml_name);
+
+    if (def->ml_flags & METH_NOARGS)
+    {
+        if (PyTuple_GET_SIZE(args) != 0)
+            return PyErr_Format(PyExc_TypeError, "%s() takes no arguments", 
+                    def->ml_name);
+        return def->ml_meth(py_module, NULL);
+    }
+
+    return def->ml_meth(py_module, args);
+}
+
+static int py_guard_methods(PyObject *module)
+{
+    PyObject *modname;
+    PyMethodDef *def;
+    int i;
+
+    modname = PyModule_GetNameObject(module);
+    if (!modname)
+        return 0;
+
+    for (def = ModuleMethods, i = 0; def->ml_name != NULL; def++, i++)
+    {
+        PyObject *capsule, *func;
+
+        if (def->ml_meth == (PyCFunction)py_call_soon_threadsafe)
+            continue;
+
+        py_guarded_methods[i].ml_name = def->ml_name;
+        py_guarded_methods[i].ml_meth = (PyCFunction)(void (*)(void))py_guarded_call;
+        py_guarded_methods[i].ml_flags = METH_VARARGS | METH_KEYWORDS;
+        py_guarded_methods[i].ml_doc = def->ml_doc;
+
+        capsule = PyCapsule_New(def, NULL, NULL);
+        if (!capsule)
+            goto error;
+
+        func = PyCFunction_NewEx(&py_guarded_methods[i], capsule, modname);
+        Py_DECREF(capsule);
+        if (!func || PyModule_AddObject(module, def->ml_name, func) < 0)
+        {
+            Py_XDECREF(func);
+            goto error;
+        }
+    }
+
+    Py_DECREF(modname);
+    return 1;
+
+error:
+    Py_DECREF(modname);
+    return 0;
+}
+#endif
+
 PyObject *PyInit_IrssiModule(void)
 {
     py_module = PyModule_Create(&IrssiModuleDef);
+
+#ifdef Py_GIL_DISABLED
+    /* keep the GIL off when the module is imported */
+    if (py_module)
+        PyUnstable_Module_SetGIL(py_module, Py_MOD_GIL_NOT_USED);
+    if (py_module && !py_guard_methods(py_module))
+        Py_CLEAR(py_module);
+#endif
+
     return py_module;
 }
 
@@ -8,5 +8,6 @@ extern PyObject *py_module;
 PyObject *PyInit_IrssiModule(void);
 int pymodule_init(void);
 void pymodule_deinit(void);
+int pycapi_init(void);
 
 #endif
@@ -0,0 +1,432 @@
+/* 
+    irssi-python
+
+    Copyright (C) 2006 Christopher Davis
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <Python.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Single producer, single consumer ring of byte records in shared memory,
+ * used between Irssi and the script host processes (irssi_host.py). This
+ * is a separate extension module, _irssi_ring, so the host process can 
+ * load it without Irssi.
+ *
+ * Records are a 32 bit length followed by the payload, padded to 4 bytes.
+ * A record never wraps: if it doesn't fit before the end of the buffer, a
+ * PY_RING_WRAP marker sends the reader back to the start. head and tail 
+ * run freely and are only masked on access; the producer publishes head
+ * with a release store after the payload, and the consumer publishes tail
+ * the same way after reading, so neither side ever locks.
+ *
+ * The ring doesn't wake anyone up; the processes do that with a pipe.
+ */
+
+#define PY_RING_MAGIC 0x49525247 /* IRRG */
+#define PY_RING_WRAP 0xffffffffu
+#define PY_RING_MIN 4096
+#define PY_RING_MAX (1u << 30)
+#define PY_RING_ALIGN(n) (((n) + 3) & ~3u)
+
+/* head and tail on cache lines of their own */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t size;
+    char pad1[56];
+    uint32_t head;      /* written by the producer */
+    char pad2[60];
+    uint32_t tail;      /* written by the consumer */
+    char pad3[60];
+} PY_RING_HEADER;
+
+typedef struct
+{
+    PyObject_HEAD
+    int fd;
+    PY_RING_HEADER *hdr;
+    unsigned char *data;
+    uint32_t size;
+} PyRing;
+
+static PyTypeObject PyRingType;
+
+#define RING_LOAD(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define RING_STORE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+#define RET_NULL_IF_CLOSED(self)                                               \
+    if ((self)->hdr == NULL)                                                   \
+        return PyErr_Format(PyExc_ValueError, "ring is closed")
+
+static int py_ring_map(PyRing *self, int fd, uint32_t size)
+{
+    void *mem;
+
+    mem = mmap(NULL, sizeof(PY_RING_HEADER) + size, PROT_READ | PROT_WRITE, 
+            MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED)
+    {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return 0;
+    }
+
+    self->fd = fd;
+    self->hdr = mem;
+    self->data = (unsigned char *)mem + sizeof(PY_RING_HEADER);
+    self->size = size;
+
+    return 1;
+}
+
+/* anonymous shared memory, inherited by the host process as a fd */
+static int py_ring_shm_open(void)
+{
+    char name[64];
+    int fd, i;
+
+    for (i = 0; i < 16; i++)
+    {
+        PyOS_snprintf(name, sizeof(name), "/irssi-python-%ld-%d-%u", 
+                (long)getpid(), i, (unsigned)rand());
+
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0)
+        {
+            shm_unlink(name);
+            return fd;
+        }
+    }
+
+    return -1;
+}
+
+static void py_ring_close(PyRing *self)
+{
+    if (self->hdr)
+        munmap(self->hdr, sizeof(PY_RING_HEADER) + self->size);
+    if (self->fd >= 0)
+        close(self->fd);
+
+    self->hdr = NULL;
+    self->data = NULL;
+    self->fd = -1;
+}
+
+static void PyRing_dealloc(PyRing *self)
+{
+    py_ring_close(self);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *PyRing_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"size", NULL};
+    unsigned long want = 1 << 20;
+    uint32_t size = PY_RING_MIN;
+    PyRing *self;
+    int fd;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|k", kwlist, &want))
+        return NULL;
+
+    if (want > PY_RING_MAX)
+        return PyErr_Format(PyExc_ValueError, "ring size is limited to %u bytes", 
+                PY_RING_MAX);
+
+    while (size < want)
+        size <<= 1;
+
+    fd = py_ring_shm_open();
+    if (fd < 0)
+        return PyErr_SetFromErrno(PyExc_OSError);
+
+    if (ftruncate(fd, sizeof(PY_RING_HEADER) + size) != 0)
+    {
+        PyErr_SetFromErrno(PyExc_OSError);
+        close(fd);
+        return NULL;
+    }
+
+    self = (PyRing *)type->tp_alloc(type, 0);
+    if (!self)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    self->fd = -1;
+    if (!py_ring_map(self, fd, size))
+    {
+        close(fd);
+        Py_DECREF(self);
+        return NULL;
+    }
+
+    self->hdr->size = size;
+    RING_STORE(&self->hdr->magic, PY_RING_MAGIC);
+
+    return (PyObject *)self;
+}
+
+PyDoc_STRVAR(PyRing_attach_doc,
+    "attach(fd) -> Ring\n"
+    "\n"
+    "Map a ring created by another process. The Ring owns fd afterwards.\n"
+);
+static PyObject *PyRing_attach(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"fd", NULL};
+    PY_RING_HEADER hdr;
+    struct stat st;
+    PyRing *self;
+    int fd;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "i", kwlist, &fd))
+        return NULL;
+
+    if (fstat(fd, &st) != 0)
+        return PyErr_SetFromErrno(PyExc_OSError);
+
+    if (st.st_size < (off_t)sizeof(hdr) || pread(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr))
+        return PyErr_Format(PyExc_ValueError, "fd %d is not a ring", fd);
+
+    if (hdr.magic != PY_RING_MAGIC || hdr.size < PY_RING_MIN || hdr.size > PY_RING_MAX ||
+            (hdr.size & (hdr.size - 1)) != 0 || 
+            st.st_size < (off_t)(sizeof(hdr) + hdr.size))
+        return PyErr_Format(PyExc_ValueError, "fd %d is not a ring", fd);
+
+    self = (PyRing *)type->tp_alloc(type, 0);
+    if (!self)
+        return NULL;
+
+    self->fd = -1;
+    if (!py_ring_map(self, fd, hdr.size))
+    {
+        Py_DECREF(self);
+        return NULL;
+    }
+
+    return (PyObject *)self;
+}
+
+PyDoc_STRVAR(PyRing_put_doc,
+    "put(data) -> bool\n"
+    "\n"
+    "Append one record. Return False if there is no room for it; records\n"
+    "are limited to a quarter of the ring.\n"
+);
+static PyObject *PyRing_put(PyRing *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"data", NULL};
+    Py_buffer buf;
+    uint32_t head, tail, off, room, need, len;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y*", kwlist, &buf))
+        return NULL;
+
+    if (self->hdr == NULL || (uint64_t)buf.len > self->size / 4)
+    {
+        PyBuffer_Release(&buf);
+        if (self->hdr == NULL)
+            return PyErr_Format(PyExc_ValueError, "ring is closed");
+        return PyErr_Format(PyExc_ValueError, "record too large for the ring");
+    }
+
+    len = (uint32_t)buf.len;
+    need = 4 + PY_RING_ALIGN(len);
+
+    head = self->hdr->head;
+    tail = RING_LOAD(&self->hdr->tail);
+    room = self->size - (head - tail);
+    off = head & (self->size - 1);
+
+    if (need > self->size - off)
+    {
+        /* doesn't fit before the end; skip the rest and start over */
+        if (need + (self->size - off) > room)
+            goto full;
+        memcpy(self->data + off, &(uint32_t){PY_RING_WRAP}, 4);
+        head += self->size - off;
+        off = 0;
+    }
+    else if (need > room)
+        goto full;
+
+    memcpy(self->data + off, &len, 4);
+    memcpy(self->data + off + 4, buf.buf, len);
+    PyBuffer_Release(&buf);
+
+    RING_STORE(&self->hdr->head, head + need);
+    Py_RETURN_TRUE;
+
+full:
+    PyBuffer_Release(&buf);
+    Py_RETURN_FALSE;
+}
+
+PyDoc_STRVAR(PyRing_get_doc,
+    "get() -> bytes or None\n"
+    "\n"
+    "Take the oldest record, None if the ring is empty.\n"
+);
+static PyObject *PyRing_get(PyRing *self, PyObject *unused)
+{
+    uint32_t head, tail, off, len;
+    PyObject *ret;
+
+    RET_NULL_IF_CLOSED(self);
+
+    tail = self->hdr->tail;
+    head = RING_LOAD(&self->hdr->head);
+
+    if (head == tail)
+        Py_RETURN_NONE;
+
+    /* the other process can write anything to the shared memory; nothing
+       outside the ring may be read, whatever head, tail and len say */
+    if ((tail & 3) || head - tail < 4 || head - tail > self->size)
+        return PyErr_Format(PyExc_RuntimeError, "ring is corrupt");
+
+    off = tail & (self->size - 1);
+    memcpy(&len, self->data + off, 4);
+    if (len == PY_RING_WRAP)
+    {
+        tail += self->size - off;
+        off = 0;
+        if (head - tail < 4 || head - tail > self->size)
+            return PyErr_Format(PyExc_RuntimeError, "ring is corrupt");
+        memcpy(&len, self->data, 4);
+    }
+
+    if (len > self->size / 4 || head - tail < 4 + PY_RING_ALIGN(len) ||
+            (uint64_t)off + 4 + len > self->size)
+        return PyErr_Format(PyExc_RuntimeError, "ring is corrupt");
+
+    ret = PyBytes_FromStringAndSize((char *)self->data + off + 4, len);
+    if (!ret)
+        return NULL;
+
+    RING_STORE(&self->hdr->tail, tail + 4 + PY_RING_ALIGN(len));
+    return ret;
+}
+
+PyDoc_STRVAR(PyRing_fileno_doc,
+    "fileno() -> int\n"
+    "\n"
+    "The shared memory fd, to pass to the other process\n"
+);
+static PyObject *PyRing_fileno(PyRing *self, PyObject *unused)
+{
+    RET_NULL_IF_CLOSED(self);
+
+    return PyLong_FromLong(self->fd);
+}
+
+PyDoc_STRVAR(PyRing_close_doc,
+    "close() -> None\n"
+);
+static PyObject *PyRing_close(PyRing *self, PyObject *unused)
+{
+    py_ring_close(self);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *PyRing_get_size(PyRing *self, void *closure)
+{
+    return PyLong_FromUnsignedLong(self->size);
+}
+
+static PyObject *PyRing_get_used(PyRing *self, void *closure)
+{
+    RET_NULL_IF_CLOSED(self);
+
+    return PyLong_FromUnsignedLong(RING_LOAD(&self->hdr->head) - 
+            RING_LOAD(&self->hdr->tail));
+}
+
+static PyMethodDef PyRing_methods[] = {
+    {"attach", (PyCFunction)PyRing_attach, METH_VARARGS | METH_KEYWORDS | METH_CLASS,
+        PyRing_attach_doc},
+    {"put", (PyCFunction)PyRing_put, METH_VARARGS | METH_KEYWORDS,
+        PyRing_put_doc},
+    {"get", (PyCFunction)PyRing_get, METH_NOARGS,
+        PyRing_get_doc},
+    {"fileno", (PyCFunction)PyRing_fileno, METH_NOARGS,
+        PyRing_fileno_doc},
+    {"close", (PyCFunction)PyRing_close, METH_NOARGS,
+        PyRing_close_doc},
+    {NULL}  /* Sentinel */
+};
+
+static PyGetSetDef PyRing_getseters[] = {
+    {"size", (getter)PyRing_get_size, NULL,
+        "Buffer size in bytes", NULL},
+    {"used", (getter)PyRing_get_used, NULL,
+        "Bytes taken by unread records", NULL},
+    {NULL}
+};
+
+static PyTypeObject PyRingType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name      = "_irssi_ring.Ring",                     /*tp_name*/
+    .tp_basicsize = sizeof(PyRing),                         /*tp_basicsize*/
+    .tp_dealloc   = (destructor)PyRing_dealloc,             /*tp_dealloc*/
+    .tp_flags     = Py_TPFLAGS_DEFAULT,                     /*tp_flags*/
+    .tp_doc       = "Ring(size=1048576) -> new shared memory ring", /* tp_doc */
+    .tp_methods   = PyRing_methods,                         /* tp_methods */
+    .tp_getset    = PyRing_getseters,                       /* tp_getset */
+    .tp_new       = PyRing_new,                             /* tp_new */
+};
+
+static struct PyModuleDef RingModuleDef = {
+    PyModuleDef_HEAD_INIT,
+    .m_name    = "_irssi_ring",
+    .m_doc     = "Shared memory rings for the script host processes",
+    .m_size    = -1,
+};
+
+PyMODINIT_FUNC PyInit__irssi_ring(void)
+{
+    PyObject *m;
+
+    if (PyType_Ready(&PyRingType) < 0)
+        return NULL;
+
+    m = PyModule_Create(&RingModuleDef);
+    if (!m)
+        return NULL;
+
+#ifdef Py_GIL_DISABLED
+    PyUnstable_Module_SetGIL(m, Py_MOD_GIL_NOT_USED);
+#endif
+
+    Py_INCREF(&PyRingType);
+    if (PyModule_AddObject(m, "Ring", (PyObject *)&PyRingType) < 0)
+    {
+        Py_DECREF(&PyRingType);
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    return m;
+}
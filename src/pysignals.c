@@ -22,6 +22,12 @@
 #include "pyirssi.h"
 #include "pysignals.h"
 #include "factory.h"
+#include "pyloader.h"
+#include "pyasync.h"
+
+#if PY_VERSION_HEX < 0x030900A4
+#define PyObject_Vectorcall _PyObject_Vectorcall
+#endif
 
 /* NOTE:
  * There are two different records used to store signal related data:
@@ -61,6 +67,9 @@
  * drop to 0.
  */
 
+/* converts one Irssi signal argument to a new Python object */
+typedef PyObject *(*PY_I2PY_FUNC)(void *iobj);
+
 typedef struct _PY_SIGNAL_SPEC_REC 
 {
     char *name;
@@ -68,6 +77,12 @@ typedef struct _PY_SIGNAL_SPEC_REC
     int refcount;
     int dynamic;
     int is_var; /* is this entry a prefix for a variable signal? */
+
+    /* conversion plan, filled in by py_signal_compile() */
+    int arglen;
+    int has_inout; /* arglist contains IN/OUT args ('G' or 'I') */
+    int has_borrowed; /* arglist contains 'L' or 'G', invalidated after the call */
+    PY_I2PY_FUNC plan[SIGNAL_MAX_ARGUMENTS]; /* NULL for unknown codes */
 } PY_SIGNAL_SPEC_REC;
 
 #include "pysigmap.h"
@@ -94,25 +109,108 @@ typedef struct _PY_SIGNAL_SPEC_REC
  * referencing the "massjoin" SPEC_REC entry will have a NULL command.
  */
 
-/* hashtable for normal signals, tree for variable signal prefixes. */
+/* hashtable for normal signals, and one for variable signal prefixes. All
+ * prefixes end with a space, so a name is looked up by trying each of its
+ * prefixes that ends with a space, longest first.
+ *
+ * Results of py_signal_lookup(), misses included, are cached by full name
+ * until the next signal is registered or unregistered.
+ */
 static GHashTable *py_sighash = NULL;
-static GTree *py_sigtree = NULL;
+static GHashTable *py_sigvar = NULL;
+static GHashTable *py_sigcache = NULL;
+
+#define PY_SIGCACHE_MAX 512
+static PY_SIGNAL_SPEC_REC py_sigcache_miss; /* cached "not found" */
+
+/* Python signal handlers are not bound to Irssi one by one. Handlers for
+ * the same signal name and priority share a PY_SIGNAL_GROUP_REC, which is
+ * registered with Irssi once and calls its handlers in the order they were
+ * added. The Python arguments are built once per emission and passed to
+ * every handler in the group, except for signals with IN/OUT arguments,
+ * where each handler has to see what the previous one left behind.
+ *
+ * Handlers removed while the group is emitting are set to NULL and the
+ * array is compacted when the outermost emission returns.
+ */
+typedef struct _PY_SIGNAL_GROUP_REC
+{
+    char *key;          /* "priority name", key in py_siggroups */
+    char *name;         /* exact signal name bound in Irssi; points into key */
+    int priority;
+    GPtrArray *handlers; /* PY_SIGNAL_REC, NULL for removed entries */
+    int live;           /* non-NULL entries in handlers */
+    int emitting;       /* emission depth */
+} PY_SIGNAL_GROUP_REC;
+
+static GHashTable *py_siggroups = NULL;
+
+/* State of one group emission. signal_stop() and signal_continue() from a
+ * handler have to end the fan-out too, because Irssi only sees the group
+ * proxy. Frames are kept on the C stack, innermost first; command handlers
+ * push a frame without a group.
+ */
+typedef struct _PY_DISPATCH_REC
+{
+    PY_SIGNAL_GROUP_REC *group;
+    guint pos;          /* index of the handler being called */
+    int stopped;
+    struct _PY_DISPATCH_REC *prev;
+} PY_DISPATCH_REC;
+
+static PY_DISPATCH_REC *py_dispatch = NULL;
+
+/* Memory for the C arguments of one emission from Python. Strings are copied
+ * out of the bytes objects (Irssi handlers are free to modify their char *
+ * arguments), nick lists are built from arena nodes and all of it goes away
+ * in one shot after signal_emit()/signal_continue() returns. The first
+ * block lives in the record itself, on the caller's stack.
+ *
+ * String lists ('G') are real GLists because handlers append to and free
+ * them; they are copied back into the Python list after the emission.
+ */
+#define PY_ARENA_INLINE 512
+#define PY_ARENA_BLOCK 4096
+
+typedef struct _PY_ARENA_STRLIST
+{
+    GList *list;        /* g_strdup'd strings, the handlers' GList ** */
+    PyObject *pylist;   /* written back after the emission */
+    struct _PY_ARENA_STRLIST *next;
+} PY_ARENA_STRLIST;
+
+typedef struct
+{
+    char *pos;
+    char *end;
+    void *blocks;       /* heap blocks, each starting with the previous one */
+    PY_ARENA_STRLIST *strlists;
+    char buf[PY_ARENA_INLINE];
+} PY_ARENA_REC;
 
 static void py_run_handler(PY_SIGNAL_REC *rec, void **args);
 static void py_sig_proxy(void *p1, void *p2, void *p3, void *p4, void *p5, void *p6);
+static void py_group_proxy(void *p1, void *p2, void *p3, void *p4, void *p5, void *p6);
+static int py_group_dispatch(PY_SIGNAL_GROUP_REC *group, void **args, guint start);
+static void py_group_add(PY_SIGNAL_REC *rec, int priority);
+static void py_group_remove(PY_SIGNAL_REC *rec);
 static void py_signal_ref(PY_SIGNAL_SPEC_REC *sig);
 static int py_signal_unref(PY_SIGNAL_SPEC_REC *sig);
 static void py_signal_add(PY_SIGNAL_SPEC_REC *sig);
 static PY_SIGNAL_REC *py_signal_rec_new(const char *signal, PyObject *func, const char *command);
 static void py_signal_rec_destroy(PY_SIGNAL_REC *sig);
 static PyObject *py_mkstrlist(void *iobj);
-static PyObject *py_i2py(char code, void *iobj);
-static void *py_py2i(char code, PyObject *pobj, int arg, const char *signal);
-static void py_getstrlist(GList **list, PyObject *pylist);
-static int precmp(const char *spec, const char *test);
+static PY_I2PY_FUNC py_i2py_func(char code);
+static int py_signal_compile(PY_SIGNAL_SPEC_REC *spec);
+static void *py_py2i(char code, PyObject *pobj, int arg, const char *signal, 
+        PY_ARENA_REC *arena);
 static PY_SIGNAL_SPEC_REC *py_signal_lookup(const char *name);
 static void py_signal_remove(PY_SIGNAL_SPEC_REC *sig);
-static int py_convert_args(void **args, PyObject *argtup, const char *signal);
+static int py_convert_args(void **args, PyObject *argtup, const char *signal, 
+        PY_ARENA_REC *arena);
+static int py_convert_argv(void **args, PY_SIGNAL_SPEC_REC *spec, 
+        PyObject *const *argv, Py_ssize_t argc, const char *signal, 
+        PY_ARENA_REC *arena);
 
 PY_SIGNAL_REC *pysignals_command_bind(const char *cmd, PyObject *func, 
         const char *category, int priority)
@@ -126,42 +224,374 @@ PY_SIGNAL_REC *pysignals_command_bind(const char *cmd, PyObject *func,
     return rec;
 }
 
-int pysignals_command_bind_list(GSList **list, const char *command, 
-        PyObject *func, const char *category, int priority)
+int pysignals_command_bind_list(GSList **list, PyObject *script, 
+        const char *command, PyObject *func, const char *category, int priority)
 {
     PY_SIGNAL_REC *rec = pysignals_command_bind(command, func, category, priority);
     if (!rec)
         return 0;
 
+    /* borrowed; the script removes its list before it goes away */
+    rec->script = script;
+
     *list = g_slist_append(*list, rec);
     return 1;
 }
 
-/* return NULL if signal is invalid */
-PY_SIGNAL_REC *pysignals_signal_add(const char *signal, PyObject *func, int priority)
+/* Positions of the text, nick, address and target strings of the message
+ * signals. "event <cmd>" has its nick and address as the third and fourth
+ * arguments. Other signals only get their server, target and nick from 
+ * typed arguments, see py_filter_resolve().
+ */
+static const struct
+{
+    const char *name;
+    int text, nick, address, target;
+} py_message_args[] = {
+    {"message public",          1,  2,  3,  4},
+    {"message private",         1,  2,  3,  4},
+    {"message own_public",      1, -1, -1,  2},
+    {"message own_private",     1, -1, -1,  2},
+    {"message join",           -1,  2,  3,  1},
+    {"message part",            4,  2,  3,  1},
+    {"message quit",            3,  1,  2, -1},
+    {"message kick",            5,  3,  4,  1},
+    {"message nick",           -1,  2,  3, -1},
+    {"message topic",           2,  3,  4,  1},
+    {"message invite",         -1,  2,  3,  1},
+    {"message irc action",      1,  2,  3,  4},
+    {"message irc notice",      1,  2,  3,  4},
+    {"message irc own_action",  1, -1, -1,  2},
+    {"message irc own_notice",  1, -1, -1,  2},
+    {NULL}
+};
+
+void pysignals_filter_free(PY_SIGNAL_FILTER_REC *filter)
+{
+    if (!filter)
+        return;
+
+    g_strfreev(filter->tags);
+    g_strfreev(filter->targets);
+    g_free(filter->nick);
+    if (filter->regex)
+        g_regex_unref(filter->regex);
+    g_free(filter);
+}
+
+/* find the arguments the filter looks at, sets a Python exception and 
+   returns 0 if the signal doesn't carry one of them */
+static int py_filter_resolve(PY_SIGNAL_FILTER_REC *filter, PY_SIGNAL_REC *rec)
+{
+    const char *arglist = rec->signal->arglist;
+    const char *name = SIGNAME(rec);
+    int i;
+
+    filter->server_arg = filter->target_arg = filter->nick_arg = -1;
+    filter->address_arg = filter->text_arg = -1;
+
+    for (i = 0; py_message_args[i].name; i++)
+    {
+        if (strcmp(py_message_args[i].name, name) == 0)
+        {
+            filter->text_arg = py_message_args[i].text;
+            filter->nick_arg = py_message_args[i].nick;
+            filter->address_arg = py_message_args[i].address;
+            filter->target_arg = py_message_args[i].target;
+            break;
+        }
+    }
+
+    if (rec->command && strcmp(rec->signal->name, "event ") == 0)
+    {
+        filter->nick_arg = 2;
+        filter->address_arg = 3;
+    }
+
+    for (i = 0; arglist[i]; i++)
+    {
+        switch (arglist[i])
+        {
+            case 'S':
+                if (filter->server_arg < 0)
+                    filter->server_arg = i;
+                break;
+            /* window items: channel, query and the generic one */
+            case 'C':
+            case 'q':
+            case 'W':
+                if (filter->server_arg < 0)
+                    filter->server_arg = i;
+                if (filter->target_arg < 0)
+                    filter->target_arg = i;
+                break;
+            case 'n':
+                if (filter->nick_arg < 0)
+                    filter->nick_arg = i;
+                break;
+        }
+    }
+
+    if (filter->tags && filter->server_arg < 0)
+        PyErr_Format(PyExc_ValueError, "signal '%s' has no server to filter on", name);
+    else if (filter->targets && filter->target_arg < 0)
+        PyErr_Format(PyExc_ValueError, "signal '%s' has no target to filter on", name);
+    else if (filter->nick && filter->nick_arg < 0)
+        PyErr_Format(PyExc_ValueError, "signal '%s' has no nick to filter on", name);
+    else if (filter->regex && filter->text_arg < 0)
+        PyErr_Format(PyExc_ValueError, "signal '%s' has no text to filter on", name);
+    else
+        return 1;
+
+    return 0;
+}
+
+static int py_strv_contains_icase(char **strv, const char *str)
+{
+    for (; *strv != NULL; strv++)
+    {
+        if (g_ascii_strcasecmp(*strv, str) == 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+/* check the raw Irssi arguments, before any Python object is built */
+static int py_filter_match(PY_SIGNAL_REC *rec, void **args)
+{
+    PY_SIGNAL_FILTER_REC *filter = rec->filter;
+    const char *arglist = rec->signal->arglist;
+    SERVER_REC *server = NULL;
+
+    if (filter->server_arg >= 0 && args[filter->server_arg])
+    {
+        if (arglist[filter->server_arg] == 'S')
+            server = args[filter->server_arg];
+        else
+            server = ((WI_ITEM_REC *)args[filter->server_arg])->server;
+    }
+
+    if (filter->tags)
+    {
+        if (!server || !py_strv_contains_icase(filter->tags, server->tag))
+            return 0;
+    }
+
+    if (filter->targets)
+    {
+        const char *target = args[filter->target_arg];
+
+        if (target && arglist[filter->target_arg] != 's')
+            target = ((WI_ITEM_REC *)args[filter->target_arg])->visible_name;
+
+        if (!target || !py_strv_contains_icase(filter->targets, target))
+            return 0;
+    }
+
+    if (filter->nick)
+    {
+        const char *nick = args[filter->nick_arg];
+        const char *address = NULL;
+
+        if (nick && arglist[filter->nick_arg] == 'n')
+        {
+            address = ((NICK_REC *)args[filter->nick_arg])->host;
+            nick = ((NICK_REC *)args[filter->nick_arg])->nick;
+        }
+        else if (filter->address_arg >= 0)
+            address = args[filter->address_arg];
+
+        if (!nick || !mask_match_address(server, filter->nick, nick, address))
+            return 0;
+    }
+
+    if (filter->regex)
+    {
+        const char *text = args[filter->text_arg];
+
+        if (!text || !g_regex_match(filter->regex, text, 0, NULL))
+            return 0;
+    }
+
+    return 1;
+}
+
+/* Signals whose second argument is an IRC line: "server incoming" has the
+ * whole line, "server event" the line without its prefix, and "event <cmd>"
+ * only the parameters. The source nick and address, where given, are the
+ * third and fourth arguments.
+ */
+static int py_message_check(PY_SIGNAL_REC *rec)
+{
+    const char *name = SIGNAME(rec);
+
+    if ((strcmp(name, "server incoming") == 0 || strcmp(name, "server event") == 0 ||
+            (rec->command && strcmp(rec->signal->name, "event ") == 0)) &&
+            strlen(rec->signal->arglist) >= 2 && rec->signal->arglist[1] == 's')
+        return 1;
+
+    PyErr_Format(PyExc_ValueError, "message can't be used with signal '%s', only with "
+            "\"server incoming\", \"server event\" and \"event <cmd>\"", name);
+    return 0;
+}
+
+/* new reference to the IrcMessage for the line argument of one emission;
+   nick and address come from args, pyargs may hold them as str or views */
+static PyObject *py_message_arg(PY_SIGNAL_REC *rec, int argmode, void **args, 
+        PyObject **pyargs, int nargs)
+{
+    PyObject *command = NULL, *nick = NULL, *address = NULL, *msg = NULL;
+
+    /* None stays None */
+    if (!PyBytes_Check(pyargs[1]))
+    {
+        Py_INCREF(pyargs[1]);
+        return pyargs[1];
+    }
+
+    if (strcmp(rec->signal->name, "server incoming") != 0 && nargs >= 4)
+    {
+        if (args[2] && !(nick = PyBytes_FromString(args[2])))
+            goto error;
+        if (args[3] && !(address = PyBytes_FromString(args[3])))
+            goto error;
+    }
+
+    if (rec->command && strcmp(rec->signal->name, "event ") == 0)
+    {
+        char *upper = g_ascii_strup(rec->command + strlen("event "), -1);
+
+        command = PyBytes_FromString(upper);
+        g_free(upper);
+        if (!command)
+            goto error;
+    }
+
+    msg = pyircmessage_new(pyargs[1], command, nick, address, 
+            (argmode & PY_ARGS_TEXT) != 0);
+
+error:
+    Py_XDECREF(command);
+    Py_XDECREF(nick);
+    Py_XDECREF(address);
+    return msg;
+}
+
+/* return NULL if signal is invalid. If batch_ms or filter can't be used with
+   the signal, a Python exception is set as well. Takes over filter. */
+PY_SIGNAL_REC *pysignals_signal_add(const char *signal, PyObject *func, 
+        int priority, int batch_ms, PY_SIGNAL_FILTER_REC *filter, int argmode)
 {
     PY_SIGNAL_REC *rec = py_signal_rec_new(signal, func, NULL);
 
     if (rec == NULL)
+    {
+        pysignals_filter_free(filter);
         return NULL;
+    }
+
+    if (filter)
+    {
+        rec->filter = filter;
+        if (!py_filter_resolve(filter, rec))
+        {
+            py_signal_rec_destroy(rec);
+            return NULL;
+        }
+    }
+
+    if (batch_ms > 0)
+    {
+        /* queued arguments must outlive the emission */
+        if (rec->signal->has_inout || rec->signal->has_borrowed || 
+                (argmode & PY_ARGS_VIEWS))
+        {
+            PyErr_Format(PyExc_ValueError, 
+                    "batch_ms can't be used with signal '%s', its arguments are only "
+                    "valid during the emission", signal);
+            py_signal_rec_destroy(rec);
+            return NULL;
+        }
+
+        rec->batch_ms = batch_ms;
+    }
+
+    if ((argmode & PY_ARGS_MESSAGE) && !py_message_check(rec))
+    {
+        py_signal_rec_destroy(rec);
+        return NULL;
+    }
+
+    rec->argmode = argmode;
    
-    signal_add_full(MODULE_NAME, priority, SIGNAME(rec), 
-            (SIGNAL_FUNC)py_sig_proxy, rec); 
+    py_group_add(rec, priority);
 
     return rec;
 }
 
-int pysignals_signal_add_list(GSList **list, const char *signal, 
-        PyObject *func, int priority)
+int pysignals_signal_add_list(GSList **list, PyObject *script, 
+        const char *signal, PyObject *func, int priority, int batch_ms, 
+        PY_SIGNAL_FILTER_REC *filter, int argmode)
 {
-    PY_SIGNAL_REC *rec = pysignals_signal_add(signal, func, priority);
+    PY_SIGNAL_REC *rec = pysignals_signal_add(signal, func, priority, batch_ms, 
+            filter, argmode);
     if (!rec)
         return 0;
 
+    rec->script = script;
+
     *list = g_slist_append(*list, rec);
     return 1;
 }
 
+static void py_hook_capsule_destroy(PyObject *capsule)
+{
+    void (*destroy)(void *) = PyCapsule_GetContext(capsule);
+
+    if (destroy)
+        destroy(PyCapsule_GetPointer(capsule, "irssi.hook"));
+}
+
+/* Native handler, fanned out with the Python handlers of the same signal.
+   Returns NULL with an exception set on failure; destroy is not called 
+   then. */
+PY_SIGNAL_REC *pysignals_hook_add_list(GSList **list, PyObject *script, 
+        const char *signal, int priority, PY_SIGNAL_HOOK hook, void *data, 
+        void (*destroy)(void *))
+{
+    PY_SIGNAL_REC *rec;
+    PyObject *capsule;
+
+    g_return_val_if_fail(hook != NULL, NULL);
+
+    /* a capsule can't hold NULL */
+    capsule = PyCapsule_New(data? data : (void *)hook, "irssi.hook", NULL);
+    if (!capsule)
+        return NULL;
+
+    rec = py_signal_rec_new(signal, capsule, NULL);
+    Py_DECREF(capsule);
+    if (!rec)
+    {
+        if (!PyErr_Occurred())
+            PyErr_Format(PyExc_KeyError, "unknown signal '%s'", signal);
+        return NULL;
+    }
+
+    /* from here on the rec owns data */
+    PyCapsule_SetContext(capsule, data? destroy : NULL);
+    PyCapsule_SetDestructor(capsule, py_hook_capsule_destroy);
+    rec->hook = hook;
+    rec->hook_data = data;
+    rec->script = script;
+
+    py_group_add(rec, priority);
+    *list = g_slist_append(*list, rec);
+
+    return rec;
+}
+
 void pysignals_command_unbind(PY_SIGNAL_REC *rec)
 {
     g_return_if_fail(rec->is_signal == FALSE);
@@ -175,7 +605,7 @@ void pysignals_signal_remove(PY_SIGNAL_REC *rec)
 {
     g_return_if_fail(rec->is_signal == TRUE);
 
-    signal_remove_full(SIGNAME(rec), (SIGNAL_FUNC)py_sig_proxy, rec);
+    py_group_remove(rec);
     py_signal_rec_destroy(rec);
 }
 
@@ -223,6 +653,19 @@ void pysignals_remove_list(GSList *siglist)
         pysignals_remove_generic(node->data);
 }
 
+void pysignals_stats_foreach(GSList *siglist, PY_STATS_FUNC func, void *data)
+{
+    GSList *node;
+
+    for (node = siglist; node != NULL; node = node->next)
+    {
+        PY_SIGNAL_REC *rec = node->data;
+
+        func(rec->is_signal? "signal" : "command", SIGNAME(rec), 
+                rec->handler, rec->stats, data);
+    }
+}
+
 static PyObject *py_mkstrlist(void *iobj)
 {
     PyObject *list;
@@ -257,30 +700,112 @@ static PyObject *py_mkstrlist(void *iobj)
     return list;
 }
 
-/* irssi obj -> PyObject */
-static PyObject *py_i2py(char code, void *iobj)
+/* irssi obj -> PyObject converters. These are only called with a non-NULL
+   iobj; a NULL argument is always passed to Python as None. */
+static PyObject *py_i2py_none(void *iobj)
+{
+    Py_RETURN_NONE;
+}
+
+static PyObject *py_i2py_str(void *iobj)
+{
+    return PyBytes_FromString((char *)iobj);
+}
+
+static PyObject *py_i2py_ulongp(void *iobj)
 {
-    if (iobj == NULL)
+    return PyLong_FromUnsignedLong(*(unsigned long*)iobj);
+}
+
+static PyObject *py_i2py_intp(void *iobj)
+{
+    return PyLong_FromLong(*(int *)iobj);
+}
+
+static PyObject *py_i2py_int(void *iobj)
+{
+    return PyLong_FromLong(GPOINTER_TO_INT(iobj));
+}
+
+/* the list is only borrowed for the emission; py_run_handler invalidates
+   the sequence when the handler returns */
+static PyObject *py_i2py_nicklist(void *iobj)
+{
+    return pychatlist_new((GSList *)iobj);
+}
+
+static PyObject *py_i2py_strlist(void *iobj)
+{
+    return pystrlist_new((GList **)iobj);
+}
+
+static PyObject *py_i2py_chat(void *iobj)
+{
+    return py_irssi_chat_new(iobj, 1);
+}
+
+static PyObject *py_i2py_irssi(void *iobj)
+{
+    return py_irssi_new(iobj, 1);
+}
+
+/* codes that aren't a single Irssi record */
+#define PY_CODE_NOT_RECORD(code) (strchr("suIiGLF?", (code)) != NULL)
+
+/* New reference to the wrapper for record, by sig2code.txt type code */
+PyObject *pysignals_wrap(char code, void *record)
+{
+    PY_I2PY_FUNC func = code? py_i2py_func(code) : NULL;
+
+    if (!func || PY_CODE_NOT_RECORD(code))
+        return PyErr_Format(PyExc_ValueError, "can't wrap type code '%c'", code);
+
+    if (!record)
         Py_RETURN_NONE;
 
+    return func(record);
+}
+
+/* The record of wrapper obj of type code; NULL for None, or with an 
+   exception set */
+void *pysignals_unwrap(char code, PyObject *obj)
+{
+    void *record;
+
+    if (code == '\0' || PY_CODE_NOT_RECORD(code))
+    {
+        PyErr_Format(PyExc_ValueError, "can't unwrap type code '%c'", code);
+        return NULL;
+    }
+
+    record = py_py2i(code, obj, 0, "C API", NULL);
+    if (!record && obj != Py_None && !PyErr_Occurred())
+        PyErr_Format(PyExc_RuntimeError, "wrapped object is invalid");
+
+    return record;
+}
+
+/* map a signal code to its converter, NULL if the code is unknown */
+static PY_I2PY_FUNC py_i2py_func(char code)
+{
     switch (code)
     {
         case '?':
-            Py_RETURN_NONE;
+            return py_i2py_none;
 
         case 's':
-            return PyBytes_FromString((char *)iobj);
+            return py_i2py_str;
         case 'u':
-            return PyLong_FromUnsignedLong(*(unsigned long*)iobj);
+            return py_i2py_ulongp;
         case 'I':
-            return PyLong_FromLong(*(int *)iobj);
+            return py_i2py_intp;
         case 'i':
-            return PyLong_FromLong(GPOINTER_TO_INT(iobj));
+            return py_i2py_int;
 
         case 'G':
-            return py_mkstrlist(iobj);
+            return py_i2py_strlist;
         case 'L': /* list of nicks */
-            return py_irssi_chatlist_new((GSList *)iobj, 1);
+            return py_i2py_nicklist;
 
         case 'c':
         case 'S':
@@ -288,42 +813,211 @@ static PyObject *py_i2py(char code, void *iobj)
         case 'q':
         case 'n':
         case 'W':
-            return py_irssi_chat_new(iobj, 1);
+            return py_i2py_chat;
 
         case 'd':
-            return py_irssi_new(iobj, 1);
+            return py_i2py_irssi;
 
         case 'r':
-            return pyreconnect_new(iobj);
+            return pyreconnect_new;
         case 'o':
-            return pycommand_new(iobj);
+            return pycommand_new;
         case 'l':
-            return pylog_new(iobj);
+            return pylog_new;
         case 'a':
-            return pyrawlog_new(iobj);
+            return pyrawlog_new;
         case 'g':
-            return pyignore_new(iobj);
+            return pyignore_new;
         case 'b':
-            return pyban_new(iobj);
+            return pyban_new;
         case 'N':
-            return pynetsplit_new(iobj);
+            return pynetsplit_new;
         case 'e':
-            return pynetsplit_server_new(iobj);
+            return pynetsplit_server_new;
         case 'O':
-            return pynotifylist_new(iobj);
+            return pynotifylist_new;
         case 'p':
-            return pyprocess_new(iobj);
+            return pyprocess_new;
         case 't':
-            return pytextdest_new(iobj);
+            return pytextdest_new;
         case 'w':
-            return pywindow_new(iobj);
+            return pywindow_new;
+    }
+
+    return NULL;
+}
+
+/* Resolve the argument converters of a signal once, so handlers don't have
+ * to decode the arglist on every emission. Unknown codes are left NULL and
+ * raise TypeError when the signal is actually delivered.
+ */
+static int py_signal_compile(PY_SIGNAL_SPEC_REC *spec)
+{
+    int i;
+
+    spec->arglen = strlen(spec->arglist);
+    g_return_val_if_fail(spec->arglen <= SIGNAL_MAX_ARGUMENTS, 0);
+
+    spec->has_inout = 0;
+    spec->has_borrowed = 0;
+    for (i = 0; i < spec->arglen; i++)
+    {
+        char code = spec->arglist[i];
+
+        spec->plan[i] = py_i2py_func(code);
+        if (code == 'G' || code == 'I')
+            spec->has_inout = 1;
+        if (code == 'G' || code == 'L')
+            spec->has_borrowed = 1;
+    }
+
+    return 1;
+}
+
+static void py_arena_init(PY_ARENA_REC *arena)
+{
+    arena->pos = arena->buf;
+    arena->end = arena->buf + sizeof arena->buf;
+    arena->blocks = NULL;
+    arena->strlists = NULL;
+}
+
+static void *py_arena_alloc(PY_ARENA_REC *arena, gsize size)
+{
+    void *ret;
+
+    size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    if (size > (gsize)(arena->end - arena->pos))
+    {
+        gsize len = MAX(size, PY_ARENA_BLOCK);
+        void **block = g_malloc(sizeof(void *) + len);
+
+        *block = arena->blocks;
+        arena->blocks = block;
+        arena->pos = (char *)(block + 1);
+        arena->end = arena->pos + len;
+    }
+
+    ret = arena->pos;
+    arena->pos += size;
+    return ret;
+}
+
+static char *py_arena_strdup(PY_ARENA_REC *arena, const char *str, gsize len)
+{
+    char *ret = py_arena_alloc(arena, len + 1);
+
+    memcpy(ret, str, len);
+    ret[len] = '\0';
+    return ret;
+}
+
+/* Free everything allocated for the emission. With writeback set, string 
+   lists are first copied back to their Python lists; returns 0 with an
+   exception set if that fails. */
+static int py_arena_release(PY_ARENA_REC *arena, int writeback)
+{
+    PY_ARENA_STRLIST *sl;
+    int ret = 1;
+
+    for (sl = arena->strlists; sl != NULL; sl = sl->next)
+    {
+        if (writeback && ret)
+        {
+            PyObject *items = py_mkstrlist(&sl->list);
+
+            if (!items || PyList_SetSlice(sl->pylist, 0, PY_SSIZE_T_MAX, items) != 0)
+                ret = 0;
+            Py_XDECREF(items);
+        }
+
+        g_list_free_full(sl->list, g_free);
+        Py_DECREF(sl->pylist);
+    }
+
+    while (arena->blocks)
+    {
+        void **block = arena->blocks;
+
+        arena->blocks = *block;
+        g_free(block);
     }
 
-    return PyErr_Format(PyExc_TypeError, "unknown code %c", code);
+    py_arena_init(arena);
+    return ret;
+}
+
+/* sequence of Nick objects -> GSList of NICK_REC */
+static GSList *py_py2i_nicklist(PyObject *pobj, int arg, const char *signal, 
+        PY_ARENA_REC *arena)
+{
+    PyObject *seq;
+    GSList *list = NULL;
+    Py_ssize_t i;
+
+    seq = PySequence_Fast(pobj, "expected a sequence of Nick objects");
+    if (!seq)
+        return NULL;
+
+    /* built from the back so nodes can simply be prepended */
+    for (i = PySequence_Fast_GET_SIZE(seq) - 1; i >= 0; i--)
+    {
+        PyObject *item = PySequence_Fast_GET_ITEM(seq, i);
+        GSList *node;
+
+        if (!pynick_check(item) || !DATA(item))
+        {
+            PyErr_Format(PyExc_TypeError, "signal `%s': arg %d must contain Nick objects", 
+                    signal, arg);
+            Py_DECREF(seq);
+            return NULL;
+        }
+
+        node = py_arena_alloc(arena, sizeof(GSList));
+        node->data = DATA(item);
+        node->next = list;
+        list = node;
+    }
+
+    Py_DECREF(seq);
+    return list;
+}
+
+/* list of bytes -> GList ** of g_strdup'd strings */
+static GList **py_py2i_strlist(PyObject *pobj, int arg, const char *signal, 
+        PY_ARENA_REC *arena)
+{
+    PY_ARENA_STRLIST *sl;
+    Py_ssize_t i;
+
+    sl = py_arena_alloc(arena, sizeof(PY_ARENA_STRLIST));
+    sl->list = NULL;
+    sl->pylist = pobj;
+    Py_INCREF(pobj);
+    sl->next = arena->strlists;
+    arena->strlists = sl;
+
+    for (i = PyList_GET_SIZE(pobj) - 1; i >= 0; i--)
+    {
+        PyObject *str = PyList_GET_ITEM(pobj, i);
+        const char *value;
+
+        if (!py_str_conv(str, &value))
+        {
+            PyErr_Format(PyExc_TypeError, "signal `%s': arg %d must contain only bytes or str", 
+                    signal, arg);
+            return NULL;
+        }
+
+        sl->list = g_list_prepend(sl->list, g_strdup(value));
+    }
+
+    return &sl->list;
 }
 
 /* PyObject -> irssi obj*/
-static void *py_py2i(char code, PyObject *pobj, int arg, const char *signal)
+static void *py_py2i(char code, PyObject *pobj, int arg, const char *signal, 
+        PY_ARENA_REC *arena)
 {
     char *type;
 
@@ -332,11 +1026,19 @@ static void *py_py2i(char code, PyObject *pobj, int arg, const char *signal)
 
     switch (code)
     {
-        /* XXX: string doesn't persist */
         case 's':
             type = "str";
             if (PyBytes_Check(pobj))
-                return PyBytes_AsString(pobj);
+                return py_arena_strdup(arena, PyBytes_AS_STRING(pobj), 
+                        PyBytes_GET_SIZE(pobj));
+            /* from scripts with text_mode 'str' */
+            if (PyUnicode_Check(pobj))
+            {
+                Py_ssize_t len;
+                const char *str = PyUnicode_AsUTF8AndSize(pobj, &len);
+
+                return str? py_arena_strdup(arena, str, len) : NULL;
+            }
             break;
         case 'i':
             type = "int";
@@ -345,8 +1047,18 @@ static void *py_py2i(char code, PyObject *pobj, int arg, const char *signal)
             break;
 
         case 'L': /* list of nicks */
-            /*FIXME*/
-            return NULL;
+            type = "list of Nick";
+            if (PySequence_Check(pobj) && !PyBytes_Check(pobj))
+                return py_py2i_nicklist(pobj, arg, signal, arena);
+            break;
+        case 'G': /* list of strings, handlers may change it */
+            type = "list";
+            if (PyList_Check(pobj))
+                return py_py2i_strlist(pobj, arg, signal, arena);
+            /* passed on by a handler, eg. to signal_continue() */
+            if (pystrlist_check(pobj) && ((PyStrList *)pobj)->valid)
+                return pystrlist_lend(pobj);
+            break;
 
         case 'c':
             type = "Chatnet";
@@ -436,71 +1148,145 @@ static void *py_py2i(char code, PyObject *pobj, int arg, const char *signal)
     return NULL;
 }
 
-static void py_getstrlist(GList **list, PyObject *pylist)
+/* argmode of rec for this call; text_mode can change at any time */
+static int py_argmode(PY_SIGNAL_REC *rec)
 {
-    GList *out = NULL;
-    int i;
-    PyObject *str;
-    char *cstr;
+    if (rec->script && ((PyScript *)rec->script)->text_str)
+        return rec->argmode | PY_ARGS_TEXT;
+
+    return rec->argmode;
+}
 
-    for (i = 0; i < PyList_Size(pylist); i++)
+/* build the Python arguments for one call of rec, in argmode; returns their
+   count or -1 */
+static int py_build_args(PY_SIGNAL_REC *rec, int argmode, void **args, PyObject **pyargs)
+{
+    PY_SIGNAL_SPEC_REC *spec = rec->signal;
+    int nargs;
+
+    /* arguments are built on the stack and passed with vectorcall, so no
+       tuple is allocated per handler call */
+    for (nargs = 0; nargs < spec->arglen; nargs++)
     {
-        str = PyList_GET_ITEM(pylist, i);
-        if (!PyBytes_Check(str))
+        PyObject *arg;
+
+        if (args[nargs] == NULL)
         {
-            PyErr_SetString(PyExc_TypeError, "string list contains invalid elements");
-            PyErr_Print();
-            return;
+            arg = Py_None;
+            Py_INCREF(arg);
         }
+        /* the line an IrcMessage is made of stays bytes */
+        else if ((argmode & (PY_ARGS_VIEWS | PY_ARGS_TEXT)) && spec->arglist[nargs] == 's' &&
+                !((argmode & PY_ARGS_MESSAGE) && nargs == 1))
+            arg = (argmode & PY_ARGS_VIEWS)? pystrview_new(args[nargs]) : 
+                py_text_decode(args[nargs], strlen(args[nargs]));
+        else if (spec->plan[nargs] != NULL)
+            arg = spec->plan[nargs](args[nargs]);
+        else
+            arg = PyErr_Format(PyExc_TypeError, "unknown code %c", spec->arglist[nargs]);
+
+        if (!arg)
+            goto error;
+
+        pyargs[nargs] = arg;
+    }
+
+    if (argmode & PY_ARGS_MESSAGE)
+    {
+        PyObject *message = py_message_arg(rec, argmode, args, pyargs, nargs);
+
+        if (!message)
+            goto error;
+
+        Py_DECREF(pyargs[1]);
+        pyargs[1] = message;
+    }
+
+    return nargs;
+
+error:
+    while (--nargs >= 0)
+        Py_DECREF(pyargs[nargs]);
+    return -1;
+}
+
+static void py_free_args(PY_SIGNAL_SPEC_REC *spec, int argmode, PyObject **pyargs, 
+        int nargs)
+{
+    int i;
+
+    for (i = 0; i < nargs; i++)
+    {
+        if (!pyargs[i])
+            continue;
+
+        /* handlers may keep a reference, but not to the emitter's list */
+        if (spec->has_borrowed && pychatlist_check(pyargs[i]))
+            pychatlist_invalidate(pyargs[i]);
+        else if (spec->has_borrowed && pystrlist_check(pyargs[i]))
+            pystrlist_invalidate(pyargs[i]);
+        else if ((argmode & PY_ARGS_VIEWS) && pystrview_check(pyargs[i]))
+            pystrview_invalidate(pyargs[i]);
+
+        Py_DECREF(pyargs[i]);
+    }
+}
+
+/* views are only valid during one handler call; the next handler sharing
+   the arguments gets new ones. Returns 0 with an exception if that fails */
+static int py_renew_views(void **args, PyObject **pyargs, int nargs)
+{
+    int i;
+
+    for (i = 0; i < nargs; i++)
+    {
+        PyObject *view;
+
+        if (!pystrview_check(pyargs[i]))
+            continue;
+
+        pystrview_invalidate(pyargs[i]);
+        Py_CLEAR(pyargs[i]);
+
+        /* py_free_args() skips the NULL left on failure */
+        view = pystrview_new(args[i]);
+        if (!view)
+            return 0;
 
-        cstr = g_strdup(PyBytes_AS_STRING(str));
-        out = g_list_append(out, cstr);
+        pyargs[i] = view;
     }
 
-    g_list_foreach(*list, (GFunc)g_free, NULL);
-    g_list_free(*list);
-    *list = out;
+    return 1;
 }
 
-static void py_run_handler(PY_SIGNAL_REC *rec, void **args)
+static void py_call_handler(PY_SIGNAL_REC *rec, void **args, PyObject **pyargs, int nargs)
 {
-    PyObject *argtup, *ret;
-    char *arglist = rec->signal->arglist;
-    int arglen, i, j;
-
-    arglen = strlen(arglist);
-    g_return_if_fail(arglen <= SIGNAL_MAX_ARGUMENTS);
-    
-    argtup = PyTuple_New(arglen);
-    if (!argtup)
-        goto error;
-
-    for (i = 0; i < arglen; i++)
-    {
-        PyObject *arg = py_i2py(arglist[i], args[i]);
-        if (!arg)
-            goto error;
-
-        PyTuple_SET_ITEM(argtup, i, arg);
-    }
-    
-    ret = PyObject_CallObject(rec->handler, argtup);
+    PyObject *ret, *prev;
+    PY_SIGNAL_SPEC_REC *spec = rec->signal;
+    gint64 start;
+    int i, j;
+
+    if (PY_STATS_SUSPENDED(rec->stats))
+        return;
+
+    rec->busy++;
+    start = PY_STATS_START();
+    prev = pyloader_script_enter(rec->script);
+    ret = PyObject_Vectorcall(rec->handler, pyargs, nargs, NULL);
+    /* async def handlers: the part up to the first await runs now */
+    if (ret && PyCoro_CheckExact(ret))
+        ret = pyasync_run_handler(rec->script, ret);
+    pyloader_script_leave(prev);
+    if (PY_STATS_STOP(&rec->stats, start))
+        pystats_suspend_notice(rec->script, rec->is_signal? "signal" : "command", SIGNAME(rec));
     if (!ret)
         goto error;
   
-    /*XXX: IN/OUT arg handling not well tested */
-    for (i = 0, j = 0; i < arglen; i++)
+    /* 'G' string lists are StrList objects, already changed in place */
+    for (i = 0, j = 0; spec->has_inout && i < nargs; i++)
     {
-        GList **list;
-        PyObject *pyarg = PyTuple_GET_ITEM(argtup, i);
-        
-        switch (arglist[i])
+        switch (spec->arglist[i])
         {
-            case 'G':
-                list = args[i];
-                py_getstrlist(list, pyarg);
-                break;
-
             case 'I':
                 if (ret != Py_None)
                 {
@@ -527,73 +1313,464 @@ static void py_run_handler(PY_SIGNAL_REC *rec, void **args)
     Py_XDECREF(ret);
 
 error:
-    Py_XDECREF(argtup);
     if (PyErr_Occurred())
         PyErr_Print();
+
+    if (--rec->busy == 0 && rec->dead)
+        py_signal_rec_destroy(rec);
+}
+
+static void py_call_hook(PY_SIGNAL_REC *rec, void **args)
+{
+    PyObject *prev;
+    gint64 start;
+    int stop;
+
+    if (PY_STATS_SUSPENDED(rec->stats))
+        return;
+
+    rec->busy++;
+    start = PY_STATS_START();
+    prev = pyloader_script_enter(rec->script);
+    stop = rec->hook(rec->hook_data, args);
+    pyloader_script_leave(prev);
+    if (PY_STATS_STOP(&rec->stats, start))
+        pystats_suspend_notice(rec->script, "signal", SIGNAME(rec));
+
+    if (PyErr_Occurred())
+        PyErr_Print();
+    if (stop)
+        pysignals_stop();
+
+    if (--rec->busy == 0 && rec->dead)
+        py_signal_rec_destroy(rec);
+}
+
+static void py_run_handler(PY_SIGNAL_REC *rec, void **args)
+{
+    PyObject *pyargs[SIGNAL_MAX_ARGUMENTS];
+    PY_SIGNAL_SPEC_REC *spec = rec->signal; /* rec may be gone after the call */
+    int argmode = py_argmode(rec);
+    int nargs;
+
+    nargs = py_build_args(rec, argmode, args, pyargs);
+    if (nargs < 0)
+    {
+        PyErr_Print();
+        return;
+    }
+
+    /* the handler may unregister a dynamic signal along with itself */
+    py_signal_ref(spec);
+    py_call_handler(rec, args, pyargs, nargs);
+    py_free_args(spec, argmode, pyargs, nargs);
+    py_signal_unref(spec);
 }
 
+/* command handlers are still bound one by one */
 static void py_sig_proxy(void *p1, void *p2, void *p3, void *p4, void *p5, void *p6)
 {
     PY_SIGNAL_REC *rec = signal_get_user_data();
+    PY_DISPATCH_REC frame;
     void *args[6];
 
     args[0] = p1; args[1] = p2; args[2] = p3;
     args[3] = p4; args[4] = p5; args[5] = p6;
+
+    memset(&frame, 0, sizeof frame);
+    frame.prev = py_dispatch;
+    py_dispatch = &frame;
+
     py_run_handler(rec, args);
+
+    py_dispatch = frame.prev;
 }
 
-static int py_convert_args(void **args, PyObject *argtup, const char *signal)
+static gboolean py_batch_flush(PY_SIGNAL_REC *rec)
 {
-    char *arglist;
-    PY_SIGNAL_SPEC_REC *spec;
+    PyObject *batch = rec->batch;
+    PyObject *ret, *prev;
+    gint64 start;
+
+    rec->batch = NULL;
+    rec->batch_tag = 0;
+
+    if (!batch || PY_STATS_SUSPENDED(rec->stats))
+    {
+        Py_XDECREF(batch);
+        return FALSE;
+    }
+
+    rec->busy++;
+    start = PY_STATS_START();
+    prev = pyloader_script_enter(rec->script);
+    ret = PyObject_CallFunctionObjArgs(rec->handler, batch, NULL);
+    if (ret && PyCoro_CheckExact(ret))
+        ret = pyasync_run_handler(rec->script, ret);
+    pyloader_script_leave(prev);
+    if (PY_STATS_STOP(&rec->stats, start))
+        pystats_suspend_notice(rec->script, "signal", SIGNAME(rec));
+
+    Py_DECREF(batch);
+    if (!ret)
+        PyErr_Print();
+    Py_XDECREF(ret);
+
+    if (--rec->busy == 0 && rec->dead)
+        py_signal_rec_destroy(rec);
+
+    return FALSE;
+}
+
+/* queue one emission for a batched handler; the first one starts the timer */
+static void py_batch_add(PY_SIGNAL_REC *rec, PyObject **pyargs, int nargs)
+{
+    PyObject *item;
     int i;
-    int maxargs;
 
-    spec = py_signal_lookup(signal);
-    if (!spec)
+    if (PY_STATS_SUSPENDED(rec->stats))
+        return;
+
+    if (!rec->batch)
     {
-        PyErr_Format(PyExc_KeyError, "signal not found");
-        return 0;
+        rec->batch = PyList_New(0);
+        if (!rec->batch)
+            goto error;
+    }
+
+    item = PyTuple_New(nargs);
+    if (!item)
+        goto error;
+
+    for (i = 0; i < nargs; i++)
+    {
+        Py_INCREF(pyargs[i]);
+        PyTuple_SET_ITEM(item, i, pyargs[i]);
+    }
+
+    i = PyList_Append(rec->batch, item);
+    Py_DECREF(item);
+    if (i != 0)
+        goto error;
+
+    if (!rec->batch_tag)
+        rec->batch_tag = g_timeout_add(rec->batch_ms, (GSourceFunc)py_batch_flush, rec);
+
+    return;
+
+error:
+    PyErr_Print();
+}
+
+static void py_group_destroy(PY_SIGNAL_GROUP_REC *group)
+{
+    signal_remove_full(group->name, (SIGNAL_FUNC)py_group_proxy, group);
+    g_hash_table_remove(py_siggroups, group->key);
+
+    g_ptr_array_free(group->handlers, TRUE);
+    g_free(group->key);
+    g_free(group);
+}
+
+/* drop entries removed during emission, free the group once it is empty */
+static void py_group_compact(PY_SIGNAL_GROUP_REC *group)
+{
+    g_return_if_fail(group->emitting == 0);
+
+    if (group->live == 0)
+    {
+        py_group_destroy(group);
+        return;
+    }
+
+    while (g_ptr_array_remove(group->handlers, NULL))
+        ;
+}
+
+static void py_group_add(PY_SIGNAL_REC *rec, int priority)
+{
+    PY_SIGNAL_GROUP_REC *group;
+    char *key;
+
+    key = g_strdup_printf("%d %s", priority, SIGNAME(rec));
+    group = g_hash_table_lookup(py_siggroups, key);
+    if (!group)
+    {
+        group = g_new0(PY_SIGNAL_GROUP_REC, 1);
+        group->key = key;
+        group->name = strchr(key, ' ') + 1;
+        group->priority = priority;
+        group->handlers = g_ptr_array_new();
+
+        g_hash_table_insert(py_siggroups, group->key, group);
+        signal_add_full(MODULE_NAME, priority, group->name, 
+                (SIGNAL_FUNC)py_group_proxy, group); 
+    }
+    else
+        g_free(key);
+
+    /* handlers added during an emission only see the next one */
+    g_ptr_array_add(group->handlers, rec);
+    group->live++;
+    rec->group = group;
+}
+
+static void py_group_remove(PY_SIGNAL_REC *rec)
+{
+    PY_SIGNAL_GROUP_REC *group = rec->group;
+    guint i;
+
+    g_return_if_fail(group != NULL);
+
+    for (i = 0; i < group->handlers->len; i++)
+    {
+        if (g_ptr_array_index(group->handlers, i) == rec)
+            break;
+    }
+
+    g_return_if_fail(i < group->handlers->len);
+
+    group->handlers->pdata[i] = NULL;
+    group->live--;
+    rec->group = NULL;
+
+    if (group->emitting == 0)
+        py_group_compact(group);
+}
+
+/* Call the handlers of group from index start on. Returns 0 if a handler
+   stopped the emission. */
+static int py_group_dispatch(PY_SIGNAL_GROUP_REC *group, void **args, guint start)
+{
+    /* built once per emission for each argmode the handlers use */
+    PyObject *pyargs[PY_ARGS_MODES][SIGNAL_MAX_ARGUMENTS];
+    int nargs[PY_ARGS_MODES]; /* -1 not built yet, -2 failed */
+    PY_SIGNAL_SPEC_REC *spec = NULL;
+    PY_DISPATCH_REC frame;
+    guint len;
+    int mode;
+
+    for (mode = 0; mode < PY_ARGS_MODES; mode++)
+        nargs[mode] = -1;
+
+    frame.group = group;
+    frame.stopped = 0;
+    frame.prev = py_dispatch;
+    py_dispatch = &frame;
+    group->emitting++;
+
+    /* handlers added from inside the emission are not called */
+    len = group->handlers->len;
+    for (frame.pos = start; frame.pos < len && !frame.stopped; frame.pos++)
+    {
+        PY_SIGNAL_REC *rec = g_ptr_array_index(group->handlers, frame.pos);
+
+        if (!rec || (rec->filter && !py_filter_match(rec, args)))
+            continue;
+
+        if (rec->hook)
+        {
+            py_call_hook(rec, args);
+            continue;
+        }
+
+        /* batched handlers never see IN/OUT signals */
+        if (rec->signal->has_inout)
+        {
+            py_run_handler(rec, args);
+            continue;
+        }
+
+        /* same signal name means same spec for the whole group */
+        mode = py_argmode(rec);
+        if (nargs[mode] == -2)
+            continue;
+        if (nargs[mode] < 0)
+        {
+            /* kept until the arguments are freed, see py_run_handler() */
+            if (!spec)
+            {
+                spec = rec->signal;
+                py_signal_ref(spec);
+            }
+            nargs[mode] = py_build_args(rec, mode, args, pyargs[mode]);
+            if (nargs[mode] < 0)
+            {
+                /* only the handlers wanting this mode miss the emission */
+                PyErr_Print();
+                nargs[mode] = -2;
+                continue;
+            }
+        }
+
+        if (rec->batch_ms)
+            py_batch_add(rec, pyargs[mode], nargs[mode]);
+        else
+            py_call_handler(rec, args, pyargs[mode], nargs[mode]);
+
+        if ((mode & PY_ARGS_VIEWS) && !py_renew_views(args, pyargs[mode], nargs[mode]))
+        {
+            PyErr_Print();
+            py_free_args(spec, mode, pyargs[mode], nargs[mode]);
+            nargs[mode] = -2;
+        }
     }
 
+    for (mode = 0; mode < PY_ARGS_MODES; mode++)
+    {
+        if (nargs[mode] >= 0)
+            py_free_args(spec, mode, pyargs[mode], nargs[mode]);
+    }
+    if (spec)
+        py_signal_unref(spec);
+
+    py_dispatch = frame.prev;
+    group->emitting--;
+
+    if (group->emitting == 0 && group->live != (int)group->handlers->len)
+        py_group_compact(group);
+
+    return !frame.stopped;
+}
+
+static void py_group_proxy(void *p1, void *p2, void *p3, void *p4, void *p5, void *p6)
+{
+    PY_SIGNAL_GROUP_REC *group = signal_get_user_data();
+    void *args[6];
+
+    args[0] = p1; args[1] = p2; args[2] = p3;
+    args[3] = p4; args[4] = p5; args[5] = p6;
+    py_group_dispatch(group, args, 0);
+}
+
+static int py_convert_argv(void **args, PY_SIGNAL_SPEC_REC *spec, 
+        PyObject *const *argv, Py_ssize_t argc, const char *signal, 
+        PY_ARENA_REC *arena)
+{
+    char *arglist;
+    int i;
+    int maxargs;
+
     /*XXX: specifying fewer signal args than in the format implicitly 
       sets overlooked args to NULL or 0 */
 
     arglist = spec->arglist;
-    maxargs = strlen(arglist);
-    for (i = 0; i < maxargs && i < PyTuple_Size(argtup); i++)
+    maxargs = spec->arglen;
+    for (i = 0; i < maxargs && i < argc; i++)
     {
-        args[i] = py_py2i(arglist[i], 
-                PyTuple_GET_ITEM(argtup, i), 
-                i+1, signal);
+        args[i] = py_py2i(arglist[i], argv[i], i+1, signal, arena);
 
-        if (PyErr_Occurred()) /* XXX: any cleanup needed? */
+        /* whatever was converted is freed with the arena */
+        if (PyErr_Occurred())
             return -1;
     }
 
     return maxargs;
 }
 
-int pysignals_emit(const char *signal, PyObject *argtup)
+static int py_convert_args(void **args, PyObject *argtup, const char *signal, 
+        PY_ARENA_REC *arena)
+{
+    PY_SIGNAL_SPEC_REC *spec;
+
+    spec = py_signal_lookup(signal);
+    if (!spec)
+    {
+        PyErr_Format(PyExc_KeyError, "signal not found");
+        return -1;
+    }
+
+    return py_convert_argv(args, spec, 
+            &PyTuple_GET_ITEM(argtup, 0), PyTuple_GET_SIZE(argtup), signal, arena);
+}
+
+int pysignals_emit(const char *signal, PyObject *const *argv, Py_ssize_t argc)
 {
+    PY_SIGNAL_SPEC_REC *spec;
+    PY_ARENA_REC arena;
     int arglen;
     void *args[6];
 
     memset(args, 0, sizeof args);
 
-    arglen = py_convert_args(args, argtup, signal);
+    spec = py_signal_lookup(signal);
+    if (!spec)
+    {
+        PyErr_Format(PyExc_KeyError, "signal not found");
+        return 0;
+    }
+
+    py_arena_init(&arena);
+    arglen = py_convert_argv(args, spec, argv, argc, signal, &arena);
     if (arglen < 0)
+    {
+        py_arena_release(&arena, 0);
         return 0;
+    }
 
     signal_emit(signal, arglen,
             args[0], args[1], args[2],   
             args[3], args[4], args[5]);
 
-    return 1;
+    return py_arena_release(&arena, 1);
+}
+
+/* Emit through a spec pinned with pysignals_spec_get(). name is the full
+   signal name, signal_id its Irssi id. */
+int pysignals_emit_spec(struct _PY_SIGNAL_SPEC_REC *spec, int signal_id, 
+        const char *name, PyObject *const *argv, Py_ssize_t argc)
+{
+    PY_ARENA_REC arena;
+    int arglen;
+    void *args[6];
+
+    memset(args, 0, sizeof args);
+
+    py_arena_init(&arena);
+    arglen = py_convert_argv(args, spec, argv, argc, name, &arena);
+    if (arglen < 0)
+    {
+        py_arena_release(&arena, 0);
+        return 0;
+    }
+
+    signal_emit_id(signal_id, arglen,
+            args[0], args[1], args[2],   
+            args[3], args[4], args[5]);
+
+    return py_arena_release(&arena, 1);
+}
+
+/* Resolve name and keep its spec alive until pysignals_spec_put(). Sets
+   KeyError and returns NULL if the signal is unknown. */
+struct _PY_SIGNAL_SPEC_REC *pysignals_spec_get(const char *name)
+{
+    PY_SIGNAL_SPEC_REC *spec;
+
+    spec = py_signal_lookup(name);
+    if (!spec)
+    {
+        PyErr_Format(PyExc_KeyError, "signal not found");
+        return NULL;
+    }
+
+    py_signal_ref(spec);
+    return spec;
+}
+
+void pysignals_spec_put(struct _PY_SIGNAL_SPEC_REC *spec)
+{
+    /* specs are left alone once the tables are gone */
+    if (py_sighash == NULL)
+        return;
+
+    py_signal_unref(spec);
 }
 
 int pysignals_continue(PyObject *argtup)
 {
+    PY_DISPATCH_REC *frame;
+    PY_ARENA_REC arena;
     const char *signal;
     int arglen;
     void *args[6];
@@ -607,15 +1784,53 @@ int pysignals_continue(PyObject *argtup)
         return 0;
     }
    
-    arglen = py_convert_args(args, argtup, signal);
+    py_arena_init(&arena);
+    arglen = py_convert_args(args, argtup, signal, &arena);
     if (arglen < 0)
+    {
+        py_arena_release(&arena, 0);
         return 0;
+    }
+
+    /* Irssi would pass the new arguments to the handlers after the group
+       proxy, so the rest of the group is called from here first */
+    frame = py_dispatch;
+    if (frame && frame->group && !frame->stopped)
+    {
+        frame->stopped = 1;
+        if (!py_group_dispatch(frame->group, args, frame->pos + 1))
+            return py_arena_release(&arena, 1);
+    }
 
     signal_continue(arglen,
             args[0], args[1], args[2],   
             args[3], args[4], args[5]);
 
-    return 1;
+    return py_arena_release(&arena, 1);
+}
+
+void pysignals_stop(void)
+{
+    signal_stop();
+
+    if (py_dispatch)
+        py_dispatch->stopped = 1;
+}
+
+void pysignals_stop_by_name(const char *signal)
+{
+    PY_DISPATCH_REC *frame;
+
+    signal_stop_by_name(signal);
+
+    for (frame = py_dispatch; frame != NULL; frame = frame->prev)
+    {
+        if (frame->group && strcmp(frame->group->name, signal) == 0)
+        {
+            frame->stopped = 1;
+            break;
+        }
+    }
 }
 
 /* returns NULL if signal is invalid, incr reference to func */
@@ -657,8 +1872,21 @@ static PY_SIGNAL_REC *py_signal_rec_new(const char *signal, PyObject *func, cons
 
 static void py_signal_rec_destroy(PY_SIGNAL_REC *sig)
 {
+    if (sig->busy)
+    {
+        sig->dead = 1;
+        return;
+    }
+
+    /* pending batched emissions are dropped */
+    if (sig->batch_tag)
+        g_source_remove(sig->batch_tag);
+    Py_XDECREF(sig->batch);
+
     py_signal_unref(sig->signal);
     Py_DECREF(sig->handler);
+    pysignals_filter_free(sig->filter);
+    g_free(sig->stats);
     g_free(sig->command);
     g_free(sig);
 }
@@ -666,9 +1894,11 @@ static void py_signal_rec_destroy(PY_SIGNAL_REC *sig)
 static void py_signal_add(PY_SIGNAL_SPEC_REC *sig)
 {
     if (sig->is_var)
-        g_tree_insert(py_sigtree, sig->name, sig);
+        g_hash_table_insert(py_sigvar, sig->name, sig);
     else
         g_hash_table_insert(py_sighash, sig->name, sig);
+
+    g_hash_table_remove_all(py_sigcache);
 }
 
 static void py_signal_remove(PY_SIGNAL_SPEC_REC *sig)
@@ -676,36 +1906,60 @@ static void py_signal_remove(PY_SIGNAL_SPEC_REC *sig)
     int ret;
 
     if (sig->is_var)
-        g_tree_remove(py_sigtree, sig->name);
+        ret = g_hash_table_remove(py_sigvar, sig->name);
     else
-    {
         ret = g_hash_table_remove(py_sighash, sig->name);
-        g_return_if_fail(ret != FALSE);
-    }
+
+    g_hash_table_remove_all(py_sigcache);
+    g_return_if_fail(ret != FALSE);
 }
 
-static int precmp(const char *spec, const char *test)
+/* "var event POOOM" -> "var event " entry, the longest matching prefix wins */
+static PY_SIGNAL_SPEC_REC *py_signal_lookup_var(const char *name)
 {
-    while (*spec == *test++)
-        if (*spec++ == '\0')
-            return 0;
+    PY_SIGNAL_SPEC_REC *ret = NULL;
+    char buf[128];
+    char *prefix;
+    int len;
 
-    /* Variable event prefix matches (spec must never be empty string)*/
-    /* precmp("var event ", "var event POOOM") -> 0 */
-    if (*spec == '\0' && *(spec-1) == ' ')
-        return 0;
-    
-    return *(const unsigned char *)(test - 1) - *(const unsigned char *)spec; 
+    len = strlen(name);
+    prefix = len < (int)sizeof(buf)? buf : g_malloc(len + 1);
+    memcpy(prefix, name, len + 1);
+
+    for (; len > 0 && !ret; len--)
+    {
+        if (prefix[len - 1] != ' ')
+            continue;
+
+        prefix[len] = '\0';
+        ret = g_hash_table_lookup(py_sigvar, prefix);
+    }
+
+    if (prefix != buf)
+        g_free(prefix);
+
+    return ret;
 }
 
 static PY_SIGNAL_SPEC_REC *py_signal_lookup(const char *name)
 {
     PY_SIGNAL_SPEC_REC *ret;
 
-    /* First check the normal signals hash, then check the variable signal prefixes in the tree */
+    ret = g_hash_table_lookup(py_sigcache, name);
+    if (ret)
+        return ret == &py_sigcache_miss? NULL : ret;
+
+    /* First check the normal signals hash, then the variable signal prefixes */
     ret = g_hash_table_lookup(py_sighash, name);
     if (!ret)
-        ret = g_tree_search(py_sigtree, (GCompareFunc)precmp, name);
+        ret = py_signal_lookup_var(name);
+
+    /* names come from scripts, don't let a loop over generated ones grow
+       the cache without bound */
+    if (g_hash_table_size(py_sigcache) >= PY_SIGCACHE_MAX)
+        g_hash_table_remove_all(py_sigcache);
+
+    g_hash_table_insert(py_sigcache, g_strdup(name), ret? ret : &py_sigcache_miss);
 
     return ret;
 }
@@ -758,6 +2012,14 @@ int pysignals_register(const char *name, const char *arglist)
         spec->refcount = 0;
         spec->name = g_strdup(name);
         spec->arglist = g_strdup(arglist);
+
+        if (!py_signal_compile(spec))
+        {
+            g_free(spec->name);
+            g_free(spec->arglist);
+            g_free(spec);
+            return 0;
+        }
         
         py_signal_add(spec);
     }
@@ -787,15 +2049,18 @@ void pysignals_init(void)
     int i;
     
     g_return_if_fail(py_sighash == NULL);
-    g_return_if_fail(py_sigtree == NULL);
+    g_return_if_fail(py_sigvar == NULL);
 
-    py_sigtree = g_tree_new((GCompareFunc)strcmp);
+    py_sigvar = g_hash_table_new(g_str_hash, g_str_equal);
     py_sighash = g_hash_table_new(g_str_hash, g_str_equal);
+    py_sigcache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    py_siggroups = g_hash_table_new(g_str_hash, g_str_equal);
 
     for (i = 0; i < py_sigmap_len(); i++)
     {
         py_sigmap[i].refcount = 1;
         py_sigmap[i].dynamic = 0;
+        py_signal_compile(&py_sigmap[i]);
         py_signal_add(&py_sigmap[i]);
     }
 }
@@ -815,13 +2080,21 @@ static int py_check_sig(char *key, PY_SIGNAL_SPEC_REC *value, void *data)
 void pysignals_deinit(void)
 {
     g_return_if_fail(py_sighash != NULL);
-    g_return_if_fail(py_sigtree != NULL);
+    g_return_if_fail(py_sigvar != NULL);
     
-    g_tree_foreach(py_sigtree, (GTraverseFunc)py_check_sig, NULL); 
+    g_hash_table_foreach_remove(py_sigvar, (GHRFunc)py_check_sig, NULL);
     g_hash_table_foreach_remove(py_sighash, (GHRFunc)py_check_sig, NULL);
 
-    g_tree_destroy(py_sigtree);
+    /* groups go away with their last handler */
+    if (g_hash_table_size(py_siggroups) != 0)
+        g_critical("%d Python signal groups still bound", g_hash_table_size(py_siggroups));
+
+    g_hash_table_destroy(py_sigvar);
     g_hash_table_destroy(py_sighash);
-    py_sigtree = NULL;
+    g_hash_table_destroy(py_sigcache);
+    g_hash_table_destroy(py_siggroups);
+    py_sigvar = NULL;
     py_sighash = NULL;
+    py_sigcache = NULL;
+    py_siggroups = NULL;
 }
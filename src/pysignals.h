@@ -1,16 +1,66 @@
 #ifndef _PYSIGNALS_H_
 #define _PYSIGNALS_H_
 #include <Python.h>
+#include "pystats.h"
 
 /* forward */
 struct _PY_SIGNAL_SPEC_REC;
+struct _PY_SIGNAL_GROUP_REC;
+
+/* Conditions checked in C before a handler is called, NULL/unset fields
+   match anything */
+typedef struct _PY_SIGNAL_FILTER_REC
+{
+    char **tags;        /* server tags */
+    char **targets;     /* channel, query or message target names */
+    char *nick;         /* nick mask, nick!user@host wildcards allowed */
+    GRegex *regex;      /* matched against the message text */
+
+    /* argument positions, resolved when the handler is bound */
+    int server_arg;
+    int target_arg;
+    int nick_arg;
+    int address_arg;
+    int text_arg;
+} PY_SIGNAL_FILTER_REC;
+
+/* how a handler gets its arguments, see Script.signal_add() */
+#define PY_ARGS_MESSAGE 1   /* the IRC line as an irssi.IrcMessage */
+#define PY_ARGS_VIEWS 2     /* other strings as irssi.StrView, not copied */
+#define PY_ARGS_TEXT 4      /* other strings as str, from the script's text_mode */
+#define PY_ARGS_MODES 8
+
+/* native handler from the C API, see pycapi.h; nonzero stops the signal */
+typedef int (*PY_SIGNAL_HOOK)(void *data, void **args);
 
 typedef struct _PY_SIGNAL_REC
 {
     struct _PY_SIGNAL_SPEC_REC *signal;
     char *command; /* used for command and variable signal */
     PyObject *handler;
+    PyObject *script; /* owner, current while the handler runs; may be NULL */
+    struct _PY_SIGNAL_GROUP_REC *group; /* fan-out list, NULL for commands */
+    PY_STATS_REC *stats;
+
+    /* a handler may remove itself while it runs; freeing waits for busy */
+    int busy;
+    int dead;
+
+    /* batch delivery: emissions are queued and the handler gets a list of
+       argument tuples every batch_ms milliseconds */
+    int batch_ms;
+    PyObject *batch;
+    guint batch_tag;
+
+    PY_SIGNAL_FILTER_REC *filter;
     int is_signal;
+
+    int argmode; /* PY_ARGS_* */
+
+    /* native handlers: handler is a capsule that owns data, hook is called
+       with the raw arguments and no Python objects are built */
+    PY_SIGNAL_HOOK hook;
+    void *hook_data;
 } PY_SIGNAL_REC;
 
 typedef enum
@@ -23,19 +73,33 @@ typedef enum
 PY_SIGNAL_REC *pysignals_command_bind(const char *cmd, PyObject *func, 
         const char *category, int priority);
 PY_SIGNAL_REC *pysignals_signal_add(const char *signal, PyObject *func, 
-        int priority);
-int pysignals_command_bind_list(GSList **list, const char *command, 
-        PyObject *func, const char *category, int priority);
-int pysignals_signal_add_list(GSList **list, const char *signal, 
-        PyObject *func, int priority);
+        int priority, int batch_ms, PY_SIGNAL_FILTER_REC *filter, int argmode);
+int pysignals_command_bind_list(GSList **list, PyObject *script, 
+        const char *command, PyObject *func, const char *category, int priority);
+int pysignals_signal_add_list(GSList **list, PyObject *script, 
+        const char *signal, PyObject *func, int priority, int batch_ms, 
+        PY_SIGNAL_FILTER_REC *filter, int argmode);
+PY_SIGNAL_REC *pysignals_hook_add_list(GSList **list, PyObject *script, 
+        const char *signal, int priority, PY_SIGNAL_HOOK hook, void *data, 
+        void (*destroy)(void *));
+PyObject *pysignals_wrap(char code, void *record);
+void *pysignals_unwrap(char code, PyObject *obj);
+void pysignals_filter_free(PY_SIGNAL_FILTER_REC *filter);
 void pysignals_command_unbind(PY_SIGNAL_REC *rec);
 void pysignals_signal_remove(PY_SIGNAL_REC *rec);
 void pysignals_remove_generic(PY_SIGNAL_REC *rec);
 int pysignals_remove_search(GSList **siglist, const char *name, 
         PyObject *func, PSG_TYPE type);
 void pysignals_remove_list(GSList *siglist);
-int pysignals_emit(const char *signal, PyObject *argtup);
+void pysignals_stats_foreach(GSList *siglist, PY_STATS_FUNC func, void *data);
+int pysignals_emit(const char *signal, PyObject *const *argv, Py_ssize_t argc);
+int pysignals_emit_spec(struct _PY_SIGNAL_SPEC_REC *spec, int signal_id, 
+        const char *name, PyObject *const *argv, Py_ssize_t argc);
+struct _PY_SIGNAL_SPEC_REC *pysignals_spec_get(const char *name);
+void pysignals_spec_put(struct _PY_SIGNAL_SPEC_REC *spec);
 int pysignals_continue(PyObject *argtup);
+void pysignals_stop(void);
+void pysignals_stop_by_name(const char *signal);
 int pysignals_register(const char *name, const char *arglist);
 int pysignals_unregister(const char *name);
 void pysignals_init(void);
@@ -21,6 +21,7 @@
 #include <Python.h>
 #include "pyirssi.h"
 #include "pysource.h"
+#include "pyloader.h"
 
 typedef struct _PY_SOURCE_REC
 {
@@ -29,14 +30,22 @@ typedef struct _PY_SOURCE_REC
     int fd;
     PyObject *func;
     PyObject *data;
+    PyObject *script; /* borrowed, sources are removed with the script */
+    int msecs;
+    PY_STATS_REC *stats;
 } PY_SOURCE_REC;
 
-static PY_SOURCE_REC *py_source_rec_new(GSList **tag_list, int fd, PyObject *func, PyObject *data)
+/* all live sources, for statistics */
+static GSList *py_sources = NULL;
+
+static PY_SOURCE_REC *py_source_rec_new(GSList **tag_list, PyObject *script, 
+        int fd, PyObject *func, PyObject *data)
 {
     PY_SOURCE_REC *rec;
 
     rec = g_new0(PY_SOURCE_REC, 1);
     rec->tag_list = tag_list;
+    rec->script = script;
     rec->fd = fd;
     rec->func = func;
     rec->data = data;
@@ -44,6 +53,8 @@ static PY_SOURCE_REC *py_source_rec_new(GSList **tag_list, int fd, PyObject *fun
     Py_INCREF(func);
     Py_XINCREF(data);
 
+    py_sources = g_slist_prepend(py_sources, rec);
+
     return rec;
 }
 
@@ -63,8 +74,10 @@ static int py_remove_tag(GSList **list, int handle)
 static void py_source_destroy(PY_SOURCE_REC *rec)
 {
     g_return_if_fail(py_remove_tag(rec->tag_list, rec->tag) == 1);
+    py_sources = g_slist_remove(py_sources, rec);
     Py_DECREF(rec->func);
     Py_XDECREF(rec->data);
+    g_free(rec->stats);
     g_free(rec);
 }
 
@@ -88,39 +101,72 @@ static int py_handle_ret(PyObject *ret)
 
 static int py_timeout_proxy(PY_SOURCE_REC *rec)
 {
-    PyObject *ret;
+    PyObject *ret, *prev;
+    gint64 start;
 
     g_return_val_if_fail(rec != NULL, FALSE);
     
+    /* a suspended timeout keeps its source, it is just not called */
+    if (PY_STATS_SUSPENDED(rec->stats))
+        return TRUE;
+
+    start = PY_STATS_START();
+    prev = pyloader_script_enter(rec->script);
     if (rec->data)
         ret = PyObject_CallFunction(rec->func, "O", rec->data);
     else
         ret = PyObject_CallFunction(rec->func, "");
+    pyloader_script_leave(prev);
+    if (PY_STATS_STOP(&rec->stats, start))
+    {
+        char name[32];
+
+        g_snprintf(name, sizeof(name), "%d ms", rec->msecs);
+        pystats_suspend_notice(rec->script, "timeout", name);
+    }
 
     return py_handle_ret(ret);
 }
 
 static int py_io_proxy(GIOChannel *src, GIOCondition condition, PY_SOURCE_REC *rec)
 {
-    PyObject *ret;
+    PyObject *ret, *prev;
+    gint64 start;
+    int res, suspended;
 
     g_return_val_if_fail(rec != NULL, FALSE);
 
+    start = PY_STATS_START();
+    prev = pyloader_script_enter(rec->script);
     if (rec->data)
         ret = PyObject_CallFunction(rec->func, "iiO", rec->fd, condition, rec->data);
     else
         ret = PyObject_CallFunction(rec->func, "ii", rec->fd, condition);
+    pyloader_script_leave(prev);
+    suspended = PY_STATS_STOP(&rec->stats, start);
 
-    return py_handle_ret(ret);
+    res = py_handle_ret(ret);
+
+    /* a skipped io watch would fire again right away, so it is removed */
+    if (suspended)
+    {
+        printtext(NULL, NULL, MSGLEVEL_CLIENTERROR, 
+                "io watch on fd %d went over its time budget and was removed", rec->fd);
+        return FALSE;
+    }
+
+    return res;
 }
 
-int pysource_timeout_add_list(GSList **list, int msecs, PyObject *func, PyObject *data)
+int pysource_timeout_add_list(GSList **list, PyObject *script, int msecs, 
+        PyObject *func, PyObject *data)
 {
     PY_SOURCE_REC *rec;
 
     g_return_val_if_fail(func != NULL, -1);
 
-    rec = py_source_rec_new(list, -1, func, data);
+    rec = py_source_rec_new(list, script, -1, func, data);
+    rec->msecs = msecs;
     rec->tag = g_timeout_add_full(G_PRIORITY_DEFAULT, msecs, 
             (GSourceFunc)py_timeout_proxy, rec, 
             (GDestroyNotify)py_source_destroy);
@@ -130,14 +176,15 @@ int pysource_timeout_add_list(GSList **list, int msecs, PyObject *func, PyObject
     return rec->tag;
 }
 
-int pysource_io_add_watch_list(GSList **list, int fd, int cond, PyObject *func, PyObject *data)
+int pysource_io_add_watch_list(GSList **list, PyObject *script, int fd, int cond, 
+        PyObject *func, PyObject *data)
 {
     PY_SOURCE_REC *rec;
     GIOChannel *channel;
 
     g_return_val_if_fail(func != NULL, 1);
 
-    rec = py_source_rec_new(list, fd, func, data);
+    rec = py_source_rec_new(list, script, fd, func, data);
     channel = g_io_channel_unix_new(fd);
     rec->tag = g_io_add_watch_full(channel, G_PRIORITY_DEFAULT, cond, 
             (GIOFunc)py_io_proxy, rec,
@@ -148,3 +195,28 @@ int pysource_io_add_watch_list(GSList **list, int fd, int cond, PyObject *func,
     
     return rec->tag;
 }
+
+void pysource_stats_foreach(PyObject *script, PY_STATS_FUNC func, void *data)
+{
+    GSList *node;
+
+    for (node = py_sources; node != NULL; node = node->next)
+    {
+        PY_SOURCE_REC *rec = node->data;
+        char name[32];
+
+        if (rec->script != script)
+            continue;
+
+        if (rec->fd < 0)
+        {
+            g_snprintf(name, sizeof(name), "%d ms", rec->msecs);
+            func("timeout", name, rec->func, rec->stats, data);
+        }
+        else
+        {
+            g_snprintf(name, sizeof(name), "fd %d", rec->fd);
+            func("io", name, rec->func, rec->stats, data);
+        }
+    }
+}
@@ -2,9 +2,13 @@
 #define _PYSOURCE_H_
 
 #include <Python.h>
+#include "pystats.h"
 
 /* condition is G_INPUT_READ or G_INPUT_WRITE */
-int pysource_io_add_watch_list(GSList **list, int fd, int cond, PyObject *func, PyObject *data);
-int pysource_timeout_add_list(GSList **list, int msecs, PyObject *func, PyObject *data);
+int pysource_io_add_watch_list(GSList **list, PyObject *script, int fd, int cond, 
+        PyObject *func, PyObject *data);
+int pysource_timeout_add_list(GSList **list, PyObject *script, int msecs, 
+        PyObject *func, PyObject *data);
+void pysource_stats_foreach(PyObject *script, PY_STATS_FUNC func, void *data);
 
 #endif
@@ -0,0 +1,222 @@
+/* 
+    irssi-python
+
+    Copyright (C) 2006 Christopher Davis
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <Python.h>
+#include "pyirssi.h"
+#include "pystats.h"
+#include "pyscript-object.h"
+
+/* Handler statistics and watchdog. Each signal, command, source and 
+ * statusbar record owns a PY_STATS_REC, allocated on the first call made 
+ * while statistics or the watchdog are enabled, and freed with the record.
+ *
+ * Times are the handler's own: a handler that emits a signal or runs a 
+ * command isn't charged for the Python handlers that run inside it.
+ *
+ * The watchdog can't interrupt a handler, the whole client is blocked while
+ * it runs. It counts calls that took longer than python_handler_budget, and
+ * after python_handler_strikes of them in a row the handler is suspended: 
+ * the proxies stop calling it until /py resume. A call within the budget 
+ * clears the count, so an occasional slow call never adds up to a 
+ * suspension.
+ */
+
+int pystats_enabled = 0;
+gint64 pystats_budget = 0; /* microseconds, 0 disables the watchdog */
+gint64 pystats_handler_time = 0; /* own time of all timed handlers so far */
+static int pystats_strikes = 3;
+
+/* returns 1 when the handler got suspended by this call */
+int pystats_record(PY_STATS_REC **stats, gint64 start)
+{
+    PY_STATS_REC *st = *stats;
+    gint64 elapsed;
+    int bucket;
+
+    if (!st)
+        st = *stats = g_new0(PY_STATS_REC, 1);
+
+    /* start was shifted by pystats_handler_time, see PY_STATS_START() */
+    elapsed = g_get_monotonic_time() - pystats_handler_time - start;
+    if (elapsed < 0)
+        elapsed = 0;
+    pystats_handler_time += elapsed;
+
+    if (pystats_enabled)
+    {
+        st->calls++;
+        st->total += elapsed;
+        if (elapsed > st->max)
+            st->max = elapsed;
+
+        for (bucket = 0; bucket < PY_STATS_BUCKETS - 1 && (elapsed >> (bucket + 1)) > 0; bucket++)
+            ;
+        st->hist[bucket]++;
+    }
+
+    if (pystats_budget && !st->suspended)
+    {
+        if (elapsed <= pystats_budget)
+            st->strikes = 0;
+        else if (++st->strikes >= pystats_strikes)
+        {
+            st->suspended = 1;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void pystats_suspend_notice(PyObject *script, const char *kind, const char *name)
+{
+    const char *sname = script? pyscript_get_name(script) : NULL;
+
+    printtext(NULL, NULL, MSGLEVEL_CLIENTERROR, 
+            "%s: %s handler for %s went over the %ld ms time budget %d times in a row and was "
+            "suspended, use /py resume %s to enable it again", 
+            sname? sname : "python", kind, name, (long)(pystats_budget / 1000), 
+            pystats_strikes, sname? sname : "");
+}
+
+/* PY_STATS_FUNC lifting a suspension */
+void pystats_resume(const char *kind, const char *name, 
+        PyObject *handler, PY_STATS_REC *stats, void *data)
+{
+    if (!stats)
+        return;
+
+    if (stats->suspended)
+        printtext(NULL, NULL, MSGLEVEL_CLIENTNOTICE, "resumed %s handler for %s", kind, name);
+
+    stats->suspended = 0;
+    stats->strikes = 0;
+}
+
+static char *py_handler_name(PyObject *handler)
+{
+    PyObject *name;
+    char *ret = NULL;
+
+    name = PyObject_GetAttrString(handler, "__qualname__");
+    if (name && PyUnicode_Check(name))
+        ret = g_strdup(PyUnicode_AsUTF8(name));
+
+    Py_XDECREF(name);
+    PyErr_Clear();
+
+    return ret? ret : g_strdup("?");
+}
+
+PyObject *pystats_to_dict(const char *kind, const char *name, 
+        PyObject *handler, PY_STATS_REC *stats)
+{
+    PY_STATS_REC empty;
+    PyObject *hist;
+    int i;
+
+    if (!stats)
+    {
+        memset(&empty, 0, sizeof empty);
+        stats = &empty;
+    }
+
+    hist = PyTuple_New(PY_STATS_BUCKETS);
+    if (!hist)
+        return NULL;
+
+    for (i = 0; i < PY_STATS_BUCKETS; i++)
+        PyTuple_SET_ITEM(hist, i, PyLong_FromUnsignedLong(stats->hist[i]));
+
+    return Py_BuildValue("{s:y,s:y,s:O,s:K,s:d,s:d,s:N,s:i,s:O}",
+            "kind", kind,
+            "name", name,
+            "handler", handler,
+            "calls", (unsigned long long)stats->calls,
+            "total", stats->total / 1e6,
+            "max", stats->max / 1e6,
+            "histogram", hist,
+            "strikes", stats->strikes,
+            "suspended", stats->suspended? Py_True : Py_False);
+}
+
+/* PY_STATS_FUNC clearing the counters */
+void pystats_reset(const char *kind, const char *name, 
+        PyObject *handler, PY_STATS_REC *stats, void *data)
+{
+    if (!stats)
+        return;
+
+    stats->calls = 0;
+    stats->total = 0;
+    stats->max = 0;
+    memset(stats->hist, 0, sizeof stats->hist);
+}
+
+void pystats_print_header(void)
+{
+    char buf[128];
+
+    g_snprintf(buf, sizeof(buf), "%-10s %-25s %-20s %8s %10s %8s %8s",
+            "Kind", "Name", "Handler", "Calls", "Total ms", "Avg us", "Max us");
+    printtext_string(NULL, NULL, MSGLEVEL_CLIENTCRAP, buf);
+}
+
+/* PY_STATS_FUNC printing one line; handlers that never ran are skipped */
+void pystats_print(const char *kind, const char *name, 
+        PyObject *handler, PY_STATS_REC *stats, void *data)
+{
+    char buf[256];
+    char *hname;
+
+    if (!stats || (!stats->calls && !stats->suspended))
+        return;
+
+    hname = py_handler_name(handler);
+    g_snprintf(buf, sizeof(buf), "%-10s %-25s %-20s %8lu %10.2f %8lu %8ld%s",
+            kind, name, hname, (unsigned long)stats->calls, stats->total / 1000.0,
+            (unsigned long)(stats->calls? stats->total / stats->calls : 0), 
+            (long)stats->max, stats->suspended? " suspended" : "");
+    printtext_string(NULL, NULL, MSGLEVEL_CLIENTCRAP, buf);
+
+    g_free(hname);
+}
+
+static void read_settings(void)
+{
+    pystats_budget = (gint64)settings_get_time("python_handler_budget") * 1000;
+    pystats_strikes = settings_get_int("python_handler_strikes");
+    if (pystats_strikes < 1)
+        pystats_strikes = 1;
+}
+
+void pystats_init(void)
+{
+    settings_add_time("python", "python_handler_budget", "0");
+    settings_add_int("python", "python_handler_strikes", 3);
+
+    read_settings();
+    signal_add("setup changed", (SIGNAL_FUNC) read_settings);
+}
+
+void pystats_deinit(void)
+{
+    signal_remove("setup changed", (SIGNAL_FUNC) read_settings);
+}
@@ -0,0 +1,61 @@
+#ifndef _PYSTATS_H_
+#define _PYSTATS_H_
+
+#include <Python.h>
+#include <glib.h>
+
+/* bucket i counts calls that took [2^i, 2^(i+1)) microseconds; the last
+   bucket also takes everything slower */
+#define PY_STATS_BUCKETS 24
+
+typedef struct _PY_STATS_REC
+{
+    guint64 calls;
+    gint64 total; /* microseconds */
+    gint64 max;
+    guint32 hist[PY_STATS_BUCKETS];
+
+    /* watchdog state, kept across /py stats reset */
+    int strikes;        /* calls over python_handler_budget in a row */
+    int suspended;
+} PY_STATS_REC;
+
+typedef void (*PY_STATS_FUNC)(const char *kind, const char *name, 
+        PyObject *handler, PY_STATS_REC *stats, void *data);
+
+extern int pystats_enabled;
+extern gint64 pystats_budget;
+extern gint64 pystats_handler_time;
+
+/* Timing is skipped entirely while statistics and the watchdog are off. 
+ * Only the handler's own time is counted: the start is shifted by the time
+ * of every handler that returned since, which includes the ones it set off
+ * itself. PY_STATS_STOP() is true when the handler was just suspended for going 
+ * over its time budget too often. Usage:
+ *     if (PY_STATS_SUSPENDED(rec->stats))
+ *         return;
+ *     gint64 start = PY_STATS_START();
+ *     ...call into Python...
+ *     if (PY_STATS_STOP(&rec->stats, start))
+ *         pystats_suspend_notice(rec->script, "signal", name);
+ */
+#define PY_STATS_START() \
+    ((pystats_enabled || pystats_budget)? g_get_monotonic_time() - pystats_handler_time : 0)
+#define PY_STATS_STOP(stats, start) ((start) && pystats_record(stats, start))
+#define PY_STATS_SUSPENDED(stats) ((stats) != NULL && (stats)->suspended)
+
+int pystats_record(PY_STATS_REC **stats, gint64 start);
+void pystats_suspend_notice(PyObject *script, const char *kind, const char *name);
+void pystats_resume(const char *kind, const char *name, 
+        PyObject *handler, PY_STATS_REC *stats, void *data);
+PyObject *pystats_to_dict(const char *kind, const char *name, 
+        PyObject *handler, PY_STATS_REC *stats);
+void pystats_reset(const char *kind, const char *name, 
+        PyObject *handler, PY_STATS_REC *stats, void *data);
+void pystats_print_header(void);
+void pystats_print(const char *kind, const char *name, 
+        PyObject *handler, PY_STATS_REC *stats, void *data);
+void pystats_init(void);
+void pystats_deinit(void);
+
+#endif
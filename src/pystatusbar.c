@@ -21,12 +21,18 @@
 #include "pystatusbar.h"
 #include "pyirssi.h"
 #include "factory.h"
+#include "pyloader.h"
 
 typedef struct
 {
     char *name;
     PyObject *script;
     PyObject *handler;
+    PY_STATS_REC *stats;
+
+    /* the handler may unregister its own item; freeing waits for busy */
+    int busy;
+    int dead;
 } PY_BAR_ITEM_REC;
 
 /* Map: item name -> bar item obj */
@@ -48,36 +54,62 @@ static void py_add_bar_handler(const char *iname, PyObject *script, PyObject *ha
 
 static void py_destroy_handler(PY_BAR_ITEM_REC *sitem)
 {
-    statusbar_item_unregister(sitem->name);
+    if (!sitem->dead)
+        statusbar_item_unregister(sitem->name);
+
+    if (sitem->busy)
+    {
+        sitem->dead = 1;
+        return;
+    }
 
     g_free(sitem->name); /* destroy key */
     Py_DECREF(sitem->script);
     Py_DECREF(sitem->handler);
+    g_free(sitem->stats);
     g_free(sitem);
 }
 
 static void py_statusbar_proxy_call(SBAR_ITEM_REC *item, int sizeonly, PY_BAR_ITEM_REC *sitem)
 {
     PyObject *pybaritem;
-    PyObject *ret;
+    PyObject *ret, *prev;
+    gint64 start;
 
     g_return_if_fail(PyCallable_Check(sitem->handler));
 
+    if (PY_STATS_SUSPENDED(sitem->stats))
+    {
+        statusbar_item_default_handler(item, sizeonly, NULL, "", TRUE);
+        return;
+    }
+
     pybaritem = pystatusbar_item_new(item);
     if (!pybaritem)
     {
         PyErr_Print();
         pystatusbar_item_unregister(sitem->name);
+        return;
     }
 
+    sitem->busy++;
+    start = PY_STATS_START();
+    prev = pyloader_script_enter(sitem->script);
     ret = PyObject_CallFunction(sitem->handler, "Oi", pybaritem, sizeonly);
+    pyloader_script_leave(prev);
+    if (PY_STATS_STOP(&sitem->stats, start))
+        pystats_suspend_notice(sitem->script, "statusbar", sitem->name);
     if (!ret)
     {
         PyErr_Print();
-        pystatusbar_item_unregister(sitem->name);
+        if (!sitem->dead)
+            pystatusbar_item_unregister(sitem->name);
     }
     else
         Py_DECREF(ret);
+
+    if (--sitem->busy == 0 && sitem->dead)
+        py_destroy_handler(sitem);
 }
 
 static void py_statusbar_proxy(SBAR_ITEM_REC *item, int sizeonly)
@@ -131,6 +163,21 @@ void pystatusbar_cleanup_script(PyObject *script)
     g_hash_table_foreach_remove(py_bar_items, (GHRFunc)py_check_clean, script);
 }
 
+void pystatusbar_stats_foreach(PyObject *script, PY_STATS_FUNC func, void *data)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+
+    g_hash_table_iter_init(&iter, py_bar_items);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+    {
+        PY_BAR_ITEM_REC *sitem = value;
+
+        if (sitem->script == script)
+            func("statusbar", sitem->name, sitem->handler, sitem->stats, data);
+    }
+}
+
 void pystatusbar_init(void)
 {
     g_return_if_fail(py_bar_items == NULL);
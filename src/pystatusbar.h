@@ -2,11 +2,13 @@
 #define _PYSTATUSBAR_H_
 
 #include <Python.h>
+#include "pystats.h"
 
 void pystatusbar_item_register(PyObject *script, const char *sitem, 
         const char *value, PyObject *func);
 void pystatusbar_item_unregister(const char *iname);
 void pystatusbar_cleanup_script(PyObject *script);
+void pystatusbar_stats_foreach(PyObject *script, PY_STATS_FUNC func, void *data);
 void pystatusbar_init(void);
 void pystatusbar_deinit(void);
 
@@ -18,9 +18,12 @@
     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
+#include <Python.h>
 #include <string.h>
 #include "pyirssi.h"
 #include "pyutils.h"
+#include "pyloader.h"
+#include "pyscript-object.h"
 #include <irssi/src/core/settings.h>
 #include <irssi/src/core/servers.h>
 
@@ -99,3 +102,171 @@ char *file_get_filename(const char *path)
     return name;
 }
 
+
+static unsigned long py_main_thread = 0;
+
+void py_main_thread_init(void)
+{
+    py_main_thread = PyThread_get_thread_ident();
+}
+
+int py_is_main_thread(void)
+{
+    return PyThread_get_thread_ident() == py_main_thread;
+}
+
+int py_check_main_thread(void)
+{
+    if (py_is_main_thread())
+        return 1;
+
+    PyErr_SetString(PyExc_RuntimeError, 
+            "Irssi can only be used from the main thread, see call_soon_threadsafe()");
+    return 0;
+}
+
+int py_text_str = 0;
+
+int py_text_is_str(void)
+{
+    PyObject *script;
+
+    if (py_is_main_thread())
+        return py_text_str;
+
+    script = pyloader_find_script_obj();
+    return script && ((PyScript *)script)->text_str;
+}
+
+PyObject *py_text_decode(const char *str, Py_ssize_t len)
+{
+    PyObject *ret;
+    const char *fallback;
+
+    /* ASCII and UTF-8, the common case */
+    ret = PyUnicode_DecodeUTF8(str, len, NULL);
+    if (ret || !PyErr_ExceptionMatches(PyExc_UnicodeDecodeError))
+        return ret;
+    PyErr_Clear();
+
+    /* what Irssi itself would recode it from */
+    fallback = settings_get_str("recode_fallback");
+    ret = PyUnicode_Decode(str, len, fallback && *fallback? fallback : "iso-8859-1", "replace");
+    if (ret || !PyErr_ExceptionMatches(PyExc_LookupError))
+        return ret;
+    PyErr_Clear();
+
+    return PyUnicode_DecodeUTF8(str, len, "surrogateescape");
+}
+
+PyObject *py_text_new(const char *str)
+{
+    if (!str)
+        Py_RETURN_NONE;
+
+    if (py_text_is_str())
+        return py_text_decode(str, strlen(str));
+
+    return PyBytes_FromString(str);
+}
+
+/* the pointer is borrowed from obj, which the caller's arguments hold */
+int py_str_conv(PyObject *obj, void *addr)
+{
+    const char **str = addr;
+    Py_ssize_t len;
+
+    if (PyBytes_Check(obj))
+    {
+        *str = PyBytes_AS_STRING(obj);
+        len = PyBytes_GET_SIZE(obj);
+    }
+    else if (PyUnicode_Check(obj))
+    {
+        *str = PyUnicode_AsUTF8AndSize(obj, &len);
+        if (!*str)
+            return 0;
+    }
+    else
+    {
+        PyErr_Format(PyExc_TypeError, "expected bytes or str, not %.200s", 
+                Py_TYPE(obj)->tp_name);
+        return 0;
+    }
+
+    if ((Py_ssize_t)strlen(*str) != len)
+    {
+        PyErr_SetString(PyExc_ValueError, "embedded null byte");
+        return 0;
+    }
+
+    return 1;
+}
+
+typedef struct
+{
+    char *raw;          /* the string the values were made from */
+    PyObject *value[2]; /* bytes, str; built when first asked for */
+} PY_TEXT_ENTRY;
+
+struct _PY_TEXT_CACHE
+{
+    PY_TEXT_ENTRY entries[PY_TEXT_SLOTS];
+};
+
+static void py_text_entry_clear(PY_TEXT_ENTRY *entry)
+{
+    g_free(entry->raw);
+    entry->raw = NULL;
+    Py_CLEAR(entry->value[0]);
+    Py_CLEAR(entry->value[1]);
+}
+
+PyObject *py_text_cached(PY_TEXT_CACHE **cache, int slot, const char *str)
+{
+    PY_TEXT_ENTRY *entry;
+    PyObject **value;
+    int text_str;
+
+    g_return_val_if_fail(slot >= 0 && slot < PY_TEXT_SLOTS, NULL);
+
+    if (!str)
+        Py_RETURN_NONE;
+
+    if (!*cache)
+        *cache = g_new0(PY_TEXT_CACHE, 1);
+
+    /* the field may have been changed, or freed and set again, since */
+    entry = &(*cache)->entries[slot];
+    if (!entry->raw || strcmp(entry->raw, str) != 0)
+    {
+        py_text_entry_clear(entry);
+        entry->raw = g_strdup(str);
+    }
+
+    text_str = py_text_is_str();
+    value = &entry->value[text_str];
+    if (!*value)
+    {
+        *value = text_str? py_text_decode(str, strlen(str)) : PyBytes_FromString(str);
+        if (!*value)
+            return NULL;
+    }
+
+    Py_INCREF(*value);
+    return *value;
+}
+
+void py_text_cache_free(PY_TEXT_CACHE **cache)
+{
+    int i;
+
+    if (!*cache)
+        return;
+
+    for (i = 0; i < PY_TEXT_SLOTS; i++)
+        py_text_entry_clear(&(*cache)->entries[i]);
+
+    g_free(*cache);
+    *cache = NULL;
+}
@@ -1,6 +1,7 @@
 #ifndef _PYUTILS_H_
 #define _PYUTILS_H_
 
+#include <Python.h>
 #include <irssi/src/core/servers.h>
 
 void py_command(const char *cmd, SERVER_REC *server, WI_ITEM_REC *item);
@@ -8,5 +9,48 @@ char *file_get_ext(const char *file);
 int file_has_ext(const char *file, const char *ext);
 char *file_get_filename(const char *path);
 
+/* Irssi, and everything kept here about scripts, belongs to the main 
+ * thread. With the GIL other threads only got in while the main thread was
+ * in Python code or idle; free-threaded builds have to turn them away, and
+ * PY_CHECK_THREAD() does that, raising RuntimeError. Other builds skip it.
+ */
+void py_main_thread_init(void);
+int py_is_main_thread(void);
+int py_check_main_thread(void);
+#ifdef Py_GIL_DISABLED
+#define PY_CHECK_THREAD() py_check_main_thread()
+#else
+#define PY_CHECK_THREAD() 1
+#endif
+
+/* Strings for Python: bytes, or str while a script with text_mode 'str'
+ * runs; py_text_str follows the running script on the main thread, see 
+ * pyloader_script_enter(), and py_text_is_str() also answers for other 
+ * threads. Text that isn't UTF-8 is decoded from Irssi's recode_fallback
+ * charset.
+ */
+extern int py_text_str;
+int py_text_is_str(void);
+PyObject *py_text_new(const char *str);
+PyObject *py_text_decode(const char *str, Py_ssize_t len);
+
+/* PyArg_Parse "O&" converter for string arguments, taking bytes as well as
+   the str handed out in text_mode 'str' (encoded as UTF-8) */
+int py_str_conv(PyObject *obj, void *addr);
+
+/* Getters of fields that rarely change (server tag, item name, nick) keep
+ * what they returned last on the wrapper, and reuse it for as long as the
+ * field holds the same string.
+ */
+typedef struct _PY_TEXT_CACHE PY_TEXT_CACHE;
+enum
+{
+    PY_TEXT_TAG,
+    PY_TEXT_NAME,
+    PY_TEXT_NICK,
+    PY_TEXT_SLOTS
+};
+PyObject *py_text_cached(PY_TEXT_CACHE **cache, int slot, const char *str);
+void py_text_cache_free(PY_TEXT_CACHE **cache);
 
 #endif
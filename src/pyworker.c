@@ -0,0 +1,409 @@
+/* 
+    irssi-python
+
+    Copyright (C) 2006 Christopher Davis
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <Python.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include "pyirssi.h"
+#include "pyworker.h"
+#include "pyasync.h"
+#include "pyloader.h"
+#include "pyutils.h"
+#include "pyscript-object.h"
+
+#if PY_VERSION_HEX < 0x03090000
+#define PyThreadState_GetInterpreter(tstate) ((tstate)->interp)
+#endif
+
+/* Blocking work runs on a fixed pool of native threads and reports back to
+ * the main thread:
+ *
+ *  - run_in_worker() queues a job on a GThreadPool. The worker takes the
+ *    GIL, calls the function and pushes the finished job on the completion
+ *    queue.
+ *  - call_soon_threadsafe() pushes a job on the completion queue directly,
+ *    from any thread.
+ *  - the completion queue is a lock-free stack that any number of threads
+ *    push onto; the main thread takes the whole stack at once. A push onto
+ *    an empty stack writes a byte to a pipe, whose read end is an io watch
+ *    on the main loop.
+ *
+ * Callbacks run on the main thread with the submitting script current, and
+ * are dropped if that script was unloaded in the meantime.
+ *
+ * A job of a script loaded with /py isolate runs in the script's 
+ * interpreter, on a thread state made for it, and keeps that interpreter 
+ * from being ended until the job is freed.
+ *
+ * The main thread holds the GIL whenever it runs Python, which is only 
+ * while GLib dispatches. The GIL is released while GLib polls, so workers
+ * (and threads started by scripts) make progress while Irssi is idle.
+ */
+
+#define PY_WORKER_THREADS_MAX 64
+
+typedef struct _PY_WORKER_JOB
+{
+    struct _PY_WORKER_JOB *next;
+    PyObject *script;
+    PyObject *func;         /* NULL for call_soon_threadsafe() */
+    PyObject *args;
+    PyObject *callback;
+    PyInterpreterState *interp; /* of an isolated script, else NULL */
+
+    /* set by the worker */
+    PyObject *result;
+    PyObject *exc_type;
+    PyObject *exc_value;
+    PyObject *exc_tb;
+} PY_WORKER_JOB;
+
+static GThreadPool *py_pool = NULL;
+static PY_WORKER_JOB *volatile py_done = NULL;
+static int py_stopping = 0;
+static int py_wake[2] = {-1, -1};
+static guint py_wake_tag = 0;
+static GPrivate py_worker_script = G_PRIVATE_INIT(NULL);
+static GPollFunc py_poll_prev = NULL;
+
+static gint py_poll(GPollFD *ufds, guint nfds, gint timeout)
+{
+    gint ret;
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = py_poll_prev(ufds, nfds, timeout);
+    Py_END_ALLOW_THREADS
+
+    return ret;
+}
+
+/* Safe from any thread, without the GIL */
+static void py_job_complete(PY_WORKER_JOB *job)
+{
+    PY_WORKER_JOB *head;
+
+    do
+    {
+        head = g_atomic_pointer_get(&py_done);
+        job->next = head;
+    } while (!g_atomic_pointer_compare_and_exchange(&py_done, head, job));
+
+    /* the main thread is only woken for the first job of a batch */
+    if (head == NULL)
+    {
+        ssize_t ret;
+
+        do
+            ret = write(py_wake[1], "", 1);
+        while (ret < 0 && errno == EINTR);
+    }
+}
+
+/* Takes the completed jobs, oldest first */
+static PY_WORKER_JOB *py_jobs_take(void)
+{
+    PY_WORKER_JOB *list, *job, *rev = NULL;
+
+    do
+        list = g_atomic_pointer_get(&py_done);
+    while (!g_atomic_pointer_compare_and_exchange(&py_done, list, NULL));
+
+    while (list)
+    {
+        job = list;
+        list = job->next;
+        job->next = rev;
+        rev = job;
+    }
+
+    return rev;
+}
+
+static void py_job_free(PY_WORKER_JOB *job)
+{
+    PyObject *script = job->script;
+
+    Py_XDECREF(job->func);
+    Py_XDECREF(job->args);
+    Py_XDECREF(job->callback);
+    Py_XDECREF(job->result);
+    Py_XDECREF(job->exc_type);
+    Py_XDECREF(job->exc_value);
+    Py_XDECREF(job->exc_tb);
+    if (job->interp)
+        g_atomic_int_dec_and_test(&((PyScript *)script)->workers);
+    Py_XDECREF(script);
+    g_free(job);
+}
+
+static PY_WORKER_JOB *py_job_new(PyObject *script, PyObject *func, 
+        PyObject *args, PyObject *callback)
+{
+    PY_WORKER_JOB *job = g_new0(PY_WORKER_JOB, 1);
+
+    Py_XINCREF(script);
+    Py_XINCREF(func);
+    Py_INCREF(args);
+    Py_XINCREF(callback);
+    job->script = script;
+    job->func = func;
+    job->args = args;
+    job->callback = callback;
+
+    if (script && pyscript_get_tstate(script))
+    {
+        job->interp = PyThreadState_GetInterpreter(pyscript_get_tstate(script));
+        g_atomic_int_inc(&((PyScript *)script)->workers);
+    }
+
+    return job;
+}
+
+static void py_worker_run(PY_WORKER_JOB *job, gpointer unused)
+{
+    PyGILState_STATE state;
+    PyThreadState *tstate = NULL;
+
+    /* jobs still queued at unload are only handed back to be freed */
+    if (!g_atomic_int_get(&py_stopping))
+    {
+        /* PyGILState only knows the main interpreter */
+        if (job->interp)
+        {
+            tstate = PyThreadState_New(job->interp);
+            PyEval_RestoreThread(tstate);
+        }
+        else
+            state = PyGILState_Ensure();
+        g_private_set(&py_worker_script, job->script);
+
+        job->result = PyObject_Call(job->func, job->args, NULL);
+        if (!job->result)
+            PyErr_Fetch(&job->exc_type, &job->exc_value, &job->exc_tb);
+
+        g_private_set(&py_worker_script, NULL);
+        if (tstate)
+        {
+            PyThreadState_Clear(tstate);
+            PyThreadState_DeleteCurrent();
+        }
+        else
+            PyGILState_Release(state);
+    }
+
+    py_job_complete(job);
+}
+
+static void py_job_deliver(PY_WORKER_JOB *job)
+{
+    PyObject *prev, *ret;
+
+    if (job->script && !pyloader_script_loaded(job->script))
+        return;
+
+    prev = pyloader_script_enter(job->script);
+
+    if (!job->func)
+        ret = PyObject_Call(job->callback, job->args, NULL);
+    else if (job->exc_type)
+    {
+        PyErr_Restore(job->exc_type, job->exc_value, job->exc_tb);
+        job->exc_type = job->exc_value = job->exc_tb = NULL;
+        ret = NULL;
+    }
+    else if (job->callback)
+        ret = PyObject_CallFunctionObjArgs(job->callback, job->result, NULL);
+    else
+    {
+        Py_INCREF(Py_None);
+        ret = Py_None;
+    }
+
+    if (ret && PyCoro_CheckExact(ret))
+        ret = pyasync_run_handler(job->script, ret);
+
+    if (!ret)
+        PyErr_Print();
+    Py_XDECREF(ret);
+
+    pyloader_script_leave(prev);
+}
+
+static gboolean py_wake_proxy(GIOChannel *src, GIOCondition cond, gpointer data)
+{
+    PY_WORKER_JOB *job, *next;
+    char buf[64];
+
+    /* drain the pipe before taking the jobs: a push that comes after the 
+       take finds the stack empty and wakes us up again */
+    while (read(py_wake[0], buf, sizeof(buf)) > 0)
+        ;
+
+    for (job = py_jobs_take(); job != NULL; job = next)
+    {
+        next = job->next;
+        py_job_deliver(job);
+        py_job_free(job);
+    }
+
+    return TRUE;
+}
+
+static GThreadPool *py_pool_get(void)
+{
+    GError *error = NULL;
+    int threads;
+
+    if (py_pool)
+        return py_pool;
+
+    threads = settings_get_int("python_worker_threads");
+    if (threads < 1)
+        threads = 1;
+    if (threads > PY_WORKER_THREADS_MAX)
+        threads = PY_WORKER_THREADS_MAX;
+
+    py_pool = g_thread_pool_new((GFunc)py_worker_run, NULL, threads, TRUE, &error);
+    if (!py_pool)
+    {
+        PyErr_Format(PyExc_RuntimeError, "cannot start worker threads: %s", 
+                error->message);
+        g_error_free(error);
+    }
+
+    return py_pool;
+}
+
+/* Run func(*args) on a worker thread, then callback(result) on the main
+ * thread. Returns 0 with an exception set on failure.
+ */
+int pyworker_submit(PyObject *script, PyObject *func, PyObject *args, 
+        PyObject *callback)
+{
+    PY_WORKER_JOB *job;
+    GError *error = NULL;
+
+    g_return_val_if_fail(func != NULL && args != NULL, 0);
+
+    if (!py_pool_get())
+        return 0;
+
+    job = py_job_new(script, func, args, callback);
+    if (!g_thread_pool_push(py_pool, job, &error))
+    {
+        py_job_free(job);
+        PyErr_Format(PyExc_RuntimeError, "cannot queue job: %s", error->message);
+        g_error_free(error);
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Run func(*args) on the main thread. Any thread holding the GIL may call
+ * this.
+ */
+int pyworker_call_soon(PyObject *script, PyObject *func, PyObject *args)
+{
+    g_return_val_if_fail(func != NULL && args != NULL, 0);
+
+    if (py_wake[1] < 0)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Irssi main loop is gone");
+        return 0;
+    }
+
+    py_job_complete(py_job_new(script, NULL, args, func));
+    return 1;
+}
+
+/* The script a new job belongs to. On the main thread that is the running
+ * script; on a worker it is the script that submitted the running job. 
+ * Other threads have no script here, see pyloader_find_script_obj().
+ */
+PyObject *pyworker_current_script(void)
+{
+    if (py_is_main_thread())
+        return pyloader_find_script_obj();
+
+    return g_private_get(&py_worker_script);
+}
+
+int pyworker_init(void)
+{
+    GIOChannel *channel;
+
+    g_return_val_if_fail(py_wake_tag == 0, 0);
+
+    if (pipe(py_wake) != 0)
+        return 0;
+
+    fcntl(py_wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(py_wake[1], F_SETFL, O_NONBLOCK);
+
+    channel = g_io_channel_unix_new(py_wake[0]);
+    py_wake_tag = g_io_add_watch(channel, G_IO_IN, py_wake_proxy, NULL);
+    g_io_channel_unref(channel);
+
+    settings_add_int("python", "python_worker_threads", 4);
+
+    py_poll_prev = g_main_context_get_poll_func(NULL);
+    g_main_context_set_poll_func(NULL, py_poll);
+
+    return 1;
+}
+
+/* Waits for running jobs; callbacks that haven't run yet are dropped */
+void pyworker_deinit(void)
+{
+    PY_WORKER_JOB *job, *next;
+
+    if (py_wake_tag == 0)
+        return;
+
+    g_main_context_set_poll_func(NULL, py_poll_prev);
+
+    if (py_pool)
+    {
+        g_atomic_int_set(&py_stopping, 1);
+
+        /* running jobs need the GIL to finish */
+        Py_BEGIN_ALLOW_THREADS
+        g_thread_pool_free(py_pool, FALSE, TRUE);
+        Py_END_ALLOW_THREADS
+        py_pool = NULL;
+    }
+
+    g_source_remove(py_wake_tag);
+    py_wake_tag = 0;
+
+    for (job = py_jobs_take(); job != NULL; job = next)
+    {
+        next = job->next;
+        py_job_free(job);
+    }
+
+    close(py_wake[0]);
+    close(py_wake[1]);
+    py_wake[0] = py_wake[1] = -1;
+
+    settings_remove("python_worker_threads");
+}
@@ -0,0 +1,13 @@
+#ifndef _PYWORKER_H_
+#define _PYWORKER_H_
+
+#include <Python.h>
+
+int pyworker_submit(PyObject *script, PyObject *func, PyObject *args, 
+        PyObject *callback);
+int pyworker_call_soon(PyObject *script, PyObject *func, PyObject *args);
+PyObject *pyworker_current_script(void);
+int pyworker_init(void);
+void pyworker_deinit(void);
+
+#endif